@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "body.hpp"
+#include "recorder.hpp"
+#include "simulation.hpp"
+#include "simulation_batch.hpp"
+#include "thread_pool.hpp"
+#include "utils.h"
+
+// headless batch runner
+// builds worlds from command line parameters and evaluates them without a window
+// usage: mechsim_batch <pp|spp|ppp> [key=value ...]
+
+// scenario parameters, overridable from the command line
+static std::map<std::string, float> default_parameters() {
+  return {
+    {"count", 1.0f},         // number of scenarios to run
+    {"threads", 0.0f},       // worker threads, 0 uses every hardware thread
+    {"duration", 5.0f},      // simulated seconds per scenario
+    {"dt", 1.0f / 120.0f},   // fixed tick length
+    {"substep", 1.0f / 120.0f}, // longest sub-step of the stepped solvers
+    {"iterations", 10.0f},   // constraint iterations of the pbd solver
+    {"tolerance", 1e-4f},    // error allowed per step of the rk45 solver
+    {"G", 0.0f},             // mutual gravity between particles, 0 is off
+    {"theta", 0.5f},         // barnes-hut opening angle of mutual gravity
+    {"central_mass", 1000.0f}, // mass orbited under the kepler solver
+    {"solver", 0.0f},        // 0 analytic, 1 euler, 2 verlet, 3 rk4, 4 events, 5 implicit, 6 pbd, 7 constrained, 8 rk45, 9 yoshida4, 10 modes, 11 kepler
+    {"sweep_from", 0.0f},    // range applied to the 'sweep' parameter
+    {"sweep_to", 0.0f},
+    {"distance", 1.0f},
+    {"gravity", 9.8f},
+    {"restitution", 0.5f},
+    {"time_scale", 1.0f},
+    {"rotation", 3*M_PI/8},
+    {"radius", 5.0f},
+    {"mass", 1.0f},
+    {"force", 0.0f},
+    {"velocity", 0.0f},
+    {"mass2", 1.0f},
+    {"velocity2", 0.0f},
+    {"length", 1.0f},
+    {"extension", 0.5f},
+    {"elasticity", 9.8f},
+  };
+}
+
+// all bodies a scenario can use
+// the world only picks up the bodies its simulation type needs
+struct scenario {
+  world_body world;
+  plane_body plane;
+  particle_body particle1;
+  particle_body particle2;
+  spring_body spring;
+  scenario(float radius) : particle1(radius), particle2(radius), spring(5.0f) {}
+};
+
+static void usage() {
+  std::cerr << "usage: mechsim_batch <pp|spp|ppp> [key=value ...]\n"
+            << "  sweep=<key> varies <key> from sweep_from to sweep_to across count scenarios\n"
+            << "  record=<prefix> records every tick of scenario i to <prefix>i.rec\n"
+            << "  keys:";
+  for (auto& p : default_parameters())
+    std::cerr << " " << p.first;
+  std::cerr << "\n";
+}
+
+// set up a scenario and its simulation from the parameter table
+static bool build(scenario& s, const std::string& type, std::map<std::string, float>& params) {
+  s.world.distance = params["distance"];
+  s.world.gravity = params["gravity"];
+  s.world.restitution = params["restitution"];
+  s.world.time_scale = params["time_scale"];
+  s.world.solver = (world_body::SOLVER)(int)params["solver"];
+  s.world.max_substep = params["substep"];
+  s.world.constraint_iterations = (unsigned int)params["iterations"];
+  s.world.tolerance = params["tolerance"];
+  s.world.mutual_gravity = params["G"] != 0.0f;
+  // G of 0 turns mutual gravity off, the kepler solver then uses 1
+  s.world.gravitational_constant = params["G"] != 0.0f ? params["G"] : 1.0f;
+  s.world.opening_angle = params["theta"];
+  s.world.central_mass = params["central_mass"];
+  s.plane.rotation = params["rotation"];
+  s.particle1.mass = params["mass"];
+  s.particle1.force = params["force"];
+  s.particle1.u_velocity = params["velocity"];
+  s.particle2.mass = params["mass2"];
+  s.particle2.u_velocity = params["velocity2"];
+  s.spring.length = params["length"];
+  s.spring.extension = params["extension"];
+  s.spring.elasticity = params["elasticity"];
+
+  s.world.add_plane(&s.plane);
+  s.world.add_particle(&s.particle1);
+  if (type == "ppp")
+    s.world.add_particle(&s.particle2);
+  if (type == "spp")
+    s.world.add_spring(&s.spring);
+  return s.world.create_simulation();
+}
+
+// csv row of a finished scenario
+static std::string row(size_t i, double time, const scenario& s) {
+  std::ostringstream row;
+  row << i << "," << time << ","
+      << s.particle1.position.x << "," << s.particle1.position.y << "," << s.particle1.position.z << ","
+      << s.particle2.position.x << "," << s.particle2.position.y << "," << s.particle2.position.z << "\n";
+  return row.str();
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  std::string type = argv[1];
+  if (type != "pp" && type != "spp" && type != "ppp") {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  // read key=value overrides
+  std::map<std::string, float> params = default_parameters();
+  std::string sweep;
+  std::string record;
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t split = arg.find('=');
+    if (split == std::string::npos) {
+      usage();
+      return EXIT_FAILURE;
+    }
+    std::string key = arg.substr(0, split);
+    std::string value = arg.substr(split + 1);
+    if (key == "sweep") {
+      sweep = value;
+    } else if (key == "record") {
+      record = value;
+    } else if (params.count(key)) {
+      params[key] = std::stof(value);
+    } else {
+      std::cerr << "unknown parameter " << key << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  if (!sweep.empty() && !params.count(sweep)) {
+    std::cerr << "unknown sweep parameter " << sweep << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const int count = std::max(1, (int)params["count"]);
+  const float duration = params["duration"];
+  const unsigned int ticks = (unsigned int)std::max(1.0f, duration / params["dt"] + 0.5f);
+
+  // scenarios are independent, each pool job builds and starts its own
+  // closed form scenarios sharing one tick length then advance together in
+  // a simulation_batch, every other one runs on its own in the pool job,
+  // and rows are printed in scenario order once all have finished
+  std::vector<std::string> rows(count);
+  std::vector<char> failed(count, 0);
+  std::vector<scenario*> scenarios(count, NULL);
+  std::vector<char> batched(count, 0);
+  // accepted and rejected steps of the adaptive solver per scenario
+  std::vector<unsigned long> accepted(count, 0), rejected(count, 0);
+  const bool batchable = record.empty() && sweep != "dt";
+  thread_pool pool((unsigned int)std::max(0.0f, params["threads"]));
+  // a lone scenario leaves the pool idle, so its solvers get one of their own
+  thread_pool* solver_pool = count == 1 ? new thread_pool((unsigned int)std::max(0.0f, params["threads"])) : NULL;
+  auto begin = std::chrono::steady_clock::now();
+  pool.run(count, [&](size_t i) {
+    std::map<std::string, float> p = params;
+    if (!sweep.empty()) {
+      float t = count > 1 ? (float)i / (count - 1) : 0.0f;
+      p[sweep] = p["sweep_from"] * (1.0f - t) + p["sweep_to"] * t;
+    }
+    scenario& s = *(scenarios[i] = new scenario(p["radius"]));
+    s.world.pool = solver_pool;
+    if (!build(s, type, p)) {
+      failed[i] = 1;
+      return;
+    }
+    simulation* sim = s.world.get_simulation();
+    s.world.start_simulation();
+    // step the fixed clock straight to the end of the run
+    sim->get_clock().set_dt(p["dt"]);
+    if (batchable && s.world.solver == world_body::SOLVER::ANALYTIC) {
+      batched[i] = 1;
+      return;
+    }
+    if (record.empty()) {
+      sim->run(ticks);
+    } else {
+      // tick by tick, waiting on the spill thread rather than dropping
+      // frames since nothing here runs in real time
+      recorder r(&s.world);
+      if (r.start(record + std::to_string(i) + ".rec")) {
+        for (unsigned int t = 0; t <= ticks; t++) {
+          if (t > 0)
+            sim->run(1);
+          r.capture(sim->get_time(), true);
+        }
+        r.stop();
+      } else {
+        sim->run(ticks);
+      }
+    }
+    rows[i] = row(i, sim->get_time(), s);
+    const numeric* stepped = dynamic_cast<const numeric*>(sim);
+    const dormand_prince* adaptive = stepped ? dynamic_cast<const dormand_prince*>(stepped->get_integrator()) : NULL;
+    if (adaptive) {
+      accepted[i] = adaptive->accepted;
+      rejected[i] = adaptive->rejected;
+    }
+    s.world.end_simulation();
+  });
+  simulation_batch batch;
+  batch.clock.set_dt(params["dt"]);
+  for (int i = 0; i < count; i++) {
+    if (batched[i])
+      batch.add(&scenarios[i]->world);
+  }
+  if (batch.size()) {
+    batch.run(ticks);
+    batch.write_back();
+    for (int i = 0; i < count; i++) {
+      if (!batched[i])
+        continue;
+      scenario& s = *scenarios[i];
+      rows[i] = row(i, batch.clock.get_time() * s.world.time_scale, s);
+      s.world.end_simulation();
+    }
+  }
+  for (scenario* s : scenarios)
+    delete s;
+  delete solver_pool;
+  for (int i = 0; i < count; i++) {
+    if (failed[i]) {
+      std::cerr << "scenario " << i << " has no legal simulation\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::cout << "scenario,time,x1,y1,z1,x2,y2,z2\n";
+  for (const std::string& row : rows)
+    std::cout << row;
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  std::cerr << count << " scenarios in " << elapsed << "s ("
+            << count / elapsed << " scenarios/s) on " << pool.get_thread_count() << " threads\n";
+  if (params["solver"] == world_body::SOLVER::RK45) {
+    unsigned long total_accepted = 0, total_rejected = 0;
+    for (int i = 0; i < count; i++) {
+      total_accepted += accepted[i];
+      total_rejected += rejected[i];
+    }
+    std::cerr << total_accepted << " steps accepted, " << total_rejected << " rejected\n";
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,29 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <vector>
+
+// benchmark suite registry
+// each benchmark file declares a static bench_suite which adds itself to
+// the list run by mechsim_bench
+struct bench_suite {
+  const char* name;
+  void (*run)();
+  bench_suite(const char* name, void (*run)()) : name(name), run(run) {
+    all().push_back(this);
+  }
+  static std::vector<bench_suite*>& all() {
+    static std::vector<bench_suite*> suites;
+    return suites;
+  }
+};
+
+// wall clock seconds taken to call 'fn'
+template <typename F> double time_seconds(F fn) {
+  auto begin = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+#endif // !BENCH_H
@@ -0,0 +1,64 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "bench.hpp"
+#include "collision.hpp"
+#include "particle_store.hpp"
+
+// broad phase scaling at constant particle density
+// brute force pair testing is timed for the small counts only
+
+static const float radius = 0.5f;
+
+static void fill(particle_store& p, size_t n) {
+  // roughly eight cubic units per particle
+  float side = std::cbrt(8.0f * n);
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> position(0.0f, side);
+  std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+  p.clear();
+  p.reserve(n);
+  for (size_t i = 0; i < n; i++)
+    p.add(glm::vec3(position(rng), position(rng), position(rng)),
+          glm::vec3(velocity(rng), velocity(rng), velocity(rng)), 1.0f, radius);
+}
+
+// every pair, for reference
+static size_t brute_force(const particle_store& p) {
+  size_t contacts = 0;
+  for (size_t i = 0; i < p.size(); i++)
+    for (size_t j = i + 1; j < p.size(); j++) {
+      glm::vec3 d = p.position.get(j) - p.position.get(i);
+      float reach = p.radius[i] + p.radius[j];
+      if (glm::dot(d, d) < reach * reach)
+        contacts++;
+    }
+  return contacts;
+}
+
+static void run() {
+  printf("%10s %12s %12s %14s %12s %14s\n", "particles", "build ms", "resolve ms",
+         "tests/particle", "contacts", "brute ms");
+  const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+  for (size_t n : counts) {
+    particle_store p;
+    fill(p, n);
+    // brute force on an untouched copy, before the grid moves anything
+    double brute = -1.0;
+    size_t brute_contacts = 0;
+    if (n <= 10000)
+      brute = time_seconds([&]() { brute_contacts = brute_force(p); });
+    collision_grid grid;
+    double build = time_seconds([&]() { grid.build(p); });
+    double resolve = time_seconds([&]() { grid.resolve(p, 0.5f); });
+    printf("%10zu %12.3f %12.3f %14.2f %12zu ", n, build * 1000.0, resolve * 1000.0,
+           (double)grid.pair_tests / n, grid.contacts);
+    if (brute >= 0.0)
+      printf("%14.3f (%zu contacts)\n", brute * 1000.0, brute_contacts);
+    else
+      printf("%14s\n", "-");
+  }
+}
+
+static bench_suite suite("collision", run);
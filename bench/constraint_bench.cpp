@@ -0,0 +1,83 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "integrator.hpp"
+#include "thread_pool.hpp"
+
+// chains of rods let go sideways from fixed anchors, every other chain
+// hinged to swing in its plane, run for two seconds at 1/120 s by the
+// constrained solver. reports the worst error left in any rod length and
+// out of any hinge plane, with and without warm starting, as the
+// iteration count grows
+
+static const float spacing = 0.1f;
+static const float dt = 1.0f / 120.0f;
+static const int steps = 240;
+
+// 'chains' chains of 'links' rods lying along x, hung from anchors along z
+static void chains(int count, int links, ode_system& s) {
+  s = ode_system();
+  for (int c = 0; c < count; c++) {
+    glm::vec3 anchor(0.0f, 0.0f, c * spacing * 2.0f);
+    for (int k = 0; k < links; k++) {
+      int i = s.add_particle(anchor + glm::vec3((k + 1) * spacing, 0.0f, 0.0f), glm::vec3(0.0f), 0.1f, 0.01f);
+      ode_system::rod r;
+      r.a = i;
+      r.b = k == 0 ? -1 : i - 1;
+      r.anchor = anchor;
+      r.length = spacing;
+      // a slight tilt out of the swing plane the hinges must hold back
+      r.hinged = c % 2 == 0;
+      r.axis = glm::vec3(0.0f, 0.0f, 1.0f);
+      s.rods.push_back(r);
+      s.particles.view(i).set_velocity(glm::vec3(0.0f, 0.0f, 0.2f));
+    }
+  }
+}
+
+// worst relative rod stretch and hinge plane distance over rod length
+static void errors(const ode_system& s, float& stretch, float& plane) {
+  stretch = 0.0f;
+  plane = 0.0f;
+  for (const ode_system::rod& r : s.rods) {
+    glm::vec3 d = s.particles.position.get(r.a) - (r.b < 0 ? r.anchor : s.particles.position.get(r.b));
+    stretch = std::max(stretch, std::fabs(glm::length(d) - r.length) / r.length);
+    if (r.hinged)
+      plane = std::max(plane, std::fabs(glm::dot(d, r.axis)) / r.length);
+  }
+}
+
+static void run() {
+  thread_pool pool;
+  printf("%d steps of 1/120 s, %u threads, step times in us\n", steps, pool.get_thread_count());
+  printf("%8s %8s %6s %6s %6s %10s %10s %10s\n", "rods", "colours", "iters", "warm", "pool", "step", "stretch",
+         "hinge");
+  ode_system s;
+  for (int count : {16, 256}) {
+    for (unsigned int iterations : {2u, 5u, 10u, 20u}) {
+      for (bool warm : {false, true}) {
+        for (bool pooled : {false, true}) {
+          // one pooled row per size is enough to compare
+          if (pooled && (iterations != 10 || !warm))
+            continue;
+          chains(count, 32, s);
+          constrained_euler solver(iterations);
+          solver.warm_start = warm;
+          solver.pool = pooled ? &pool : NULL;
+          double seconds = time_seconds([&] {
+            for (int i = 0; i < steps; i++)
+              solver.step(s, dt);
+          });
+          float stretch, plane;
+          errors(s, stretch, plane);
+          printf("%8zu %8zu %6u %6s %6s %10.1f %10.2e %10.2e\n", s.rods.size(), solver.get_colours(), iterations,
+                 warm ? "yes" : "no", pooled ? "yes" : "no", seconds / steps * 1e6, stretch, plane);
+        }
+      }
+    }
+  }
+}
+
+static bench_suite suite("constraint", run);
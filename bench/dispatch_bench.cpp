@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "body.hpp"
+#include "simulation.hpp"
+#include "simulation_batch.hpp"
+
+// per instance cost of advancing many small closed form simulations, each
+// through its own virtual evaluate() against one simulation_batch update
+// the instances are interleaved pp, spp, ppp as a scene of mixed worlds
+// would hold them, and each owns its heap allocated world and bodies
+
+static const int instances = 3 * 4096;
+static const int frames = 200;
+
+struct instance {
+  world_body world;
+  plane_body plane;
+  particle_body particle1;
+  particle_body particle2;
+  spring_body spring;
+  instance() : particle1(1.0f), particle2(1.0f), spring(5.0f) {}
+};
+
+static void row(const char* name, std::vector<instance*>& scene, int type) {
+  std::vector<simulation*> sims;
+  simulation_batch batch;
+  for (int i = 0; i < instances; i++) {
+    if (type >= 0 && i % 3 != type)
+      continue;
+    instance* s = scene[i];
+    s->world.start_simulation();
+    sims.push_back(s->world.get_simulation());
+    batch.add(&s->world);
+  }
+  double virtual_seconds = time_seconds([&] {
+    for (int f = 1; f <= frames; f++) {
+      for (simulation* sim : sims) {
+        sim->get_clock().step();
+        sim->evaluate(sim->get_time());
+      }
+    }
+  });
+  double batch_seconds = time_seconds([&] {
+    for (int f = 1; f <= frames; f++)
+      batch.run(1);
+  });
+  double write_seconds = time_seconds([&] {
+    for (int f = 1; f <= frames; f++) {
+      batch.run(1);
+      batch.write_back();
+    }
+  });
+  // both paths stopped at the same tick, so every body must agree
+  batch.clock.reset();
+  batch.run(frames);
+  batch.write_back();
+  float worst = 0.0f;
+  for (int i = 0; i < instances; i++) {
+    if (type >= 0 && i % 3 != type)
+      continue;
+    simulation* sim = scene[i]->world.get_simulation();
+    glm::vec3 p1 = scene[i]->particle1.position, p2 = scene[i]->particle2.position;
+    sim->evaluate(sim->get_time());
+    worst = std::max(worst, glm::length(p1 - scene[i]->particle1.position));
+    worst = std::max(worst, glm::length(p2 - scene[i]->particle2.position));
+  }
+  double n = (double)sims.size() * frames;
+  printf("%-6s %12.1f %12.1f %12.1f %10.2f %10.2e\n", name, virtual_seconds / n * 1e9, batch_seconds / n * 1e9,
+         write_seconds / n * 1e9, virtual_seconds / batch_seconds, worst);
+}
+
+static void run() {
+  std::vector<instance*> scene(instances);
+  for (int i = 0; i < instances; i++) {
+    instance* s = scene[i] = new instance();
+    s->world.time_scale = 1.0f + (i % 7) * 0.1f;
+    s->particle1.u_velocity = 1.0f + (i % 5) * 0.5f;
+    s->particle2.u_velocity = 0.5f;
+    s->world.add_plane(&s->plane);
+    s->world.add_particle(&s->particle1);
+    if (i % 3 == 1)
+      s->world.add_spring(&s->spring);
+    if (i % 3 == 2)
+      s->world.add_particle(&s->particle2);
+    s->world.create_simulation();
+    s->world.get_simulation()->follow = false;
+  }
+  printf("%d instances, %d frames, ns per instance per frame, largest difference from virtual\n", instances, frames);
+  printf("%-6s %12s %12s %12s %10s %10s\n", "type", "virtual", "batch", "write back", "batch x", "diff");
+  row("pp", scene, 0);
+  row("spp", scene, 1);
+  row("ppp", scene, 2);
+  row("mixed", scene, -1);
+  for (instance* s : scene) {
+    s->world.end_simulation();
+    delete s;
+  }
+}
+
+static bench_suite suite("dispatch", run);
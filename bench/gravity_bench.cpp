@@ -0,0 +1,89 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+#include "gravity_tree.hpp"
+#include "thread_pool.hpp"
+
+// one mutual gravity pass over a random cluster, the barnes-hut tree
+// against the direct pair sum, and the force error of the tree relative
+// to the direct sum over a sample of particles as the opening angle grows
+
+static const size_t samples = 512;
+static const float softening = 0.01f;
+
+// uniform ball of unit radius, masses summing to 1
+static void cluster(size_t n, vec3_array& x, std::vector<float>& mass) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> d(-1.0f, 1.0f);
+  x.clear();
+  while (x.size() < n) {
+    glm::vec3 p(d(rng), d(rng), d(rng));
+    if (glm::dot(p, p) <= 1.0f)
+      x.push_back(p);
+  }
+  mass.assign(n, 1.0f / n);
+}
+
+// rms of |tree - direct| over rms |direct| for the first 'samples' particles
+static double force_error(const vec3_array& x, const std::vector<float>& mass, const vec3_array& tree) {
+  double error = 0.0, norm = 0.0;
+  const size_t n = x.size();
+  for (size_t i = 0; i < samples && i < n; i++) {
+    glm::vec3 a(0.0f);
+    for (size_t j = 0; j < n; j++) {
+      if (j == i)
+        continue;
+      glm::vec3 d = x.get(j) - x.get(i);
+      float r2 = glm::dot(d, d) + softening * softening;
+      a += d * (mass[j] / (r2 * std::sqrt(r2)));
+    }
+    glm::vec3 e = tree.get(i) - a;
+    error += glm::dot(e, e);
+    norm += glm::dot(a, a);
+  }
+  return std::sqrt(error / norm);
+}
+
+static void run() {
+  thread_pool pool;
+  printf("%u threads, pass times in ms, direct sums above 65536 bodies skipped\n", pool.get_thread_count());
+  printf("%8s %10s %10s %10s %10s %10s %10s\n", "bodies", "direct", "build", "tree", "tree pool", "direct x", "error");
+  vec3_array x, out;
+  std::vector<float> mass;
+  gravity_tree tree;
+  tree.softening = softening;
+  for (size_t n = 1024; n <= 262144; n *= 4) {
+    cluster(n, x, mass);
+    out.resize(n);
+    double direct = 0.0;
+    if (n <= 65536)
+      direct = time_seconds([&] { gravity_direct(x, mass, 1.0f, softening, out); });
+    double build = time_seconds([&] { tree.build(x, mass); });
+    std::fill(out.x.begin(), out.x.end(), 0.0f);
+    std::fill(out.y.begin(), out.y.end(), 0.0f);
+    std::fill(out.z.begin(), out.z.end(), 0.0f);
+    double walk = time_seconds([&] { tree.accumulate(out); });
+    double error = force_error(x, mass, out);
+    double pooled = time_seconds([&] { tree.accumulate(out, &pool); });
+    printf("%8zu %10.2f %10.2f %10.2f %10.2f %10.1f %10.2e\n", n, direct * 1e3, build * 1e3, walk * 1e3,
+           pooled * 1e3, direct > 0.0 ? direct / (build + walk) : 0.0, error);
+  }
+
+  const size_t n = 65536;
+  cluster(n, x, mass);
+  tree.build(x, mass);
+  printf("opening angle at %zu bodies\n%8s %10s %14s %10s\n", n, "theta", "tree", "pairs/body", "error");
+  for (float theta : {0.2f, 0.35f, 0.5f, 0.7f, 1.0f}) {
+    tree.opening_angle = theta;
+    out.clear();
+    out.resize(n);
+    double walk = time_seconds([&] { tree.accumulate(out); });
+    printf("%8.2f %10.2f %14.1f %10.2e\n", theta, walk * 1e3,
+           (double)(tree.node_interactions + tree.pair_interactions) / n, force_error(x, mass, out));
+  }
+}
+
+static bench_suite suite("gravity", run);
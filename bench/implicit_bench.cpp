@@ -0,0 +1,98 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "integrator.hpp"
+#include "thread_pool.hpp"
+
+// a stiff square spring net hanging from its top edge, run for one second
+// by semi-implicit euler and by implicit euler over a range of step
+// lengths. the explicit step blows up past its stability limit while the
+// implicit one stays bounded at frame sized steps, reported with the time
+// per simulated second and the conjugate gradient iterations per step
+
+static const float spacing = 0.1f;
+static const float stiffness = 20000.0f;
+static const float mass = 0.01f;
+
+// side x side particles joined to their right and lower neighbours, the
+// top row hung from anchors one spacing above
+static void net(int side, ode_system& s) {
+  s = ode_system();
+  for (int r = 0; r < side; r++)
+    for (int c = 0; c < side; c++)
+      s.add_particle(glm::vec3(c * spacing, -r * spacing, 0.0f), glm::vec3(0.0f), mass, spacing * 0.25f);
+  auto join = [&](int a, int b, glm::vec3 anchor) {
+    ode_system::link l;
+    l.a = a;
+    l.b = b;
+    l.anchor = anchor;
+    l.rest_length = spacing;
+    l.stiffness = stiffness;
+    l.push_only = false;
+    s.links.push_back(l);
+  };
+  for (int r = 0; r < side; r++) {
+    for (int c = 0; c < side; c++) {
+      int i = r * side + c;
+      if (c + 1 < side)
+        join(i, i + 1, glm::vec3(0.0f));
+      if (r + 1 < side)
+        join(i, i + side, glm::vec3(0.0f));
+      if (r == 0)
+        join(i, -1, glm::vec3(c * spacing, spacing, 0.0f));
+    }
+  }
+}
+
+// furthest any particle strayed from the net's top corner, inf once it
+// has blown up
+static float spread(const ode_system& s) {
+  float furthest = 0.0f;
+  for (size_t i = 0; i < s.size(); i++) {
+    float d = glm::length(s.particles.position.get(i));
+    if (!std::isfinite(d))
+      return INFINITY;
+    furthest = std::max(furthest, d);
+  }
+  return furthest;
+}
+
+static void run_one(int side, integrator& method, float dt, implicit_euler* implicit) {
+  ode_system s;
+  net(side, s);
+  method.reset();
+  const int steps = (int)std::lround(1.0 / dt);
+  unsigned long iterations = 0;
+  double seconds = time_seconds([&] {
+    for (int i = 0; i < steps; i++) {
+      method.step(s, dt);
+      if (implicit)
+        iterations += implicit->solver.iterations;
+    }
+  });
+  float furthest = spread(s);
+  // the net hangs about side spacings long, far more means it blew up
+  bool stable = furthest < 4.0f * side * spacing;
+  printf("%6d %-20s %8.5f %10.2f %8s %10.1f\n", side * side, method.get_name(), dt, seconds * 1e3,
+         stable ? "yes" : "no", implicit ? (double)iterations / steps : 0.0);
+}
+
+static void run() {
+  thread_pool pool;
+  printf("k %.0f, m %.3f, explicit limit about %.5f s, %u threads\n", stiffness, mass,
+         2.0f / std::sqrt(8.0f * stiffness / mass), pool.get_thread_count());
+  printf("%6s %-20s %8s %10s %8s %10s\n", "nodes", "solver", "dt", "ms/sim s", "stable", "cg/step");
+  euler explicit_step;
+  implicit_euler implicit_step;
+  implicit_step.solver.pool = &pool;
+  for (int side : {16, 64}) {
+    for (float dt : {1.0f / 60.0f, 1.0f / 1000.0f, 1.0f / 4000.0f, 1.0f / 16000.0f})
+      run_one(side, explicit_step, dt, NULL);
+    for (float dt : {1.0f / 30.0f, 1.0f / 60.0f, 1.0f / 240.0f})
+      run_one(side, implicit_step, dt, &implicit_step);
+  }
+}
+
+static bench_suite suite("implicit", run);
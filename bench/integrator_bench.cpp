@@ -0,0 +1,132 @@
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+#include "bench.hpp"
+#include "body.hpp"
+#include "integrator.hpp"
+#include "simulation.hpp"
+
+// integrators against the closed form pp and spp solutions
+// error is measured along the slope, in the units the analytic
+// simulations use before they scale to the drawn model
+
+static const float rotation = 3*M_PI/8;
+static const float gravity = 9.8f;
+static const float duration = 2.0f;
+
+static glm::vec3 slope() { return glm::vec3(-cos(rotation), sin(rotation), 0.0f); }
+static glm::vec3 normal() { return glm::vec3(sin(rotation), cos(rotation), 0.0f); }
+
+// displacement along the slope reported by pp after 'duration' seconds
+static float pp_reference(float u_velocity) {
+  world_body world;
+  plane_body plane;
+  particle_body particle(5.0f);
+  plane.rotation = rotation;
+  particle.u_velocity = u_velocity;
+  world.gravity = gravity;
+  world.add_plane(&plane);
+  world.add_particle(&particle);
+  world.create_simulation();
+  simulation* sim = world.get_simulation();
+  sim->start();
+  sim->evaluate(0.0f);
+  glm::vec3 origin = particle.position;
+  sim->evaluate(duration);
+  return glm::dot(particle.position - origin, slope()) / particle.get_radius();
+}
+
+// particle distance from the spring anchor reported by spp after 'duration' seconds
+static float spp_reference(float elasticity, float extension, float force) {
+  world_body world;
+  plane_body plane;
+  particle_body particle(5.0f);
+  spring_body spring(5.0f);
+  plane.rotation = rotation;
+  particle.force = force;
+  spring.elasticity = elasticity;
+  spring.extension = extension;
+  world.gravity = gravity;
+  world.add_plane(&plane);
+  world.add_particle(&particle);
+  world.add_spring(&spring);
+  world.create_simulation();
+  simulation* sim = world.get_simulation();
+  sim->start();
+  sim->evaluate(0.0f);
+  glm::vec3 origin = particle.position;
+  sim->evaluate(duration);
+  float scalar = spring_body::coil_width*spring_body::coils*spring.get_scale();
+  return spring.length - extension + glm::dot(particle.position - origin, slope()) / scalar;
+}
+
+// single particle resting on a plane through the origin
+static ode_system incline(glm::vec3 position, glm::vec3 velocity) {
+  ode_system s;
+  s.gravity = glm::vec3(0.0f, -gravity, 0.0f);
+  s.add_particle(position, velocity, 1.0f, 0.0f);
+  s.contacts.push_back(ode_system::contact{ glm::vec3(0.0f), normal() });
+  return s;
+}
+
+static float integrate(integrator& method, ode_system& s, float dt) {
+  int steps = (int)(duration / dt + 0.5f);
+  for (int i = 0; i < steps; i++)
+    method.step(s, dt);
+  return glm::dot(s.particles.position.get(0), slope());
+}
+
+static void run() {
+  std::unique_ptr<integrator> methods[] = {
+    std::unique_ptr<integrator>(new euler()),
+    std::unique_ptr<integrator>(new verlet()),
+    std::unique_ptr<integrator>(new rk4()),
+  };
+  const float steps[] = { 1.0f / 30.0f, 1.0f / 120.0f, 1.0f / 480.0f };
+
+  // accuracy against the analytic simulations
+  // spp ignores the particle landing back on the spring, so the applied
+  // force is chosen to carry the particle away after release
+  const float u = 2.0f, elasticity = 40.0f, extension = 0.5f, force = 20.0f;
+  float pp_r = pp_reference(u);
+  float spp_r = spp_reference(elasticity, extension, force);
+  printf("%-22s %10s %14s %14s\n", "integrator", "dt", "pp error", "spp error");
+  for (auto& method : methods) {
+    for (float dt : steps) {
+      method->reset();
+      ode_system a = incline(glm::vec3(0.0f), slope() * u);
+      float pp_error = std::fabs(integrate(*method, a, dt) - pp_r);
+      method->reset();
+      ode_system b = incline(slope() * (1.0f - extension), glm::vec3(0.0f));
+      b.particles.view(0).set_applied(slope() * force);
+      b.links.push_back(ode_system::link{ 0, -1, glm::vec3(0.0f), 1.0f, elasticity, true });
+      float spp_error = std::fabs(integrate(*method, b, dt) - spp_r);
+      printf("%-22s %10.5f %14.3e %14.3e\n", method->get_name(), dt, pp_error, spp_error);
+    }
+  }
+
+  // throughput on a spring chain lying on a plane
+  const int particles = 10000;
+  const int iterations = 200;
+  printf("\n%-22s %12s %18s\n", "integrator", "steps/s", "particle steps/s");
+  for (auto& method : methods) {
+    ode_system s;
+    s.gravity = glm::vec3(0.0f, -gravity, 0.0f);
+    s.contacts.push_back(ode_system::contact{ glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f) });
+    for (int i = 0; i < particles; i++) {
+      s.add_particle(glm::vec3(i * 1.0f, 1.0f, 0.0f), glm::vec3(0.0f), 1.0f, 0.5f);
+      if (i > 0)
+        s.links.push_back(ode_system::link{ i - 1, i, glm::vec3(0.0f), 1.0f, 50.0f, false });
+    }
+    method->reset();
+    double seconds = time_seconds([&]() {
+      for (int i = 0; i < iterations; i++)
+        method->step(s, 1.0f / 120.0f);
+    });
+    printf("%-22s %12.0f %18.3e\n", method->get_name(), iterations / seconds,
+           (double)iterations * particles / seconds);
+  }
+}
+
+static bench_suite suite("integrators", run);
@@ -0,0 +1,81 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+#include "kepler.hpp"
+#include "thread_pool.hpp"
+
+// satellites on random bound orbits about one centre, eccentricities up
+// to 0.99 and periods from minutes to a day. reports the time to place
+// every satellite at one time with and without the pool, and the worst
+// distance over the orbit size from a double precision solve of the same
+// orbits, at a time a year into the run
+
+static const double mu = 3.986e14;
+static const double year = 3.156e7;
+
+// position at time t of the orbit from 'position' and 'velocity', by
+// newton's method in double to convergence
+static glm::dvec3 reference(glm::dvec3 position, glm::dvec3 velocity, double t) {
+  const double r = glm::length(position);
+  const double a = 1.0 / (2.0 / r - glm::dot(velocity, velocity) / mu);
+  glm::dvec3 h = glm::cross(position, velocity);
+  glm::dvec3 ev = glm::cross(velocity, h) / mu - position / r;
+  const double e = glm::length(ev);
+  glm::dvec3 p = ev / e, q = glm::cross(glm::normalize(h), p);
+  double anomaly = std::atan2(glm::dot(position, velocity) / std::sqrt(mu * a), 1.0 - r / a);
+  double mean = std::fmod(anomaly - e * std::sin(anomaly) + std::sqrt(mu / (a * a * a)) * t, 2.0 * M_PI);
+  double E = mean;
+  for (int n = 0; n < 100; n++) {
+    double step = (E - e * std::sin(E) - mean) / (1.0 - e * std::cos(E));
+    E -= step;
+    if (std::fabs(step) < 1e-15)
+      break;
+  }
+  return p * (a * (std::cos(E) - e)) + q * (a * std::sqrt(1.0 - e * e) * std::sin(E));
+}
+
+static void run() {
+  thread_pool pool;
+  std::mt19937 random(7);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  printf("%u threads, %zu orbits to a lane group, %d newton iterations, times in ms\n", pool.get_thread_count(),
+         kepler_orbits::group, kepler_orbits::iterations);
+  printf("%10s %10s %10s %10s %14s\n", "orbits", "serial", "pool", "ns/orbit", "worst error");
+  for (size_t count : {1000u, 100000u, 1000000u}) {
+    kepler_orbits orbits;
+    orbits.mu = mu;
+    std::vector<glm::dvec3> start, speed;
+    for (size_t i = 0; i < count; i++) {
+      // periapsis from 7000 km and an apoapsis the eccentricity sets
+      double periapsis = 7.0e6 * (1.0 + 5.0 * unit(random));
+      double e = 0.99 * unit(random);
+      double a = periapsis / (1.0 - e);
+      double v = std::sqrt(mu * (2.0 / periapsis - 1.0 / a));
+      // orbital plane tilted at random about x then z
+      double tilt = M_PI * unit(random), turn = 2.0 * M_PI * unit(random);
+      glm::dvec3 radial(std::cos(turn), std::sin(turn), 0.0);
+      glm::dvec3 across = glm::dvec3(-std::sin(turn), std::cos(turn), 0.0) * std::cos(tilt) +
+                          glm::dvec3(0.0, 0.0, std::sin(tilt));
+      start.push_back(radial * periapsis);
+      speed.push_back(across * v);
+      orbits.add(start.back(), speed.back());
+    }
+    vec3_array out;
+    double serial = time_seconds([&] { orbits.positions(year, out); });
+    orbits.pool = &pool;
+    double pooled = time_seconds([&] { orbits.positions(year, out); });
+    // a sample of the orbits against the double solve
+    double worst = 0.0;
+    for (size_t i = 0; i < count; i += std::max<size_t>(1, count / 1000)) {
+      glm::dvec3 exact = reference(start[i], speed[i], year);
+      double size = glm::length(start[i]) * 2.0;
+      worst = std::max(worst, glm::length(glm::dvec3(out.get(i)) - exact) / size);
+    }
+    printf("%10zu %10.2f %10.2f %10.1f %14.2e\n", count, serial * 1e3, pooled * 1e3, serial / count * 1e9, worst);
+  }
+}
+
+static bench_suite suite("kepler", run);
@@ -0,0 +1,31 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bench.hpp"
+
+// runs every registered suite, or only the suites named on the command line
+// usage: mechsim_bench [suite ...]
+int main(int argc, char** argv) {
+  int ran = 0;
+  for (bench_suite* suite : bench_suite::all()) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; i++)
+      if (strcmp(argv[i], suite->name) == 0)
+        selected = true;
+    if (!selected)
+      continue;
+    printf("== %s ==\n", suite->name);
+    suite->run();
+    printf("\n");
+    ran++;
+  }
+  if (ran == 0) {
+    fprintf(stderr, "no matching suite, available:");
+    for (bench_suite* suite : bench_suite::all())
+      fprintf(stderr, " %s", suite->name);
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
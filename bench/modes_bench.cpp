@@ -0,0 +1,77 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "integrator.hpp"
+#include "modes.hpp"
+
+// a chain of springs hung from an anchor and let go unstretched, so it
+// bounces along its own line where the springs are exactly linear. the
+// normal modes are found once, then positions at any time cost one sum
+// over the modes, against runge-kutta 4 which has to step all the way
+// there. reports the one off build, the cost of a single time and of a
+// thousand times spread over an hour, and runge-kutta 4's cost and
+// distance from the modes at ten seconds. the straight chain splits into
+// its three axes and only the modes along it are excited, so the solve
+// and the sums only cover a third of the coordinates. runge-kutta 4's
+// distance is mostly its float rounding over the steps
+
+static const float spacing = 0.1f;
+static const float stiffness = 200.0f;
+static const float mass = 0.1f;
+static const float gravity = 9.8f;
+
+static void chain(int links, std::vector<glm::dvec3>& position, std::vector<spring_modes::spring>& springs) {
+  position.clear();
+  springs.clear();
+  for (int i = 0; i < links; i++) {
+    position.push_back(glm::dvec3(0.0, -(i + 1) * spacing, 0.0));
+    springs.push_back(spring_modes::spring{ i, i - 1, glm::dvec3(0.0), spacing, stiffness });
+  }
+}
+
+static void run() {
+  printf("%6s %10s %12s %14s %12s %12s\n", "links", "build ms", "one time us", "1000 times ms", "rk4 10 s ms",
+         "rk4 error");
+  for (int links : {16, 64, 256}) {
+    std::vector<glm::dvec3> position;
+    std::vector<spring_modes::spring> springs;
+    chain(links, position, springs);
+    std::vector<glm::dvec3> velocity(links, glm::dvec3(0.0)), force(links, glm::dvec3(0.0, -gravity * mass, 0.0));
+    std::vector<double> masses(links, mass);
+    spring_modes modes;
+    double build = time_seconds([&] { modes.build(position, velocity, masses, force, springs); });
+    std::vector<glm::vec3> out;
+    double one = time_seconds([&] { modes.positions(10.0, out); });
+    double many = time_seconds([&] {
+      for (int i = 0; i < 1000; i++)
+        modes.positions(3.6 * i, out);
+    });
+    modes.positions(10.0, out);
+
+    ode_system s;
+    s.gravity = glm::vec3(0.0f, -gravity, 0.0f);
+    for (int i = 0; i < links; i++) {
+      s.add_particle(glm::vec3(position[i]), glm::vec3(0.0f), mass, 0.01f);
+      s.links.push_back(ode_system::link{ i, i - 1, glm::vec3(0.0f), spacing, stiffness, false });
+    }
+    // a fifth of a radian of the fastest mode per step
+    rk4 solver;
+    double highest = 0.0;
+    for (size_t j = 0; j < modes.modes(); j++)
+      highest = std::max(highest, modes.frequency(j));
+    const float h = (float)(0.2 / highest);
+    const int steps = (int)(10.0f / h + 0.5f);
+    double stepped = time_seconds([&] {
+      for (int i = 0; i < steps; i++)
+        solver.step(s, 10.0f / steps);
+    });
+    float error = 0.0f;
+    for (int i = 0; i < links; i++)
+      error = std::max(error, glm::length(s.particles.position.get(i) - out[i]));
+    printf("%6d %10.2f %12.1f %14.2f %12.2f %12.2e\n", links, build * 1e3, one * 1e6, many * 1e3, stepped * 1e3, error);
+  }
+}
+
+static bench_suite suite("modes", run);
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "particle_store.hpp"
+#include "simd.hpp"
+
+// structure of arrays store against an array of per particle structs
+// both take the same gravity, integrate and plane contact step
+
+// layout the store replaces, one struct per particle
+struct aos_particle {
+  glm::vec3 position;
+  glm::vec3 velocity;
+  glm::vec3 applied;
+  float mass;
+  float radius;
+};
+
+static const glm::vec3 gravity(0.0f, -9.8f, 0.0f);
+static const glm::vec3 normal(0.0f, 1.0f, 0.0f);
+static const float dt = 1.0f / 120.0f;
+
+static void aos_step(std::vector<aos_particle>& particles) {
+  for (aos_particle& p : particles) {
+    glm::vec3 a = gravity + p.applied / p.mass;
+    p.velocity += a * dt;
+    p.position += p.velocity * dt;
+    float depth = glm::dot(p.position, normal) - p.radius;
+    if (depth < 0.0f) {
+      p.position -= normal * depth;
+      float vn = glm::dot(p.velocity, normal);
+      if (vn < 0.0f)
+        p.velocity -= normal * (1.5f * vn);
+    }
+  }
+}
+
+static void soa_step(particle_store& store, vec3_array& acceleration) {
+  store.accelerations(gravity, acceleration);
+  store.integrate(acceleration, dt);
+  store.collide_plane(glm::vec3(0.0f), normal, 0.5f);
+}
+
+static void run() {
+  printf("simd width %d\n", SIMD_WIDTH);
+  printf("%10s %14s %14s %10s\n", "particles", "aos ms/step", "soa ms/step", "speedup");
+  const size_t counts[] = { 1000, 100000, 1000000 };
+  for (size_t n : counts) {
+    std::vector<aos_particle> aos(n);
+    particle_store soa;
+    soa.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+      glm::vec3 p((float)(i % 1000), 1.0f + (float)(i % 7), (float)(i / 1000));
+      aos[i] = aos_particle{ p, glm::vec3(0.0f), glm::vec3(0.0f), 1.0f, 0.5f };
+      soa.add(p, glm::vec3(0.0f), 1.0f, 0.5f);
+    }
+    vec3_array acceleration;
+    // enough steps to cover roughly ten million particle updates
+    int steps = (int)(10000000 / n);
+    if (steps < 10)
+      steps = 10;
+    double aos_seconds = time_seconds([&]() {
+      for (int i = 0; i < steps; i++)
+        aos_step(aos);
+    });
+    double soa_seconds = time_seconds([&]() {
+      for (int i = 0; i < steps; i++)
+        soa_step(soa, acceleration);
+    });
+    printf("%10zu %14.4f %14.4f %9.2fx\n", n, aos_seconds * 1000.0 / steps,
+           soa_seconds * 1000.0 / steps, aos_seconds / soa_seconds);
+  }
+}
+
+static bench_suite suite("particle_store", run);
@@ -0,0 +1,98 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "integrator.hpp"
+#include "thread_pool.hpp"
+
+// a cloth of structural and shear links hanging from its top edge, run
+// for one second of 1/60 s frames by the position based solver. the frame
+// time is set by the constraint count and the projections per frame
+// only. the worst stretch left in any link shows what a budget buys,
+// spent as more iterations per step or as more, shorter steps
+
+static const float spacing = 0.05f;
+static const float stiffness = 1e5f;
+static const float mass = 0.001f;
+static const float dt = 1.0f / 60.0f;
+static const int frames = 60;
+
+// side x side particles joined to their right and lower neighbours and
+// across both diagonals, the top row hung from anchors
+static void cloth(int side, ode_system& s) {
+  s = ode_system();
+  for (int r = 0; r < side; r++)
+    for (int c = 0; c < side; c++)
+      s.add_particle(glm::vec3(c * spacing, 0.0f, r * spacing), glm::vec3(0.0f), mass, spacing * 0.25f);
+  auto join = [&](int a, int b, float length, glm::vec3 anchor) {
+    ode_system::link l;
+    l.a = a;
+    l.b = b;
+    l.anchor = anchor;
+    l.rest_length = length;
+    l.stiffness = stiffness;
+    l.push_only = false;
+    s.links.push_back(l);
+  };
+  const float diagonal = spacing * std::sqrt(2.0f);
+  for (int r = 0; r < side; r++) {
+    for (int c = 0; c < side; c++) {
+      int i = r * side + c;
+      if (c + 1 < side)
+        join(i, i + 1, spacing, glm::vec3(0.0f));
+      if (r + 1 < side)
+        join(i, i + side, spacing, glm::vec3(0.0f));
+      if (c + 1 < side && r + 1 < side)
+        join(i, i + side + 1, diagonal, glm::vec3(0.0f));
+      if (c > 0 && r + 1 < side)
+        join(i, i + side - 1, diagonal, glm::vec3(0.0f));
+      if (r == 0)
+        join(i, -1, spacing, glm::vec3(c * spacing, spacing, 0.0f));
+    }
+  }
+}
+
+// largest relative stretch of any link
+static float stretch(const ode_system& s) {
+  float worst = 0.0f;
+  for (const ode_system::link& l : s.links) {
+    glm::vec3 other = l.b < 0 ? l.anchor : s.particles.position.get(l.b);
+    float length = glm::length(s.particles.position.get(l.a) - other);
+    worst = std::max(worst, std::fabs(length - l.rest_length) / l.rest_length);
+  }
+  return worst;
+}
+
+static void run() {
+  thread_pool pool;
+  printf("%d frames at 1/60 s, %u threads, frame times in ms\n", frames, pool.get_thread_count());
+  printf("%8s %8s %6s %6s %6s %10s %10s %10s\n", "links", "colours", "steps", "iters", "pool", "frame", "max frame",
+         "stretch");
+  // steps per frame and iterations per step
+  const unsigned int budgets[][2] = { {1, 5}, {1, 10}, {1, 20}, {10, 1}, {20, 1} };
+  ode_system s;
+  for (int side : {64, 256}) {
+    for (const unsigned int* budget : budgets) {
+      for (bool pooled : {false, true}) {
+        cloth(side, s);
+        pbd solver(budget[1]);
+        solver.pool = pooled ? &pool : NULL;
+        const float h = dt / budget[0];
+        double total = 0.0, worst = 0.0;
+        for (int f = 0; f < frames; f++) {
+          double t = time_seconds([&] {
+            for (unsigned int k = 0; k < budget[0]; k++)
+              solver.step(s, h);
+          });
+          total += t;
+          worst = std::max(worst, t);
+        }
+        printf("%8zu %8zu %6u %6u %6s %10.2f %10.2f %10.2e\n", s.links.size(), solver.get_colours(), budget[0],
+               budget[1], pooled ? "yes" : "no", total / frames * 1e3, worst * 1e3, stretch(s));
+      }
+    }
+  }
+}
+
+static bench_suite suite("pbd", run);
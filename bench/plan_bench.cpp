@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "body.hpp"
+#include "simulation.hpp"
+
+// per evaluate() cost of the closed form simulations against the
+// formulas they used before plans, which rebuilt every fixed term per call
+// the legacy functions below are those evaluate() bodies, unchanged
+
+static const int calls = 1000000;
+static const float duration = 4.0f;
+
+static void legacy_pp(world_body* world, particle_body* particle, plane_body* plane, float time) {
+  glm::mat4 t(1.0f);
+  t = glm::rotate(t, (plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
+  glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, particle->get_radius(), 0.0f))[3];
+  t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
+  glm::vec3 start = t[3];
+  float r = (
+    ((particle->force - particle->mass*world->gravity
+    *sin(plane->rotation)))
+    /2*particle->mass)
+    *time*time
+    + particle->u_velocity*time;
+  particle->position = offset+world->position+start*world->distance+glm::normalize(start)*r*particle->get_radius();
+}
+
+static void legacy_spp(world_body* world, particle_body* particle, plane_body* plane, spring_body* spring, float extension, float time) {
+  glm::mat4 t(1.0f);
+  t = glm::rotate(t, (plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
+  glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, particle->get_radius(), 0.0f))[3];
+  t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
+  glm::vec3 start = t[3];
+  float scalar = spring_body::coil_width*spring_body::coils*spring->get_scale();
+  glm::vec3 position = world->position+start+offset;
+  float n = (spring->length/spring->elasticity)*(spring->elasticity+particle->force-particle->mass*world->gravity*sin(plane->rotation));
+  float p = spring->length-extension-n;
+  float z = sqrt(spring->elasticity/(particle->mass*spring->length));
+  float u = particle->u_velocity;
+  float r = p*cos(z*time)+u*sin(z*time)+n;
+  float end_time = (asin((p+extension)/sqrt(p*p+u*u)) - atan(p/u))/z;
+  spring->extension = spring->length-r;
+  if (time > end_time) {
+    float v = -z*p*sin(z*end_time)+z*u*cos(z*end_time);
+    float a = (particle->force-particle->mass*world->gravity*sin(plane->rotation))/particle->mass;
+    r = (a/2.0f)*time*time + (v-end_time*a)*time + spring->length - end_time*end_time*a/2.0f - end_time*(v-end_time*a);
+  }
+  particle->position = position+(glm::normalize(start)*r)*scalar;
+}
+
+static void legacy_ppp(world_body* world, particle_body* particle1, particle_body* particle2, plane_body* plane, float time) {
+  glm::mat4 t(1.0f);
+  t = glm::rotate(t, (plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
+  glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, particle1->get_radius(), 0.0f))[3];
+  t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
+  glm::vec3 start = t[3];
+  float collision_time = ((world->distance*particle1->get_radius() - particle1->get_radius() - particle2->get_radius())/ particle1->get_radius()) / (particle1->u_velocity + particle2->u_velocity);
+  float v1 = (particle1->u_velocity * particle1->mass - particle2->u_velocity * particle2->mass - world->restitution * (particle2->mass) * (particle1->u_velocity + particle2->u_velocity)) / (particle1->mass + particle2->mass);
+  float v2 = (particle1->u_velocity*particle1->mass-particle2->u_velocity*particle2->mass+world->restitution*(particle1->mass)*(particle1->u_velocity+particle2->u_velocity))/(particle1->mass+particle2->mass);
+  float r1 = particle1->u_velocity * time - world->distance / 2.0f;
+  float r2 = -particle2->u_velocity * time + world->distance / 2.0f;
+  if (time > collision_time) {
+    r1 = v1 * (time-collision_time) + particle1->u_velocity*collision_time - world->distance / 2.0f;
+    r2 = v2 * (time-collision_time) + -particle2->u_velocity *collision_time + world->distance / 2.0f;
+  }
+  particle1->position = offset + world->position + glm::normalize(start) * r1 * particle1->get_radius();
+  particle2->position = offset + world->position + glm::normalize(start) * r2 * particle2->get_radius();
+}
+
+// time 'calls' evaluations of each, returns the largest position difference
+template <typename A, typename B>
+static float compare(const char* name, A legacy, B planned, glm::vec3* position) {
+  float worst = 0.0f;
+  for (int i = 0; i <= 100; i++) {
+    float time = duration * i / 100;
+    legacy(time);
+    glm::vec3 before = *position;
+    planned(time);
+    worst = std::max(worst, glm::length(*position - before) / std::max(1.0f, glm::length(before)));
+  }
+  double old_seconds = time_seconds([&] {
+    for (int i = 0; i < calls; i++)
+      legacy(duration * i / calls);
+  });
+  double new_seconds = time_seconds([&] {
+    for (int i = 0; i < calls; i++)
+      planned(duration * i / calls);
+  });
+  printf("%-6s %14.2f %14.2f %10.2f %12.2e\n", name, old_seconds / calls * 1e9,
+         new_seconds / calls * 1e9, old_seconds / new_seconds, worst);
+  return worst;
+}
+
+static void run() {
+  printf("%-6s %14s %14s %10s %12s\n", "sim", "before ns", "after ns", "speedup", "max diff");
+  {
+    world_body world;
+    plane_body plane;
+    particle_body particle(5.0f);
+    particle.force = 12.0f;
+    particle.u_velocity = 1.5f;
+    world.add_plane(&plane);
+    world.add_particle(&particle);
+    world.create_simulation();
+    simulation* sim = world.get_simulation();
+    sim->start();
+    compare("pp", [&](float t) { legacy_pp(&world, &particle, &plane, t); },
+            [&](float t) { sim->evaluate(t); }, &particle.position);
+  }
+  {
+    world_body world;
+    plane_body plane;
+    particle_body particle(5.0f);
+    spring_body spring(5.0f);
+    particle.force = 20.0f;
+    particle.u_velocity = 0.5f;
+    world.add_plane(&plane);
+    world.add_particle(&particle);
+    world.add_spring(&spring);
+    world.create_simulation();
+    simulation* sim = world.get_simulation();
+    sim->start();
+    float extension = spring.extension;
+    compare("spp", [&](float t) { legacy_spp(&world, &particle, &plane, &spring, extension, t); },
+            [&](float t) { sim->evaluate(t); }, &particle.position);
+  }
+  {
+    world_body world;
+    plane_body plane;
+    particle_body particle1(5.0f), particle2(5.0f);
+    world.add_plane(&plane);
+    world.add_particle(&particle1);
+    world.add_particle(&particle2);
+    world.create_simulation();
+    particle1.u_velocity = 2.0f;
+    particle2.u_velocity = 1.0f;
+    simulation* sim = world.get_simulation();
+    sim->start();
+    compare("ppp", [&](float t) { legacy_ppp(&world, &particle1, &particle2, &plane, t); },
+            [&](float t) { sim->evaluate(t); }, &particle1.position);
+  }
+}
+
+static bench_suite suite("plan", run);
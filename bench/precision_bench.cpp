@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "bench.hpp"
+#include "simd.hpp"
+#include "sweep.hpp"
+#include "thread_pool.hpp"
+
+// float and double sweeps of the same cases
+// throughput of the float simd lanes, the float scalar kernels and the
+// double scalar kernels, then drift, the largest difference of the float
+// results from double, relative to the result, as the time grows
+
+static const size_t cases = 1 << 20;
+static const size_t drift_cases = 1 << 16;
+
+template <typename T> static void fill(std::vector<T>& v, size_t n, float from, float to, std::mt19937& rng) {
+  std::uniform_real_distribution<float> d(from, to);
+  v.resize(n);
+  for (T& x : v)
+    x = d(rng);
+}
+
+// same inputs in both precisions
+template <typename T> static void inputs(pp_sweep<T>& s, size_t n, float t0, float t1, unsigned int seed) {
+  std::mt19937 rng(seed);
+  fill(s.mass, n, 0.5f, 5.0f, rng);
+  fill(s.force, n, 0.0f, 20.0f, rng);
+  fill(s.u_velocity, n, 0.0f, 5.0f, rng);
+  fill(s.rotation, n, 0.0f, M_PI / 2, rng);
+  fill(s.time, n, t0, t1, rng);
+}
+
+template <typename T> static void inputs(spp_sweep<T>& s, size_t n, float t0, float t1, unsigned int seed) {
+  std::mt19937 rng(seed);
+  fill(s.mass, n, 0.5f, 5.0f, rng);
+  fill(s.force, n, 10.0f, 30.0f, rng);
+  fill(s.u_velocity, n, 0.1f, 2.0f, rng);
+  fill(s.rotation, n, 0.0f, M_PI / 2, rng);
+  fill(s.length, n, 0.5f, 2.0f, rng);
+  fill(s.elasticity, n, 5.0f, 20.0f, rng);
+  fill(s.time, n, t0, t1, rng);
+  s.extension.resize(n);
+  for (size_t i = 0; i < n; i++)
+    s.extension[i] = s.length[i] / 2;
+}
+
+template <typename T> static void inputs(ppp_sweep<T>& s, size_t n, float t0, float t1, unsigned int seed) {
+  std::mt19937 rng(seed);
+  fill(s.mass1, n, 0.5f, 5.0f, rng);
+  fill(s.mass2, n, 0.5f, 5.0f, rng);
+  fill(s.u_velocity1, n, 0.5f, 5.0f, rng);
+  fill(s.u_velocity2, n, 0.5f, 5.0f, rng);
+  fill(s.distance, n, 5.0f, 20.0f, rng);
+  fill(s.time, n, t0, t1, rng);
+}
+
+static const std::vector<float>& result(const pp_sweep<float>& s) { return s.displacement; }
+static const std::vector<double>& result(const pp_sweep<double>& s) { return s.displacement; }
+static const std::vector<float>& result(const spp_sweep<float>& s) { return s.displacement; }
+static const std::vector<double>& result(const spp_sweep<double>& s) { return s.displacement; }
+static const std::vector<float>& result(const ppp_sweep<float>& s) { return s.displacement1; }
+static const std::vector<double>& result(const ppp_sweep<double>& s) { return s.displacement1; }
+
+static double drift(const std::vector<float>& a, const std::vector<double>& reference) {
+  double worst = 0.0;
+  for (size_t i = 0; i < a.size(); i++)
+    worst = std::max(worst, std::abs(a[i] - reference[i]) / std::max(1.0, std::abs(reference[i])));
+  return worst;
+}
+
+template <template <typename> class S> static void throughput(const char* name, thread_pool& pool) {
+  S<float> f;
+  S<double> d;
+  inputs(f, cases, 0.0f, 5.0f, 1);
+  inputs(d, cases, 0.0f, 5.0f, 1);
+  // untimed first runs allocate the outputs
+  f.run();
+  d.run();
+  double simd = time_seconds([&] { f.run(); });
+  double scalar = time_seconds([&] { f.run_scalar(); });
+  double reference = time_seconds([&] { d.run(); });
+  double pooled = time_seconds([&] { f.run(&pool); });
+  printf("%-6s %14.1f %14.1f %14.1f %14.1f %10.2f\n", name, cases / simd / 1e6, cases / scalar / 1e6,
+         cases / reference / 1e6, cases / pooled / 1e6, reference / simd);
+}
+
+template <template <typename> class S> static void drift_row(const char* name) {
+  printf("%-6s", name);
+  for (float t0 = 1.0f; t0 < 1e5f; t0 *= 10.0f) {
+    S<float> f;
+    S<double> d;
+    inputs(f, drift_cases, t0, t0 * 10.0f, 2);
+    inputs(d, drift_cases, t0, t0 * 10.0f, 2);
+    f.run();
+    d.run();
+    printf(" %10.1e", drift(result(f), result(d)));
+  }
+  printf("\n");
+}
+
+static void run() {
+  thread_pool pool;
+  printf("%zu cases, %d float lanes, %u threads, rates in million cases/s\n", cases, SIMD_WIDTH, pool.get_thread_count());
+  printf("%-6s %14s %14s %14s %14s %10s\n", "sweep", "float simd", "float scalar", "double", "float pool", "simd x");
+  throughput<pp_sweep>("pp", pool);
+  throughput<spp_sweep>("spp", pool);
+  throughput<ppp_sweep>("ppp", pool);
+  printf("float drift from double, times in seconds\n%-6s", "sweep");
+  for (float t0 = 1.0f; t0 < 1e5f; t0 *= 10.0f)
+    printf(" %10s", (std::to_string((int)t0) + "-" + std::to_string((int)(t0 * 10))).c_str());
+  printf("\n");
+  drift_row<pp_sweep>("pp");
+  drift_row<spp_sweep>("spp");
+  drift_row<ppp_sweep>("ppp");
+}
+
+static bench_suite suite("precision", run);
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+#include "body.hpp"
+#include "recorder.hpp"
+#include "replay.hpp"
+#include "simulation.hpp"
+
+// records a long numeric run, then measures how compact the replay is,
+// how far decoded frames are from the recording and what a seek costs
+
+static const int particles = 16;
+static const unsigned int ticks = 120 * 600;
+static const int seeks = 1000000;
+
+static void run() {
+  world_body world;
+  world.solver = world_body::SOLVER::RK4;
+  plane_body plane;
+  std::vector<particle_body> bodies(particles, particle_body(1.0f));
+  world.add_plane(&plane);
+  for (int i = 0; i < particles; i++) {
+    bodies[i].u_velocity = 0.5f * i;
+    world.add_particle(&bodies[i]);
+  }
+  world.create_simulation();
+  simulation* sim = world.get_simulation();
+  sim->start();
+  recorder r(&world);
+  const char* path = "replay_bench.rec";
+  if (!r.start(path)) {
+    printf("cannot create %s\n", path);
+    return;
+  }
+  double record_seconds = time_seconds([&] {
+    r.capture(sim->get_time(), true);
+    for (unsigned int t = 0; t < ticks; t++) {
+      sim->run(1);
+      r.capture(sim->get_time(), true);
+    }
+    r.stop();
+  });
+  sim->end();
+
+  replay p;
+  double encode_seconds = time_seconds([&] { p.load(r); });
+  size_t raw = r.get_frame_count() * r.get_bodies() * sizeof(recorder::sample);
+  // largest position error of any decoded frame against the recording
+  float worst = 0.0f, extent = 0.0f;
+  std::vector<recorder::sample> state(p.get_bodies());
+  for (size_t i = 0; i < p.get_frame_count(); i++) {
+    p.frame(i, state.data());
+    const recorder::sample* recorded = r.get_frame(i);
+    for (size_t b = 0; b < p.get_bodies(); b++) {
+      worst = std::max(worst, glm::length(state[b].position - recorded[b].position));
+      extent = std::max(extent, glm::length(recorded[b].position));
+    }
+  }
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> when(p.get_start_time(), p.get_end_time());
+  std::vector<float> times(4096);
+  for (float& t : times)
+    t = when(rng);
+  double seek_seconds = time_seconds([&] {
+    for (int i = 0; i < seeks; i++)
+      p.seek(times[i & 4095], state.data());
+  });
+  remove(path);
+
+  printf("%zu frames of %zu bodies, recorded in %.3f s\n", p.get_frame_count(), p.get_bodies(), record_seconds);
+  printf("recording %.2f MiB, replay %.2f MiB (%.2fx), encoded in %.3f s\n",
+         raw / 1048576.0, p.get_bytes() / 1048576.0, (double)raw / p.get_bytes(), encode_seconds);
+  printf("max position error %.2e over positions up to %.2e\n", worst, extent);
+  printf("seek %.1f ns (%.1f ns per body)\n", seek_seconds / seeks * 1e9, seek_seconds / seeks / p.get_bodies() * 1e9);
+}
+
+static bench_suite suite("replay", run);
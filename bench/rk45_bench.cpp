@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "integrator.hpp"
+
+// particles launched by stiff push-only springs across a floor they
+// bounce along, run for two seconds. the release lasts a few hundredths
+// of a second and the bounces are instants, the flight between them is
+// smooth. runge-kutta 4 at fixed steps is compared with dormand-prince at
+// falling tolerances by the derivative evaluations spent, the steps the
+// adaptive solver kept and threw away, and the worst distance from a
+// reference run of runge-kutta 4 at a hundredth of the tick. the bounces
+// are resolved at step ends, so the reference itself is only good to a
+// centimetre or so
+
+static const int launchers = 8;
+static const float duration = 2.0f;
+// tick the solvers are called with, as numeric does
+static const float tick = 1.0f / 120.0f;
+
+static void launch(ode_system& s) {
+  s = ode_system();
+  s.restitution = 0.5f;
+  s.contacts.push_back({ glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f) });
+  const glm::vec3 direction = glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f));
+  for (int i = 0; i < launchers; i++) {
+    glm::vec3 anchor(0.0f, 0.0f, i * 0.5f);
+    // compressed from a fifth to a half of the natural length
+    float compression = 0.2f + 0.3f * i / (launchers - 1);
+    int p = s.add_particle(anchor + direction * (1.0f - compression), glm::vec3(0.0f), 1.0f, 0.1f);
+    ode_system::link l;
+    l.a = p;
+    l.b = -1;
+    l.anchor = anchor;
+    l.rest_length = 1.0f;
+    l.stiffness = 1000.0f;
+    l.push_only = true;
+    s.links.push_back(l);
+  }
+}
+
+static float distance(const ode_system& a, const ode_system& b) {
+  float worst = 0.0f;
+  for (size_t i = 0; i < a.size(); i++)
+    worst = std::max(worst, glm::length(a.particles.position.get(i) - b.particles.position.get(i)));
+  return worst;
+}
+
+// run 'solver' over the duration in calls of 'dt'
+static double run_for(integrator& solver, ode_system& s, float dt) {
+  const int steps = (int)(duration / dt + 0.5f);
+  return time_seconds([&] {
+    for (int i = 0; i < steps; i++)
+      solver.step(s, dt);
+  });
+}
+
+static void run() {
+  ode_system reference;
+  launch(reference);
+  rk4 exact;
+  run_for(exact, reference, tick / 100.0f);
+
+  printf("%d particles for %.0f s, times in ms\n", launchers, duration);
+  printf("%16s %10s %12s %10s %10s %10s %10s\n", "solver", "step/tol", "evaluations", "accepted", "rejected", "time",
+         "error");
+  ode_system s;
+  for (int split : {1, 4, 16}) {
+    launch(s);
+    rk4 solver;
+    double seconds = run_for(solver, s, tick / split);
+    long steps = (long)(duration / tick + 0.5f) * split;
+    printf("%16s %10.2e %12ld %10ld %10s %10.2f %10.2e\n", "runge-kutta 4", tick / split, 4 * steps, steps, "-",
+           seconds * 1e3, distance(s, reference));
+  }
+  for (float tolerance : {1e-2f, 1e-3f, 1e-4f, 1e-5f}) {
+    launch(s);
+    dormand_prince solver(tolerance);
+    double seconds = run_for(solver, s, tick);
+    printf("%16s %10.2e %12lu %10lu %10lu %10.2f %10.2e\n", "dormand-prince", tolerance, solver.evaluations,
+           solver.accepted, solver.rejected, seconds * 1e3, distance(s, reference));
+  }
+  // the steps of one tolerance, long in flight and short at the release
+  launch(s);
+  dormand_prince solver(1e-4f);
+  run_for(solver, s, tick);
+  printf("steps at 1e-4 from %.2e to %.2e s\n", solver.smallest_step, solver.largest_step);
+}
+
+static bench_suite suite("rk45", run);
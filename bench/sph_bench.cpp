@@ -0,0 +1,66 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "sph.hpp"
+#include "thread_pool.hpp"
+
+// a dam break, a cube of fluid let go in the corner of a box twice its
+// width, stepped at the stable step length. reports the time per step with
+// and without the pool, the neighbours each particle found and the mean
+// density over rest as the fluid settles, which should stay near 1
+
+static const float smoothing = 0.1f;
+
+// side^3 particles in the corner of a box of planes
+static void dam(int side, sph_fluid& fluid) {
+  fluid = sph_fluid();
+  fluid.smoothing_length = smoothing;
+  const float width = side * smoothing * 0.5f;
+  // ten times the fastest the falling water gets
+  fluid.stiffness = 100.0f * 2.0f * 9.8f * width;
+  fluid.viscosity = 0.5f;
+  fluid.add_block(glm::vec3(0.0f), glm::vec3(width));
+  const glm::vec3 planes[][2] = {
+    { glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+    { glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f) },
+    { glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+    { glm::vec3(2.0f * width, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+    { glm::vec3(0.0f, 0.0f, width), glm::vec3(0.0f, 0.0f, -1.0f) },
+  };
+  for (const glm::vec3* p : planes)
+    fluid.contacts.push_back({ p[0], p[1] });
+}
+
+static double mean_density(const sph_fluid& fluid) {
+  double sum = 0.0;
+  for (float d : fluid.density)
+    sum += d;
+  return sum / fluid.size() / fluid.rest_density;
+}
+
+static void run() {
+  thread_pool pool;
+  printf("%u threads, step times in ms\n", pool.get_thread_count());
+  printf("%8s %6s %10s %10s %10s %12s %10s\n", "fluid", "steps", "dt", "step", "step pool", "neighbours", "density");
+  sph_fluid fluid;
+  for (int side : {20, 40, 80}) {
+    const int steps = side < 80 ? 40 : 8;
+    double serial = 0.0, pooled = 0.0;
+    for (bool use_pool : {false, true}) {
+      dam(side, fluid);
+      fluid.pool = use_pool ? &pool : NULL;
+      const float dt = fluid.stable_step();
+      double seconds = time_seconds([&] {
+        for (int i = 0; i < steps; i++)
+          fluid.step(dt);
+      });
+      (use_pool ? pooled : serial) = seconds / steps;
+    }
+    printf("%8zu %6d %10.5f %10.2f %10.2f %12.1f %10.3f\n", fluid.size(), steps, fluid.stable_step(), serial * 1e3,
+           pooled * 1e3, (double)fluid.neighbours / fluid.size(), mean_density(fluid));
+  }
+}
+
+static bench_suite suite("sph", run);
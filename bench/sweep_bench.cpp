@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "bench.hpp"
+#include "sweep.hpp"
+#include "thread_pool.hpp"
+
+// closed form sweeps against a scalar loop over the same formulas
+// error is the largest difference relative to the reference magnitude
+
+static const size_t cases = 1 << 20;
+static const float gravity = 9.8f;
+
+static void fill(std::vector<float>& v, float from, float to, std::mt19937& rng) {
+  std::uniform_real_distribution<float> d(from, to);
+  for (float& x : v)
+    x = d(rng);
+}
+
+static double error(const std::vector<float>& a, const std::vector<double>& reference) {
+  double worst = 0.0;
+  for (size_t i = 0; i < a.size(); i++)
+    worst = std::max(worst, std::abs(a[i] - reference[i]) / std::max(1.0, std::abs(reference[i])));
+  return worst;
+}
+
+static void report(const char* name, double scalar, double simd, double pooled, double err) {
+  printf("%-12s %12.1f %12.1f %12.1f %10.2f %10.2f %12.2e\n", name,
+         cases / scalar / 1e6, cases / simd / 1e6, cases / pooled / 1e6, scalar / simd, scalar / pooled, err);
+}
+
+static void run_pp(thread_pool& pool) {
+  pp_sweep<float> s;
+  s.resize(cases);
+  std::mt19937 rng(1);
+  fill(s.mass, 0.5f, 5.0f, rng);
+  fill(s.force, 0.0f, 20.0f, rng);
+  fill(s.u_velocity, 0.0f, 5.0f, rng);
+  fill(s.rotation, 0.0f, M_PI / 2, rng);
+  fill(s.time, 0.0f, 5.0f, rng);
+  s.gravity = gravity;
+  std::vector<double> reference(cases);
+  double scalar = time_seconds([&] {
+    for (size_t i = 0; i < cases; i++) {
+      double r = ((s.force[i] - s.mass[i]*gravity*std::sin(s.rotation[i]))/2*s.mass[i])*s.time[i]*s.time[i] + s.u_velocity[i]*s.time[i];
+      reference[i] = r;
+    }
+  });
+  // untimed first run allocates the outputs
+  s.run();
+  double simd = time_seconds([&] { s.run(); });
+  double pooled = time_seconds([&] { s.run(&pool); });
+  report("pp", scalar, simd, pooled, error(s.displacement, reference));
+}
+
+static void run_spp(thread_pool& pool) {
+  spp_sweep<float> s;
+  s.resize(cases);
+  std::mt19937 rng(2);
+  fill(s.mass, 0.5f, 5.0f, rng);
+  fill(s.force, 10.0f, 30.0f, rng);
+  fill(s.u_velocity, 0.1f, 2.0f, rng);
+  fill(s.rotation, 0.0f, M_PI / 2, rng);
+  fill(s.length, 0.5f, 2.0f, rng);
+  fill(s.elasticity, 5.0f, 20.0f, rng);
+  fill(s.time, 0.0f, 3.0f, rng);
+  for (size_t i = 0; i < cases; i++)
+    s.extension[i] = s.length[i] * 0.5f;
+  s.gravity = gravity;
+  std::vector<double> reference(cases), reference_end(cases);
+  double scalar = time_seconds([&] {
+    for (size_t i = 0; i < cases; i++) {
+      float m = s.mass[i], l = s.length[i], k = s.elasticity[i], e = s.extension[i], u = s.u_velocity[i], t = s.time[i];
+      float drive = s.force[i] - m*gravity*std::sin(s.rotation[i]);
+      float n = (l/k)*(k + drive);
+      float p = l - e - n;
+      float z = std::sqrt(k/(m*l));
+      float r = p*std::cos(z*t) + u*std::sin(z*t) + n;
+      float end = (std::asin((p + e)/std::sqrt(p*p + u*u)) - std::atan(p/u))/z;
+      if (t > end) {
+        float v = -z*p*std::sin(z*end) + z*u*std::cos(z*end);
+        float a = drive/m;
+        r = (a/2.0f)*t*t + (v - end*a)*t + l - end*end*a/2.0f - end*(v - end*a);
+      }
+      reference[i] = r;
+      reference_end[i] = end;
+    }
+  });
+  // untimed first run allocates the outputs
+  s.run();
+  double simd = time_seconds([&] { s.run(); });
+  double pooled = time_seconds([&] { s.run(&pool); });
+  report("spp", scalar, simd, pooled,
+         std::max(error(s.displacement, reference), error(s.end_time, reference_end)));
+}
+
+static void run_ppp(thread_pool& pool) {
+  ppp_sweep<float> s;
+  s.resize(cases);
+  std::mt19937 rng(3);
+  fill(s.mass1, 0.5f, 5.0f, rng);
+  fill(s.mass2, 0.5f, 5.0f, rng);
+  fill(s.u_velocity1, 0.5f, 5.0f, rng);
+  fill(s.u_velocity2, 0.5f, 5.0f, rng);
+  fill(s.distance, 5.0f, 20.0f, rng);
+  fill(s.time, 0.0f, 10.0f, rng);
+  std::vector<double> reference(cases), reference_v1(cases), reference_v2(cases);
+  double scalar = time_seconds([&] {
+    for (size_t i = 0; i < cases; i++) {
+      float m1 = s.mass1[i], m2 = s.mass2[i], u1 = s.u_velocity1[i], u2 = s.u_velocity2[i];
+      float d = s.distance[i], t = s.time[i];
+      float ct = ((d*s.radius1 - s.radius1 - s.radius2)/s.radius1)/(u1 + u2);
+      float v1 = (u1*m1 - u2*m2 - s.restitution*m2*(u1 + u2))/(m1 + m2);
+      float v2 = (u1*m1 - u2*m2 + s.restitution*m1*(u1 + u2))/(m1 + m2);
+      float r1 = u1*t - d/2.0f;
+      if (t > ct)
+        r1 = v1*(t - ct) + u1*ct - d/2.0f;
+      reference[i] = r1;
+      reference_v1[i] = v1;
+      reference_v2[i] = v2;
+    }
+  });
+  // untimed first run allocates the outputs
+  s.run();
+  double simd = time_seconds([&] { s.run(); });
+  double pooled = time_seconds([&] { s.run(&pool); });
+  double err = std::max(error(s.displacement1, reference), std::max(error(s.v1, reference_v1), error(s.v2, reference_v2)));
+  report("ppp", scalar, simd, pooled, err);
+}
+
+static void run() {
+  thread_pool pool;
+  printf("%zu cases, %u threads, rates in million cases/s\n", cases, pool.get_thread_count());
+  printf("%-12s %12s %12s %12s %10s %10s %12s\n", "formula", "scalar", "simd", "simd+pool",
+         "simd x", "pool x", "max error");
+  run_pp(pool);
+  run_spp(pool);
+  run_ppp(pool);
+}
+
+static bench_suite suite("sweep", run);
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+#include "bench.hpp"
+#include "integrator.hpp"
+
+// a string of springs stretched between two anchors and plucked, run for
+// ten minutes of simulated time with no contacts to take energy out.
+// reports the largest relative energy error seen and the wall clock cost
+// of each integrator at each step length. the symplectic methods hold the
+// error bounded at any step they are stable at while runge-kutta 4 loses
+// energy steadily. positions and velocities are kept in float, so every
+// method stops improving at a few 1e-6 whatever the step, and yoshida 4
+// only falls faster than verlet above that floor. the summary gives the
+// floor and the longest step each method needs to stay under 'target',
+// the step yoshida 4 gains on verlet is capped by the floor, not dt^4
+
+static const int links = 32;
+static const float stiffness = 100.0f;
+static const float duration = 600.0f;
+static const float spacing = 0.12f;
+// energy error the steps are compared at, a little above the float floor
+static const double target = 1e-5;
+
+static void string(ode_system& s) {
+  s = ode_system();
+  s.gravity = glm::vec3(0.0f);
+  auto join = [&](int a, int b, glm::vec3 anchor) {
+    ode_system::link l;
+    l.a = a;
+    l.b = b;
+    l.anchor = anchor;
+    l.rest_length = 0.1f;
+    l.stiffness = stiffness;
+    l.push_only = false;
+    s.links.push_back(l);
+  };
+  for (int i = 0; i < links - 1; i++) {
+    // plucked a third of the way along, the tension keeps every spring
+    // stretched through the swing
+    float t = (i + 1) / (float)links;
+    float lift = 0.3f * (t < 1.0f / 3.0f ? t * 3.0f : (1.0f - t) * 1.5f);
+    s.add_particle(glm::vec3((i + 1) * spacing, lift, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f * lift), 1.0f, 0.05f);
+    join(i, i == 0 ? -1 : i - 1, glm::vec3(0.0f));
+  }
+  join(links - 2, -1, glm::vec3(links * spacing, 0.0f, 0.0f));
+}
+
+// kinetic, gravitational and spring energy
+static double energy(const ode_system& s) {
+  double e = 0.0;
+  for (size_t i = 0; i < s.size(); i++) {
+    glm::vec3 x = s.particles.position.get(i);
+    glm::vec3 v = s.particles.velocity.get(i);
+    e += 0.5 * s.particles.mass[i] * glm::dot(v, v) - s.particles.mass[i] * glm::dot(s.gravity, x);
+  }
+  for (const ode_system::link& l : s.links) {
+    glm::vec3 other = l.b < 0 ? l.anchor : s.particles.position.get(l.b);
+    double extension = glm::length(s.particles.position.get(l.a) - other) - l.rest_length;
+    e += 0.5 * l.stiffness * extension * extension;
+  }
+  return e;
+}
+
+static void run() {
+  std::unique_ptr<integrator> methods[] = {
+    std::unique_ptr<integrator>(new euler()),
+    std::unique_ptr<integrator>(new verlet()),
+    std::unique_ptr<integrator>(new yoshida4()),
+    std::unique_ptr<integrator>(new rk4()),
+  };
+  // acceleration evaluations each method spends per step
+  const int evaluations[] = { 1, 1, 3, 4 };
+  printf("%d springs for %.0f s of simulated time\n", links, duration);
+  printf("%-22s %10s %12s %10s %14s\n", "integrator", "dt", "evaluations", "time s", "energy error");
+  const float steps_tried[] = { 1.0f / 15.0f, 1.0f / 30.0f, 1.0f / 60.0f, 1.0f / 120.0f };
+  double errors[4][4];
+  ode_system s;
+  for (int m = 0; m < 4; m++) {
+    integrator* method = methods[m].get();
+    for (int d = 0; d < 4; d++) {
+      const float dt = steps_tried[d];
+      string(s);
+      method->reset();
+      const double start = energy(s);
+      const int steps = (int)(duration / dt + 0.5f);
+      // sampled every tenth of a second, the error peaks inside a swing
+      const int sample = std::max(1, (int)(0.1f / dt + 0.5f));
+      double worst = 0.0;
+      double seconds = time_seconds([&] {
+        for (int i = 1; i <= steps; i++) {
+          method->step(s, dt);
+          if (i % sample == 0)
+            worst = std::max(worst, std::fabs(energy(s) - start));
+        }
+      });
+      errors[m][d] = std::isfinite(worst) ? worst / std::fabs(start) : INFINITY;
+      printf("%-22s %10.5f %12d %10.3f %14.3e\n", method->get_name(), dt, steps * evaluations[m], seconds,
+             errors[m][d]);
+    }
+  }
+  double least = INFINITY;
+  for (int m = 0; m < 4; m++) {
+    for (int d = 0; d < 4; d++)
+      least = std::min(least, errors[m][d]);
+  }
+  printf("\nleast error of any run %.1e, the float rounding floor\n", least);
+  printf("longest step under %.0e:", target);
+  for (int m = 0; m < 4; m++) {
+    int d = 0;
+    while (d < 4 && errors[m][d] >= target)
+      d++;
+    if (d < 4)
+      printf("  %s 1/%.0f s", methods[m]->get_name(), 1.0f / steps_tried[d]);
+    else
+      printf("  %s none", methods[m]->get_name());
+  }
+  printf("\n");
+}
+
+static bench_suite suite("symplectic", run);
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "track.hpp"
+
+// a particle let go on chains of planes, evaluated at 1/60 s frames until
+// it leaves the chain. a straight slope cut into many planes has a known
+// answer, so the worst distance from it shows what crossing the joints
+// costs in accuracy, next to semi-implicit euler at 1/120 s on the same
+// slope. a staircase makes it fly off every step and land on the next.
+// reports the mean and worst frame time and the pieces worked out
+
+static const double gravity = 9.8;
+static const double dt = 1.0 / 60.0;
+
+static void slope(int planes, plane_track& t) {
+  t = plane_track();
+  for (int k = 0; k < planes; k++)
+    t.add(0.3, 1.0, glm::dvec3(0.0));
+  t.acceleration = glm::dvec3(0.0, -gravity, 0.0);
+  t.launch(0, 0.0, 0.0);
+}
+
+// each step one long and half as deep, the risers straight down
+static void staircase(int steps, plane_track& t) {
+  t = plane_track();
+  for (int k = 0; k < steps; k++) {
+    t.add(0.0, 1.0, glm::dvec3(0.0));
+    t.add(M_PI / 2, 0.5, glm::dvec3(0.0));
+  }
+  t.acceleration = glm::dvec3(0.0, -gravity, 0.0);
+  t.launch(0, 0.0, 2.0);
+}
+
+static void run() {
+  printf("frames of 1/60 s, frame times in ns\n");
+  printf("%10s %8s %8s %10s %10s %10s %10s %10s\n", "chain", "planes", "frames", "frame", "max frame", "pieces",
+         "error", "euler");
+  const double along = gravity * std::sin(0.3);
+  const glm::dvec3 down(std::cos(0.3), -std::sin(0.3), 0.0);
+  plane_track t;
+  for (bool stairs : {false, true}) {
+    for (int planes : {10, 100, 1000}) {
+      if (stairs)
+        staircase(planes / 2, t);
+      else
+        slope(planes, t);
+      // the slope is left once the particle covers its length, the
+      // staircase once it is past the last step
+      const double duration = std::sqrt(2.0 * planes / along);
+      double total = 0.0, worst = 0.0, error = 0.0, euler = 0.0;
+      double s = 0.0, w = 0.0;
+      int frames = 0;
+      glm::dvec3 p(0.0);
+      while (stairs ? p.x <= planes / 2 : frames * dt <= duration) {
+        const double time = frames * dt;
+        double seconds = time_seconds([&] { p = t.position(time); });
+        total += seconds;
+        worst = std::max(worst, seconds);
+        frames++;
+        if (stairs)
+          continue;
+        double exact = 0.5 * along * time * time;
+        error = std::max(error, glm::length(p - down * exact));
+        euler = std::max(euler, std::fabs(s - exact));
+        for (int k = 0; k < 2; k++) {
+          w += along * dt / 2;
+          s += w * dt / 2;
+        }
+      }
+      printf("%10s %8d %8d %10.1f %10.1f %10zu", stairs ? "staircase" : "slope", planes, frames,
+             total / frames * 1e9, worst * 1e9, t.get_pieces());
+      if (stairs)
+        printf(" %10s %10s\n", "-", "-");
+      else
+        printf(" %10.2e %10.2e\n", error, euler);
+    }
+  }
+}
+
+static bench_suite suite("track", run);
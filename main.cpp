@@ -165,6 +165,8 @@ int main() {
   // create simulation environment
   DEBUG_TEXT("creating simulation environment")
   environment env(window);
+  // simulations follow the environment camera
+  simulation::view = &environment::current_camera;
 
   // initialise delta timestamp
   timestamp delta;
@@ -178,9 +180,8 @@ int main() {
     // show gui
     GUI::show(env);
 
-    // update
+    // update, objects and camera
     env.update(delta.get_elapsed_time());
-    environment::current_camera.update();
 
     // timestamp before drawing the frame
     delta.begin();
@@ -0,0 +1,202 @@
+#include "body.hpp"
+#include <algorithm>
+#include "integrator.hpp"
+#include "simulation.hpp"
+#include "utils.h"
+
+// spring
+float spring_body::coil_width = 0.3f;
+int spring_body::coils = 12;
+
+// world
+world_body::~world_body() { delete current_simulation; }
+
+void world_body::start_simulation() {
+  DEBUG_TEXT("world initiating simulation");
+  substep_scheduler& scheduler = current_simulation->get_scheduler();
+  scheduler.max_substep = max_substep;
+  scheduler.budget = substep_budget;
+  scheduler.reset();
+  current_simulation->start();
+}
+
+void world_body::end_simulation() {
+  current_simulation->end();
+}
+
+bool world_body::add_particle(particle_body* particle) {
+  m_particles.push_back(particle);
+  if (!simulation_objects.pa1) {
+    simulation_objects.pa1 = particle;
+  } else if (!simulation_objects.pa2) {
+    simulation_objects.pa2 = particle;
+  } else {
+    return false;
+  }
+  DEBUG_TEXT("particle added to simulation state")
+  return true;
+}
+
+bool world_body::add_plane(plane_body* plane) {
+  m_planes.push_back(plane);
+  if (simulation_objects.pl)
+    return false;
+  simulation_objects.pl = plane;
+  DEBUG_TEXT("plane added to simulation state")
+  return true;
+}
+
+bool world_body::add_spring(spring_body* spring) {
+  m_springs.push_back(spring);
+  if (simulation_objects.sp)
+    return false;
+  simulation_objects.sp = spring;
+  DEBUG_TEXT("spring added to simulation state")
+  return true;
+}
+
+void world_body::add_point(point_body* point) {
+  m_points.push_back(point);
+  DEBUG_TEXT("point added to simulation state")
+}
+
+void world_body::add_fluid(fluid_body* fluid) {
+  m_fluids.push_back(fluid);
+  DEBUG_TEXT("fluid added to simulation state")
+}
+
+integrator* world_body::create_integrator() const {
+  switch (solver) {
+    case SOLVER::EULER:
+      return new euler();
+    case SOLVER::VERLET:
+      return new verlet();
+    case SOLVER::RK4:
+      return new rk4();
+    case SOLVER::IMPLICIT:
+      return new implicit_euler();
+    case SOLVER::PBD:
+      return new pbd(constraint_iterations);
+    case SOLVER::CONSTRAINED:
+      return new constrained_euler(constraint_iterations);
+    case SOLVER::RK45:
+      return new dormand_prince(tolerance);
+    case SOLVER::YOSHIDA4:
+      return new yoshida4();
+    case SOLVER::ANALYTIC:
+    case SOLVER::EVENTS:
+    case SOLVER::MODES:
+    case SOLVER::KEPLER:
+    default:
+      return NULL;
+  }
+}
+
+bool world_body::create_simulation() {
+  // decide which simulation to set up based on the available objects
+  if (!m_fluids.empty()) {
+    DEBUG_TEXT("simulation state set to fluid")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new hydrodynamic(this);
+  } else if (solver == SOLVER::EVENTS && !m_particles.empty()) {
+    DEBUG_TEXT("simulation state set to event driven")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new event_driven(this);
+  } else if (solver == SOLVER::MODES && !m_particles.empty()) {
+    // the eigen solve is dense, large networks have no legal simulation
+    if (m_particles.size() > spring_modes::max_particles) {
+      delete current_simulation;
+      current_simulation = NULL;
+      return false;
+    }
+    DEBUG_TEXT("simulation state set to normal modes")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new modal(this);
+  } else if (solver == SOLVER::KEPLER && !m_particles.empty()) {
+    DEBUG_TEXT("simulation state set to kepler orbits")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new orbital(this);
+  } else if (solver != SOLVER::ANALYTIC && !m_particles.empty()) {
+    DEBUG_TEXT("simulation state set to numerical integration")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new numeric(this, create_integrator());
+  } else if (m_particles.size() == 1 && m_springs.empty() && m_planes.size() > 1) {
+    DEBUG_TEXT("simulation state set to particle and chain of planes")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new piecewise(this, m_particles[0]);
+  } else if (simulation_objects.pa1 && simulation_objects.pl && simulation_objects.sp) {
+    DEBUG_TEXT("simulation state set to spring, particle and plane")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new spp(this, simulation_objects.pa1, simulation_objects.pl, simulation_objects.sp);
+  } else if (simulation_objects.pa1 && simulation_objects.pa2 && simulation_objects.pl) {
+    DEBUG_TEXT("simulation state set to particle and particle and plane")
+        if (current_simulation) {
+            delete current_simulation;
+            current_simulation = NULL;
+        }
+    current_simulation = new ppp(this, simulation_objects.pa1, simulation_objects.pa2, simulation_objects.pl);
+  } else if (simulation_objects.pa1 && simulation_objects.pl) {
+      DEBUG_TEXT("simulation state set to particle and plane")
+          if (current_simulation) {
+              delete current_simulation;
+              current_simulation = NULL;
+          }
+      current_simulation = new pp(this, simulation_objects.pa1, simulation_objects.pl);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void world_body::remove_body(body* child) {
+  m_particles.erase(std::remove(m_particles.begin(), m_particles.end(), child), m_particles.end());
+  m_planes.erase(std::remove(m_planes.begin(), m_planes.end(), child), m_planes.end());
+  m_springs.erase(std::remove(m_springs.begin(), m_springs.end(), child), m_springs.end());
+  m_points.erase(std::remove(m_points.begin(), m_points.end(), child), m_points.end());
+  m_fluids.erase(std::remove(m_fluids.begin(), m_fluids.end(), child), m_fluids.end());
+  // springs left hanging from the removed body lose that end
+  for (spring_body* s : m_springs) {
+    if (s->end_a == child)
+      s->end_a = NULL;
+    if (s->end_b == child)
+      s->end_b = NULL;
+  }
+  if (child == simulation_objects.pa1)
+    simulation_objects.pa1 = NULL;
+  else if (child == simulation_objects.pa2)
+      simulation_objects.pa2 = NULL;
+  else if (child == simulation_objects.pl)
+    simulation_objects.pl = NULL;
+  else if (child == simulation_objects.sp)
+    simulation_objects.sp = NULL;
+
+  if (current_simulation) {
+      delete current_simulation;
+      current_simulation = NULL;
+  }
+  if (!create_simulation()) {
+    current_simulation = NULL;
+  }
+  DEBUG_TEXT("child removed from simulation context")
+}
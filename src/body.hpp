@@ -0,0 +1,212 @@
+#ifndef BODY_H
+#define BODY_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "utils.h"
+
+class simulation;
+class integrator;
+class thread_pool;
+
+// physics state shared by every simulated object
+// holds no render or gui data so simulations can run without a window
+class body {
+public:
+  glm::vec3 position;
+  body() : position(0.0f) {}
+  virtual ~body() {}
+  // move to a location
+  // headless bodies snap straight to the destination, drawn objects animate
+  virtual void move_to(glm::vec3 location) { position = location; }
+};
+
+// plane state
+class plane_body : public virtual body {
+  float m_plane_scale;
+public:
+  // custom orientation and length, the plane spans length*scale
+  float rotation;
+  float length;
+  plane_body(float scale = 1.0f) : m_plane_scale(scale), rotation(3*M_PI/8), length(3.0f) {}
+  float get_scale() const { return m_plane_scale; }
+};
+
+// particle state
+class particle_body : public virtual body {
+  float m_radius;
+public:
+  // editable values
+  float force;
+  float mass;
+  float u_velocity;
+  particle_body(float radius) : m_radius(radius), force(0.0f), mass(1.0f), u_velocity(0.0f) {}
+  // get radius size
+  float get_radius() const { return m_radius; };
+};
+
+// fixed point state
+// a node springs can hang from, never moved by a simulation
+class point_body : public virtual body {};
+
+// spring state
+class spring_body : public virtual body {
+  float m_spring_scale;
+public:
+  // editable values
+  float length;
+  float extension;
+  float elasticity;
+  float rotation;
+  // particles or points the spring joins in a network, see numeric
+  // a spring with neither end set pushes the particle of the same index
+  body* end_a;
+  body* end_b;
+  // under the CONSTRAINED solver a rigid network spring is a rod held at
+  // the length it starts at, and a hinged one swings only about hinge_axis
+  bool rigid;
+  bool hinged;
+  glm::vec3 hinge_axis;
+  // globals
+  static float coil_width;
+  static int coils;
+  spring_body(float scale)
+      : m_spring_scale(scale),
+        length(1.0f),
+        extension(0.5f),
+        elasticity(9.8f),
+        rotation(0.0f),
+        end_a(NULL),
+        end_b(NULL),
+        rigid(false),
+        hinged(false),
+        hinge_axis(0.0f, 0.0f, 1.0f) {}
+  float get_scale() const { return m_spring_scale; }
+};
+
+// fluid state, a block of sph fluid centred on its position
+class fluid_body : public virtual body {
+public:
+  // editable values
+  glm::vec3 size;
+  float smoothing_length;
+  float rest_density;
+  float stiffness;
+  float viscosity;
+  // particles of the block while simulating, every so many of them so
+  // there are no more than max_samples
+  std::vector<glm::vec3> samples;
+  static constexpr size_t max_samples = 4096;
+  fluid_body()
+      : size(40.0f),
+        smoothing_length(4.0f),
+        rest_density(1.0f),
+        stiffness(80000.0f),
+        viscosity(1.0f) {}
+};
+
+// world state, owns the simulation built from its bodies
+class world_body : public virtual body {
+public:
+  // how create_simulation advances the world
+  // a world holding fluid always runs the fluid simulation, otherwise
+  // ANALYTIC picks one of the closed form pp, spp and ppp simulations, or
+  // piecewise for a lone particle, without springs, on several planes,
+  // EVENTS jumps between predicted impacts, the others step every body
+  // with a numerical integrator, IMPLICIT solving the springs backward,
+  // PBD projecting them as constraints, CONSTRAINED holding rigid
+  // springs as rods, RK45 choosing its own step lengths and YOSHIDA4
+  // keeping the energy of long runs. MODES sums the normal modes of the
+  // spring network in closed form and KEPLER solves every particle's orbit
+  // about a central mass
+  enum SOLVER { ANALYTIC, EULER, VERLET, RK4, EVENTS, IMPLICIT, PBD, CONSTRAINED, RK45, YOSHIDA4, MODES, KEPLER };
+
+protected:
+  struct {
+    particle_body* pa1;
+    particle_body* pa2;
+    plane_body* pl;
+    spring_body* sp;
+  } simulation_objects;
+  // every registered body, in insertion order
+  std::vector<particle_body*> m_particles;
+  std::vector<plane_body*> m_planes;
+  std::vector<spring_body*> m_springs;
+  std::vector<point_body*> m_points;
+  std::vector<fluid_body*> m_fluids;
+  simulation* current_simulation;
+
+public:
+  // simulation data
+  float time_scale;
+  float distance;
+  float friction;
+  float gravity;
+  float restitution;
+  world_body::SOLVER solver;
+  // sub-step length and per frame budget handed to the simulation's
+  // scheduler on start, see scheduler.hpp
+  float max_substep;
+  unsigned int substep_budget;
+  // constraint iterations per step of the PBD and CONSTRAINED solvers
+  unsigned int constraint_iterations;
+  // error allowed per step of the RK45 solver
+  float tolerance;
+  // particles also attract each other under the stepped solvers, see
+  // gravity_tree.hpp, on top of the uniform 'gravity'
+  bool mutual_gravity;
+  float gravitational_constant;
+  float opening_angle;
+  // mass at the world's position the particles orbit under KEPLER
+  float central_mass;
+  // pool the simulation's solvers split their work across, NULL runs
+  // them on the calling thread. it must not be the pool the world itself
+  // is stepped from
+  thread_pool* pool;
+  world_body()
+      : time_scale(1.0f),
+        distance(1.0f),
+        friction(0.0f),
+        gravity(9.8f),
+        restitution(0.5f),
+        solver(SOLVER::ANALYTIC),
+        max_substep(1.0f / 120.0f),
+        substep_budget(4096),
+        constraint_iterations(10),
+        tolerance(1e-4f),
+        mutual_gravity(false),
+        gravitational_constant(1.0f),
+        opening_angle(0.5f),
+        central_mass(1000.0f),
+        pool(NULL)
+  { simulation_objects = {NULL, NULL, NULL, NULL};
+    current_simulation = NULL; }
+  ~world_body();
+
+  void start_simulation();
+  void end_simulation();
+  // register bodies with the simulation state
+  // every body is kept for the numerical solvers, returns false if the
+  // analytic simulations already hold a body in every matching slot
+  bool add_particle(particle_body* particle);
+  bool add_plane(plane_body* plane);
+  bool add_spring(spring_body* spring);
+  // points only anchor spring networks, never an analytic simulation
+  void add_point(point_body* point);
+  void add_fluid(fluid_body* fluid);
+  void remove_body(body* child);
+  bool create_simulation();
+  // new integrator matching 'solver', NULL for ANALYTIC and EVENTS
+  integrator* create_integrator() const;
+
+  bool can_simulate() const { return current_simulation != NULL; } 
+  simulation* get_simulation() const { return current_simulation; }
+  const std::vector<particle_body*>& get_particles() const { return m_particles; }
+  const std::vector<plane_body*>& get_planes() const { return m_planes; }
+  const std::vector<spring_body*>& get_springs() const { return m_springs; }
+  const std::vector<point_body*>& get_points() const { return m_points; }
+  const std::vector<fluid_body*>& get_fluids() const { return m_fluids; }
+};
+
+#endif // !BODY_H
@@ -0,0 +1,55 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "simulation.hpp"
+
+// camera class
+// generates view matrix for draw phase
+class camera {
+  // motion modes
+  enum MODE { STILL, FOCUS, TRACK };
+  glm::vec3 m_position;
+  glm::vec3 m_start;
+  glm::vec3 m_focus_point;
+  glm::vec3 *m_p_target;
+  timestamp m_timestamp;
+
+  // time taken to reach destination position
+  const double m_total_time = 0.5;
+  camera::MODE m_mode;
+
+  float m_zoom = 8.0f;
+
+public:
+  // zoom level
+  float zoom = 8.0f;
+  camera() {
+    // focus on the zero vector on initialisation
+    glm::vec3 point(0.0f);
+    focus(point);
+  }
+  void snap_to(const glm::vec3& point) {
+      m_position = point;
+  }
+  void focus(const glm::vec3 &point);
+  void track(glm::vec3 *const target);
+
+  void update();
+  
+  glm::vec3 get_position() { return m_position; };
+  // generate view matrix for draw phase
+  glm::mat4 get_view_matrix() const {
+    glm::mat4 view(1.0f);
+    // m_position holds the position of the camera's focus
+    // offset from this location and scale by zoom level
+    glm::vec3 position = m_position + glm::vec3(0, 5, -10) * m_zoom;
+    // transform to focus on the target position
+    view = glm::lookAt(position, m_position, glm::vec3(0.0f, 1.0f, 0.0f));
+    return view;
+  }
+};
+
+#endif // !CAMERA_H
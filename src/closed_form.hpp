@@ -0,0 +1,86 @@
+#ifndef CLOSED_FORM_H
+#define CLOSED_FORM_H
+
+#include <cmath>
+
+// closed form motion of the analytic simulations, templated on the scalar
+// type. each struct is built from the body parameters of a run and then
+// gives the displacement along the plane at any time, the pp, spp and ppp
+// simulations evaluate these in double and the sweeps in either type
+
+// particle on a plane, displacement in particle radii
+template <typename T> struct pp_motion {
+  T acceleration;
+  T u_velocity;
+
+  pp_motion() : acceleration(0), u_velocity(0) {}
+  pp_motion(T mass, T force, T u_velocity, T rotation, T gravity) : u_velocity(u_velocity) {
+    // grouped as the simulation always has, (F - mg sin(rotation))/2*m
+    acceleration = (force - mass*gravity*std::sin(rotation))/2*mass;
+  }
+  T displacement(T t) const { return (acceleration*t + u_velocity)*t; }
+};
+
+// particle pushed along a plane by a spring, displacement in spring coils
+template <typename T> struct spp_motion {
+  // r = p*cos(z*t) + u*sin(z*t) + n on the spring
+  T n, p, z, u;
+  // r = c2*t^2 + c1*t + c0 after it releases at end_time
+  T end_time;
+  T c2, c1, c0;
+  T length;
+
+  spp_motion() : n(0), p(0), z(0), u(0), end_time(0), c2(0), c1(0), c0(0), length(0) {}
+  spp_motion(T mass, T force, T u_velocity, T rotation, T gravity, T length, T extension, T elasticity)
+      : u(u_velocity), length(length) {
+    T drive = force - mass*gravity*std::sin(rotation);
+    // simple harmonic motion about n while the spring pushes
+    n = (length/elasticity)*(elasticity + drive);
+    p = length - extension - n;
+    z = std::sqrt(elasticity/(mass*length));
+    // release once the spring is back at its natural length
+    end_time = (std::asin((p + extension)/std::sqrt(p*p + u*u)) - std::atan(p/u))/z;
+    // constant acceleration from the release velocity afterwards
+    T v = -z*p*std::sin(z*end_time) + z*u*std::cos(z*end_time);
+    T a = drive/mass;
+    c2 = a/2;
+    c1 = v - end_time*a;
+    c0 = length - end_time*end_time*a/2 - end_time*(v - end_time*a);
+  }
+  // position the spring pushes towards, the displacement until release
+  T spring(T t) const { return p*std::cos(z*t) + u*std::sin(z*t) + n; }
+  T displacement(T t) const { return t > end_time ? (c2*t + c1)*t + c0 : spring(t); }
+};
+
+// two particles colliding head on, displacements in radii of particle 1
+// and 2 from the middle of the starting separation
+template <typename T> struct ppp_motion {
+  T collision_time;
+  T u1, u2;
+  // velocities after the collision
+  T v1, v2;
+  T half_distance;
+
+  ppp_motion() : collision_time(0), u1(0), u2(0), v1(0), v2(0), half_distance(0) {}
+  ppp_motion(T mass1, T mass2, T u_velocity1, T u_velocity2, T distance, T radius1, T radius2, T restitution)
+      : u1(u_velocity1), u2(u_velocity2), half_distance(distance/2) {
+    // surfaces meet after covering the gap at the closing speed
+    T closing = u1 + u2;
+    collision_time = ((distance*radius1 - radius1 - radius2)/radius1)/closing;
+    T momentum = u1*mass1 - u2*mass2;
+    v1 = (momentum - restitution*mass2*closing)/(mass1 + mass2);
+    v2 = (momentum + restitution*mass1*closing)/(mass1 + mass2);
+  }
+  void displacement(T t, T& r1, T& r2) const {
+    if (t > collision_time) {
+      T after = t - collision_time;
+      r1 = v1*after + u1*collision_time - half_distance;
+      r2 = v2*after - u2*collision_time + half_distance;
+    } else {
+      r1 = u1*t - half_distance;
+      r2 = -u2*t + half_distance;
+    }
+  }
+};
+
+#endif // !CLOSED_FORM_H
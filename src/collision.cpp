@@ -0,0 +1,100 @@
+#include "collision.hpp"
+#include <cmath>
+
+// spread neighbouring cells across the table
+unsigned int collision_grid::bucket(int ix, int iy, int iz) const {
+  unsigned int h = (unsigned int)ix * 73856093u ^ (unsigned int)iy * 19349663u ^ (unsigned int)iz * 83492791u;
+  // table size is a power of two
+  return h & (unsigned int)(m_bucket_start.size() - 2);
+}
+
+int collision_grid::cell(float v) const {
+  return (int)std::floor(v / m_cell_size);
+}
+
+void collision_grid::build(const particle_store& p) {
+  const size_t n = p.size();
+  // size cells from the largest particle
+  float largest = 0.0f;
+  for (float r : p.radius)
+    if (r > largest)
+      largest = r;
+  m_cell_size = largest > 0.0f ? 2.0f * largest : 1.0f;
+
+  // power of two table with roughly two buckets per particle
+  size_t table = 64;
+  while (table < 2 * n)
+    table <<= 1;
+  m_bucket_start.assign(table + 1, 0);
+  m_particle_bucket.resize(n);
+  m_sorted.resize(n);
+  m_cell_x.resize(n);
+  m_cell_y.resize(n);
+  m_cell_z.resize(n);
+
+  // counting sort of particles into buckets
+  for (size_t i = 0; i < n; i++) {
+    m_cell_x[i] = cell(p.position.x[i]);
+    m_cell_y[i] = cell(p.position.y[i]);
+    m_cell_z[i] = cell(p.position.z[i]);
+    unsigned int b = bucket(m_cell_x[i], m_cell_y[i], m_cell_z[i]);
+    m_particle_bucket[i] = b;
+    m_bucket_start[b + 1]++;
+  }
+  for (size_t b = 0; b < table; b++)
+    m_bucket_start[b + 1] += m_bucket_start[b];
+  std::vector<unsigned int> fill(m_bucket_start.begin(), m_bucket_start.end() - 1);
+  for (size_t i = 0; i < n; i++)
+    m_sorted[fill[m_particle_bucket[i]]++] = (unsigned int)i;
+}
+
+bool collision_grid::respond(particle_store& p, unsigned int i, unsigned int j, float restitution) {
+  glm::vec3 d = p.position.get(j) - p.position.get(i);
+  float reach = p.radius[i] + p.radius[j];
+  float distance2 = glm::dot(d, d);
+  if (distance2 >= reach * reach || distance2 <= 0.0f)
+    return false;
+  float distance = std::sqrt(distance2);
+  glm::vec3 n = d / distance;
+  float wi = p.inv_mass[i], wj = p.inv_mass[j];
+  float w = wi + wj;
+  // push apart in proportion to inverse mass
+  float depth = reach - distance;
+  p.position.add(i, n * (-depth * wi / w));
+  p.position.add(j, n * (depth * wj / w));
+  // restitution impulse along the contact normal
+  float vn = glm::dot(p.velocity.get(j) - p.velocity.get(i), n);
+  if (vn < 0.0f) {
+    float impulse = -(1.0f + restitution) * vn / w;
+    p.velocity.add(i, n * (-impulse * wi));
+    p.velocity.add(j, n * (impulse * wj));
+  }
+  return true;
+}
+
+void collision_grid::resolve(particle_store& p, float restitution) {
+  pair_tests = 0;
+  contacts = 0;
+  const size_t n = m_sorted.size();
+  // walk particles in bucket order so neighbouring lookups stay in cache
+  for (size_t sorted = 0; sorted < n; sorted++) {
+    unsigned int i = m_sorted[sorted];
+    const int cx = m_cell_x[i], cy = m_cell_y[i], cz = m_cell_z[i];
+    for (int dx = -1; dx <= 1; dx++)
+      for (int dy = -1; dy <= 1; dy++)
+        for (int dz = -1; dz <= 1; dz++) {
+          const int x = cx + dx, y = cy + dy, z = cz + dz;
+          unsigned int b = bucket(x, y, z);
+          for (unsigned int s = m_bucket_start[b]; s < m_bucket_start[b + 1]; s++) {
+            unsigned int j = m_sorted[s];
+            // each pair once, and only from the cell the particle is really in
+            // since separate cells can share a bucket
+            if (j <= i || m_cell_x[j] != x || m_cell_y[j] != y || m_cell_z[j] != z)
+              continue;
+            pair_tests++;
+            if (respond(p, i, j, restitution))
+              contacts++;
+          }
+        }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "particle_store.hpp"
+
+// particle against particle collisions using a uniform hash grid
+// cells are as wide as the largest particle, so any touching pair sits
+// in the same or a neighbouring cell and only 27 cells are searched per
+// particle instead of every other particle
+class collision_grid {
+  float m_cell_size;
+  // first sorted entry of each hash bucket, one extra end marker
+  std::vector<unsigned int> m_bucket_start;
+  // particle indices ordered by bucket
+  std::vector<unsigned int> m_sorted;
+  std::vector<unsigned int> m_particle_bucket;
+  // cell coordinates of each particle when the grid was built
+  std::vector<int> m_cell_x, m_cell_y, m_cell_z;
+
+  unsigned int bucket(int ix, int iy, int iz) const;
+  int cell(float v) const;
+  // resolve overlap and approach velocity of one pair
+  bool respond(particle_store& p, unsigned int i, unsigned int j, float restitution);
+
+public:
+  // narrow phase statistics from the last resolve()
+  size_t pair_tests;
+  size_t contacts;
+
+  collision_grid() : m_cell_size(1.0f), pair_tests(0), contacts(0) {}
+  // bin every particle, cell width is twice the largest radius
+  void build(const particle_store& p);
+  // separate overlapping particles and apply a restitution impulse to
+  // pairs moving towards each other, call build() first
+  void resolve(particle_store& p, float restitution);
+  float get_cell_size() const { return m_cell_size; }
+};
+
+#endif // !COLLISION_H
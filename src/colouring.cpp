@@ -0,0 +1,37 @@
+#include "colouring.hpp"
+#include <algorithm>
+
+void constraint_colouring::build(size_t particles, const std::vector<std::pair<int, int>>& ends) {
+  // colours already taken at each particle, kept short by the greedy pick
+  std::vector<std::vector<unsigned int>> taken(particles);
+  std::vector<unsigned int> colour(ends.size());
+  std::vector<unsigned int> count;
+  std::vector<char> used;
+  for (size_t i = 0; i < ends.size(); i++) {
+    // lowest colour free at both ends
+    used.assign(count.size() + 1, 0);
+    for (int e : { ends[i].first, ends[i].second }) {
+      if (e < 0)
+        continue;
+      for (unsigned int c : taken[e])
+        used[c] = 1;
+    }
+    unsigned int c = (unsigned int)(std::find(used.begin(), used.end(), 0) - used.begin());
+    if (c == count.size())
+      count.push_back(0);
+    count[c]++;
+    colour[i] = c;
+    for (int e : { ends[i].first, ends[i].second }) {
+      if (e >= 0)
+        taken[e].push_back(c);
+    }
+  }
+  // bucket the constraints by colour, in their original order within one
+  colour_start.assign(count.size() + 1, 0);
+  for (size_t c = 0; c < count.size(); c++)
+    colour_start[c + 1] = colour_start[c] + count[c];
+  std::vector<unsigned int> fill(colour_start.begin(), colour_start.end() - 1);
+  order.resize(ends.size());
+  for (size_t i = 0; i < ends.size(); i++)
+    order[fill[colour[i]]++] = (unsigned int)i;
+}
@@ -0,0 +1,24 @@
+#ifndef COLOURING_H
+#define COLOURING_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// greedy colouring of constraints between particles
+// no two constraints of one colour share a particle, so every constraint
+// of a colour can be projected at once, each colour after the last. ends
+// below zero are fixed anchors and never conflict
+class constraint_colouring {
+public:
+  // constraint indices grouped by colour, colour c holds
+  // order[colour_start[c]] to order[colour_start[c + 1] - 1]
+  std::vector<unsigned int> order;
+  std::vector<unsigned int> colour_start;
+
+  // colour the constraints joining 'ends' over 'particles' particles
+  void build(size_t particles, const std::vector<std::pair<int, int>>& ends);
+  size_t colours() const { return colour_start.empty() ? 0 : colour_start.size() - 1; }
+};
+
+#endif // !COLOURING_H
@@ -4,83 +4,28 @@
 #include "utils.h"
 
 
-// camera
-
-// enter focus state
-// in focus state, a start and end point are defined
-// the camera will move between these points for the m_total_time seconds 
-void camera::focus(const glm::vec3 &point) {
-  // record current time
-  m_timestamp.begin();
-  // set start and end positions
-  m_focus_point = point;
-  m_start = m_position;
-  // set state
-  m_mode = camera::MODE::FOCUS;
-}
-
-// enter track state
-// in track state, a start point is defined, but the end point 
-// is continuously updated as the target's position vector changes
-// the camera will move between these the start and the target's position vector 
-// for m_total_time seconds after which it will snap to the target's position each frame 
-void camera::track(glm::vec3 *target) {
-  m_timestamp.begin();
-  // set pointer to target's position vector
-  m_p_target = target;
-  m_start = m_position;
-  m_mode = camera::MODE::TRACK;
-}
-
-// camera update function, called every frame
-void camera::update() {
-  // switch state
-  m_zoom = lerp1f(m_zoom, zoom, 0.9f);
-  switch (m_mode) {
-  case camera::MODE::FOCUS: {
-    // take the proportion of time left and smooth it
-    // linear interpolate the result to get the position between the start and end points
-    m_position = lerp3f(m_start, m_focus_point, smooth(m_timestamp.get_elapsed_time() / m_total_time));
-    if (m_timestamp.get_elapsed_time() > m_total_time) {
-      // snap to end point, exit focus state
-      m_position = m_focus_point;
-      m_mode = camera::MODE::STILL;
-    }
-    break;
-  }
-  case camera::MODE::TRACK: {
-    if (!m_p_target) {
-      // if target no longer exists, exit track state
-      m_mode = camera::MODE::STILL;
-    } else {
-      if (m_timestamp.get_elapsed_time() > m_total_time) {
-        // motion time complete, snap to target position
-        m_position = *m_p_target;
-      } else {
-        // linear interpolate between start and target position
-        m_position = lerp3f(m_start, *m_p_target, smooth(m_timestamp.get_elapsed_time() / m_total_time));
-      }
-    }
-    break;
-  }
-  case camera::MODE::STILL:
-  // do nothing
-  default:
-    break;
-  }
-}
-
 // environment constructor
 environment::environment(GLFWwindow *window)
-    : window(window) {
+    : m_simulating(false), window(window), simulate_all(false), record(false),
+      replay_time(0.0f), replay_rate(1.0f), replay_playing(false) {
   // initialise root node to type world 
   objects = tree_node<object*>::create_new(new root());
   // pass world to simulation data
   // initialise selection to NULL state
   selection = NULL;
+  simulation = NULL;
 }
 // environment destructor
 environment::~environment() {
+  // stop physics before the objects it steps are deleted
+  if (m_simulation_thread.joinable()) {
+    m_simulating = false;
+    m_simulation_thread.join();
+  }
+  for (recorder* r : m_recorders)
+    delete r;
+  for (replay* r : m_replays)
+    delete r;
   // delete tree
   tree_node<object*>::destroy(objects);
 };
@@ -89,27 +34,186 @@ environment::~environment() {
 camera environment::current_camera;
 
 // environment update function, called each frame
-// updates all nodes in the object tree
+// during a simulation the simulation thread steps instead
 void environment::update(float delta) {
+  if (m_simulating)
+    return;
+  if (!m_replays.empty()) {
+    // play to either end and stop there
+    if (replay_playing) {
+      float start = get_replay_start(), end = get_replay_end();
+      replay_time = std::max(start, std::min(end, replay_time + delta * replay_rate));
+      if ((replay_rate > 0.0f && replay_time >= end) || (replay_rate < 0.0f && replay_time <= start))
+        replay_playing = false;
+    }
+    for (size_t i = 0; i < m_replays.size(); i++)
+      m_replays[i]->apply(replay_time, m_replayed[i]);
+  }
+  step(delta);
+}
+
+// updates all nodes in the object tree
+void environment::step(float delta) {
+  // advance running simulations in parallel, every job is joined
+  // before the tree update so objects only see finished worlds
+  m_pool.run(m_running.size(), [&](size_t i) {
+    class simulation* sim = m_running[i]->get_simulation();
+    sim->update(delta);
+    if (i < m_recorders.size())
+      m_recorders[i]->capture(sim->get_time());
+  });
   // create tree iterator
   auto itr = objects->get_traversal_state(traversal_state<object*>::MODE::PREORDER);
   // update objects 
   while(itr.next()) {
     itr.get_item()->update(delta);
   }
+  current_camera.update();
+}
+
+void environment::publish_frame() {
+  frame& f = m_frames.back();
+  f.view = current_camera.get_view_matrix();
+  f.models.clear();
+  f.first.resize(m_drawn.size() + 1);
+  for (size_t i = 0; i < m_drawn.size(); i++) {
+    f.first[i] = f.models.size();
+    m_drawn[i]->get_model_matrices(f.models);
+  }
+  f.first[m_drawn.size()] = f.models.size();
+  m_frames.publish();
+}
+
+// simulation thread body
+// steps at the tick rate of the shown simulation's clock
+void environment::simulation_loop() {
+  // paced to the clock of the world being shown
+  world* shown = static_cast<world*>(simulation->get_data());
+  const std::chrono::duration<double> period(shown->get_simulation()->get_clock().get_dt());
+  auto next = std::chrono::steady_clock::now();
+  timestamp delta;
+  delta.begin();
+  while (m_simulating) {
+    {
+      std::lock_guard<std::mutex> lock(m_simulation_mutex);
+      float elapsed = delta.get_elapsed_time();
+      delta.begin();
+      step(elapsed);
+      publish_frame();
+    }
+    next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+    // a step that overran starts the next one straight away
+    auto now = std::chrono::steady_clock::now();
+    if (next < now)
+      next = now;
+    std::this_thread::sleep_until(next);
+  }
 }
 
 // calls simulation start on the simulation node
+// in simulate all mode every world with a legal simulation starts, the
+// selected world, or else the first one, is shown and followed
 void environment::simulation_start() {
   DEBUG_TEXT("simulation started")
-  static_cast<world*>(selection->get_data())->start_simulation();
-  simulation = selection;
+  replay_end();
+  m_running.clear();
+  simulation = NULL;
+  if (simulate_all) {
+    if (selection && selection->get_data()->get_type_code() == 0 && static_cast<world*>(selection->get_data())->can_simulate())
+      simulation = selection;
+    auto itr = objects->get_traversal_state(traversal_state<object*>::MODE::PREORDER);
+    while(itr.next()) {
+      object* o = itr.get_item();
+      if (o->get_type_code() != 0 || !static_cast<world*>(o)->can_simulate())
+        continue;
+      if (!simulation)
+        simulation = itr.get_node();
+      m_running.push_back(static_cast<world*>(o));
+    }
+  } else {
+    simulation = selection;
+    m_running.push_back(static_cast<world*>(selection->get_data()));
+  }
+  for (world* w : m_running) {
+    w->get_simulation()->follow = w == simulation->get_data();
+    w->pool = w == simulation->get_data() ? &m_solver_pool : NULL;
+    w->start_simulation();
+  }
+  // recorders start from the initial state, a recorder whose file could
+  // not be created stays in place but captures nothing
+  if (record) {
+    for (world* w : m_running) {
+      recorder* r = new recorder(w);
+      if (r->start(w->get_name() + ".rec"))
+        r->capture(w->get_simulation()->get_time());
+      m_recorders.push_back(r);
+    }
+  }
+  // every object is drawn from published frames until the simulation ends
+  m_drawn.clear();
+  auto itr = objects->get_traversal_state(traversal_state<object*>::MODE::PREORDER);
+  while(itr.next())
+    if (itr.get_item()->get_type_code() >= 0)
+      m_drawn.push_back(itr.get_item());
+  publish_frame();
+  m_simulating = true;
+  m_simulation_thread = std::thread(&environment::simulation_loop, this);
 }
 
-// calls simulation end on the simulation node
+// calls simulation end on every running world
 void environment::simulation_end() {
   DEBUG_TEXT("simulation ended")
-  static_cast<world*>(simulation->get_data())->end_simulation();
+  // hand bodies back to the main thread
+  m_simulating = false;
+  if (m_simulation_thread.joinable())
+    m_simulation_thread.join();
+  m_drawn.clear();
+  // finish recordings before the worlds reset their bodies, and keep
+  // them as replays
+  for (size_t i = 0; i < m_recorders.size(); i++) {
+    m_recorders[i]->stop();
+    replay* r = new replay();
+    r->load(*m_recorders[i]);
+    delete m_recorders[i];
+    m_replays.push_back(r);
+    m_replayed.push_back(m_running[i]);
+  }
+  m_recorders.clear();
+  for (world* w : m_running)
+    w->end_simulation();
+  m_running.clear();
+  // replays start from the beginning of the run
+  m_replay_restore.resize(m_replayed.size());
+  for (size_t i = 0; i < m_replayed.size(); i++)
+    replay::capture(m_replayed[i], m_replay_restore[i]);
+  replay_time = get_replay_start();
+  replay_playing = true;
+}
+
+float environment::get_replay_start() const {
+  float start = get_replay_end();
+  for (replay* r : m_replays)
+    if (r->get_frame_count() > 0)
+      start = std::min(start, r->get_start_time());
+  return start;
+}
+
+float environment::get_replay_end() const {
+  float end = 0.0f;
+  for (replay* r : m_replays)
+    end = std::max(end, r->get_end_time());
+  return end;
+}
+
+void environment::replay_end() {
+  for (size_t i = 0; i < m_replays.size(); i++) {
+    replay::apply(m_replay_restore[i], m_replayed[i]);
+    delete m_replays[i];
+  }
+  m_replays.clear();
+  m_replayed.clear();
+  m_replay_restore.clear();
+  replay_playing = false;
 }
 
 // creates a new branch from an object and adds it to the tree 
@@ -151,6 +255,14 @@ void environment::remove(tree_node<object*>* node) {
 
 // check if a simulation is possible given the simulation state
 bool environment::is_simulation_legal() {
+  // in simulate all mode any world with a legal simulation will do
+  if (simulate_all) {
+    auto itr = objects->get_traversal_state(traversal_state<object*>::MODE::PREORDER);
+    while(itr.next())
+      if (itr.get_item()->get_type_code() == 0 && static_cast<world*>(itr.get_item())->can_simulate())
+        return true;
+    return false;
+  }
   // simulation is legal if the selected node is of type world
   if (selection)
     return selection->get_data()->get_type_code() == 0 && static_cast<world*>(selection->get_data())->can_simulate();
@@ -176,6 +288,19 @@ void environment::draw() {
   // shift screen 'centre' to account for gui
   float of = (float)(((500.0 + (width-500.0)/2.0)-width/2.0)/(width/2.0));
   glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(of, 0.0f, 0.0f));
+
+  if (m_simulating) {
+    // draw the latest frame published by the simulation thread, without
+    // touching the objects it is stepping
+    m_frames.update();
+    const frame& f = m_frames.front();
+    glm::mat4 vp_matrix = offset * proj * f.view;
+    for (size_t i = 0; i + 1 < f.first.size(); i++)
+      for (size_t k = f.first[i]; k < f.first[i + 1]; k++)
+        m_drawn[i]->draw_model(vp_matrix, f.models[k]);
+    return;
+  }
+
   glm::mat4 view = environment::current_camera.get_view_matrix();
   // view projection matrix
   glm::mat4 vp_matrix = offset * proj * view;
@@ -1,8 +1,12 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
@@ -11,54 +15,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "camera.hpp"
 #include "shader.hpp"
 #include "object.hpp"
-
-// camera class
-// generates view matrix for draw phase
-class camera {
-  // motion modes
-  enum MODE { STILL, FOCUS, TRACK };
-  glm::vec3 m_position;
-  glm::vec3 m_start;
-  glm::vec3 m_focus_point;
-  glm::vec3 *m_p_target;
-  timestamp m_timestamp;
-
-  // time taken to reach destination position
-  const double m_total_time = 0.5;
-  camera::MODE m_mode;
-
-  float m_zoom = 8.0f;
-
-public:
-  // zoom level
-  float zoom = 8.0f;
-  camera() {
-    // focus on the zero vector on initialisation
-    glm::vec3 point(0.0f);
-    focus(point);
-  }
-  void snap_to(const glm::vec3& point) {
-      m_position = point;
-  }
-  void focus(const glm::vec3 &point);
-  void track(glm::vec3 *const target);
-
-  void update();
-  
-  glm::vec3 get_position() { return m_position; };
-  // generate view matrix for draw phase
-  glm::mat4 get_view_matrix() const {
-    glm::mat4 view(1.0f);
-    // m_position holds the position of the camera's focus
-    // offset from this location and scale by zoom level
-    glm::vec3 position = m_position + glm::vec3(0, 5, -10) * m_zoom;
-    // transform to focus on the target position
-    view = glm::lookAt(position, m_position, glm::vec3(0.0f, 1.0f, 0.0f));
-    return view;
-  }
-};
+#include "recorder.hpp"
+#include "replay.hpp"
+#include "thread_pool.hpp"
+#include "triple_buffer.hpp"
 
 // forward declare tree
 template<class T>
@@ -73,6 +36,44 @@ class environment {
   // hold pointer to currently selected object
   tree_node<object*>* selection;
   tree_node<object*>* simulation;
+  // every world advanced during a simulation, each on its own pool job
+  std::vector<world*> m_running;
+  thread_pool m_pool;
+  // handed to the shown world's solvers, the others run theirs on their
+  // own pool job
+  thread_pool m_solver_pool;
+  // one per running world while recording, captured after its update
+  std::vector<recorder*> m_recorders;
+  // replays of the last recorded run, one per world in m_replayed
+  std::vector<replay*> m_replays;
+  std::vector<world*> m_replayed;
+  // body state from before the replay, put back by replay_end()
+  std::vector<std::vector<replay::sample> > m_replay_restore;
+
+  // transforms published by the simulation thread for the draw phase
+  struct frame {
+    glm::mat4 view;
+    // model matrices of every object in m_drawn, those of object i from
+    // first[i] up to first[i + 1]
+    std::vector<glm::mat4> models;
+    std::vector<size_t> first;
+  };
+  // objects drawn from frames while the simulation thread runs
+  std::vector<object*> m_drawn;
+  triple_buffer<frame> m_frames;
+  // physics runs here during a simulation so its rate does not depend on
+  // the render loop, every body, object and the camera belong to it
+  std::thread m_simulation_thread;
+  std::atomic<bool> m_simulating;
+  // held by the simulation thread while stepping, and by the gui while it
+  // reads or changes simulation state
+  std::mutex m_simulation_mutex;
+
+  // advance simulations, object animations and the camera
+  void step(float delta);
+  // write the current transforms into m_frames and publish them
+  void publish_frame();
+  void simulation_loop();
 public:
   // declare object tree as type object*
   tree_node<object*>* objects;
@@ -80,16 +81,32 @@ public:
   GLFWwindow *const window;
   // declare camera as a static member
   static camera current_camera;
+  // run every world with a legal simulation instead of the selected one
+  bool simulate_all;
+  // record every running world to '<world name>.rec'
+  bool record;
+  // replay position in simulation seconds, advanced by rate each second
+  float replay_time;
+  float replay_rate;
+  bool replay_playing;
 
   environment(GLFWwindow *window);
   ~environment(); 
 
+  // frame logic step, does nothing while the simulation thread runs
   void update(float delta);
   void draw();
   void create(object* object);
   void remove(tree_node<object*>* object);
   void simulation_start();
+  // ends the simulation, a recorded run is kept for replay
   void simulation_end();
+  bool has_replay() const { return !m_replays.empty(); }
+  // time range covered by the replays
+  float get_replay_start() const;
+  float get_replay_end() const;
+  // drop the replays and put the bodies back
+  void replay_end();
   bool is_simulation_legal();
 
   // pass in node to select
@@ -101,6 +118,9 @@ public:
   // selection getter
   tree_node<object*>* get_selection() const { return selection; }; 
   tree_node<object*>* get_simulation() const { return simulation; };
+  const std::vector<world*>& get_running() const { return m_running; }
+  const std::vector<recorder*>& get_recorders() const { return m_recorders; }
+  std::mutex& get_simulation_mutex() { return m_simulation_mutex; }
 
   // deselect currently selected node
   // if reselect is enabled, the first valid leaf from 
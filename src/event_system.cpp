@@ -0,0 +1,332 @@
+#include "event_system.hpp"
+#include <algorithm>
+#include <cmath>
+
+// a bounce lower than this fraction of the radius settles into sliding
+static const float rest_height = 1e-3f;
+
+// polynomials
+// c[0] + c[1]*t + ... + c[degree]*t^degree, degree 4 at most
+
+static double poly(const double* c, int degree, double t) {
+  double r = c[degree];
+  for (int k = degree - 1; k >= 0; k--)
+    r = r * t + c[k];
+  return r;
+}
+
+// narrow a sign change inside [lo, hi], returns the end past the change
+static double bisect(const double* c, int degree, double lo, double hi) {
+  bool above = poly(c, degree, lo) > 0.0;
+  for (int i = 0; i < 60; i++) {
+    double mid = 0.5 * (lo + hi);
+    if ((poly(c, degree, mid) > 0.0) == above)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return hi;
+}
+
+// split [t0, t1] where the polynomial turns, writes t0, every turning
+// point and t1 into 'points', returns how many were written
+static int monotonic_intervals(const double* c, int degree, double t0, double t1, double* points);
+
+// every root inside [t0, t1] in increasing order, returns the count
+static int poly_roots(const double* c, int degree, double t0, double t1, double* out) {
+  while (degree > 0 && c[degree] == 0.0)
+    degree--;
+  if (degree == 0)
+    return 0;
+  if (degree == 1) {
+    double t = -c[0] / c[1];
+    if (t < t0 || t > t1)
+      return 0;
+    out[0] = t;
+    return 1;
+  }
+  double points[6];
+  int n = monotonic_intervals(c, degree, t0, t1, points);
+  int count = 0;
+  for (int k = 0; k + 1 < n; k++)
+    if ((poly(c, degree, points[k]) > 0.0) != (poly(c, degree, points[k + 1]) > 0.0))
+      out[count++] = bisect(c, degree, points[k], points[k + 1]);
+  return count;
+}
+
+static int monotonic_intervals(const double* c, int degree, double t0, double t1, double* points) {
+  double d[4];
+  for (int k = 0; k < degree; k++)
+    d[k] = (k + 1) * c[k + 1];
+  int n = 0;
+  points[n++] = t0;
+  n += poly_roots(d, degree - 1, t0, t1, points + n);
+  points[n++] = t1;
+  return n;
+}
+
+// earliest time in [0, horizon] the polynomial falls from above zero to
+// zero or below, the moment a gap between two surfaces closes
+static bool first_impact(const double* c, int degree, double horizon, double& t) {
+  while (degree > 0 && c[degree] == 0.0)
+    degree--;
+  if (degree == 0)
+    return false;
+  // already touching and closing
+  if (c[0] <= 0.0 && c[1] < 0.0) {
+    t = 0.0;
+    return true;
+  }
+  double points[6];
+  int n = degree == 1 ? 0 : monotonic_intervals(c, degree, 0.0, horizon, points);
+  if (degree == 1) {
+    points[n++] = 0.0;
+    points[n++] = horizon;
+  }
+  for (int k = 0; k + 1 < n; k++)
+    if (poly(c, degree, points[k]) > 0.0 && poly(c, degree, points[k + 1]) <= 0.0) {
+      t = bisect(c, degree, points[k], points[k + 1]);
+      return true;
+    }
+  return false;
+}
+
+// event system
+event_system::event_system() :
+  gravity(0.0f, -9.8f, 0.0f),
+  restitution(0.5f),
+  window(10.0f),
+  events(0),
+  stale_events(0),
+  m_time(0.0f),
+  m_horizon(0.0f) {}
+
+int event_system::add_particle(glm::vec3 p, glm::vec3 v, float m, float r) {
+  return (int)particles.add(p, v, m, r);
+}
+
+void event_system::build() {
+  m_time = 0.0f;
+  m_horizon = window;
+  m_state_time.assign(size(), 0.0f);
+  m_count.assign(size(), 0);
+  m_resting.assign(size(), std::vector<int>());
+  events = 0;
+  stale_events = 0;
+  schedule_all();
+}
+
+bool event_system::is_resting(size_t i, size_t k) const {
+  return std::find(m_resting[i].begin(), m_resting[i].end(), (int)k) != m_resting[i].end();
+}
+
+glm::vec3 event_system::constrain(size_t i, glm::vec3 u) const {
+  const std::vector<int>& resting = m_resting[i];
+  auto allowed = [&](glm::vec3 w) {
+    for (int k : resting)
+      if (glm::dot(w, contacts[k].normal) < -1e-6f * glm::length(u))
+        return false;
+    return true;
+  };
+  if (allowed(u))
+    return u;
+  // slide along the one plane that holds every other contact back
+  for (int k : resting) {
+    glm::vec3 n = contacts[k].normal;
+    glm::vec3 w = u - n * glm::dot(u, n);
+    if (allowed(w))
+      return w;
+  }
+  // or along the crease of two of them
+  for (size_t a = 0; a < resting.size(); a++)
+    for (size_t b = a + 1; b < resting.size(); b++) {
+      glm::vec3 crease = glm::cross(contacts[resting[a]].normal, contacts[resting[b]].normal);
+      if (glm::length(crease) <= 1e-6f)
+        continue;
+      crease = glm::normalize(crease);
+      glm::vec3 w = crease * glm::dot(u, crease);
+      if (allowed(w))
+        return w;
+    }
+  // wedged into a corner
+  return glm::vec3(0.0f);
+}
+
+glm::vec3 event_system::acceleration(size_t i) const {
+  // a sliding particle loses the part pressing into its contacts
+  return constrain(i, gravity + particles.applied.get(i) * particles.inv_mass[i]);
+}
+
+void event_system::sync(size_t i, float t) {
+  float dt = t - m_state_time[i];
+  if (dt == 0.0f)
+    return;
+  glm::vec3 a = acceleration(i);
+  glm::vec3 v = particles.velocity.get(i);
+  particles.position.add(i, v * dt + a * (0.5f * dt * dt));
+  particles.velocity.set(i, v + a * dt);
+  m_state_time[i] = t;
+}
+
+void event_system::sync_all(float t) {
+  for (size_t i = 0; i < size(); i++)
+    sync(i, t);
+}
+
+void event_system::predict_pair(size_t i, size_t j) {
+  sync(i, m_time);
+  sync(j, m_time);
+  // separation d(t) = dp + dv*t + da*t^2/2, impact when |d| reaches both radii
+  glm::dvec3 dp = glm::dvec3(particles.position.get(j) - particles.position.get(i));
+  glm::dvec3 dv = glm::dvec3(particles.velocity.get(j) - particles.velocity.get(i));
+  glm::dvec3 half_da = 0.5 * glm::dvec3(acceleration(j) - acceleration(i));
+  double reach = particles.radius[i] + particles.radius[j];
+  double c[5] = {
+    glm::dot(dp, dp) - reach * reach,
+    2.0 * glm::dot(dv, dp),
+    glm::dot(dv, dv) + 2.0 * glm::dot(half_da, dp),
+    2.0 * glm::dot(half_da, dv),
+    glm::dot(half_da, half_da),
+  };
+  double t;
+  if (!first_impact(c, 4, m_horizon - m_time, t))
+    return;
+  event e = { m_time + (float)t, (int)i, (int)j, m_count[i], m_count[j] };
+  m_queue.push(e);
+}
+
+void event_system::predict_contact(size_t i, size_t k) {
+  sync(i, m_time);
+  // gap between the particle surface and the plane along its normal
+  glm::vec3 n = contacts[k].normal;
+  double c[3] = {
+    glm::dot(particles.position.get(i) - contacts[k].point, n) - particles.radius[i],
+    glm::dot(particles.velocity.get(i), n),
+    0.5 * glm::dot(acceleration(i), n),
+  };
+  double t = 0.0;
+  // touching with a bounce too small to leave, settle it now rather than
+  // let it sink through while barely separating
+  bool settling = c[0] <= 0.0 && c[2] < 0.0 && c[1] * c[1] < -4.0 * c[2] * rest_height * particles.radius[i];
+  if (!settling && !first_impact(c, 2, m_horizon - m_time, t))
+    return;
+  event e = { m_time + (float)t, (int)i, -1 - (int)k, m_count[i], 0 };
+  m_queue.push(e);
+}
+
+void event_system::predict(size_t i) {
+  for (size_t j = 0; j < size(); j++)
+    if (j != i)
+      predict_pair(i, j);
+  for (size_t k = 0; k < contacts.size(); k++)
+    if (!is_resting(i, k))
+      predict_contact(i, k);
+}
+
+void event_system::schedule_all() {
+  m_queue = std::priority_queue<event, std::vector<event>, std::greater<event> >();
+  for (size_t i = 0; i < size(); i++) {
+    for (size_t j = i + 1; j < size(); j++)
+      predict_pair(i, j);
+    for (size_t k = 0; k < contacts.size(); k++)
+      if (!is_resting(i, k))
+        predict_contact(i, k);
+  }
+}
+
+void event_system::collide_pair(size_t i, size_t j) {
+  glm::vec3 d = particles.position.get(j) - particles.position.get(i);
+  float length = glm::length(d);
+  if (length <= 0.0f)
+    return;
+  glm::vec3 n = d / length;
+  float wi = particles.inv_mass[i], wj = particles.inv_mass[j];
+  // restitution impulse along the line of centres
+  float vn = glm::dot(particles.velocity.get(j) - particles.velocity.get(i), n);
+  if (vn < 0.0f) {
+    float impulse = -(1.0f + restitution) * vn / (wi + wj);
+    particles.velocity.add(i, n * (-impulse * wi));
+    particles.velocity.add(j, n * (impulse * wj));
+  }
+  // a knocked particle may bounce off or leave the contacts it slid along
+  const std::vector<int> rest_i = m_resting[i], rest_j = m_resting[j];
+  for (int k : rest_i)
+    collide_contact(i, k);
+  for (int k : rest_j)
+    collide_contact(j, k);
+}
+
+void event_system::collide_contact(size_t i, size_t k) {
+  glm::vec3 n = contacts[k].normal;
+  glm::vec3 v = particles.velocity.get(i);
+  float vn = glm::dot(v, n);
+  if (vn < 0.0f) {
+    v -= n * ((1.0f + restitution) * vn);
+    vn = -restitution * vn;
+  }
+  // bounces too small to clear the surface become sliding, which
+  // stops the bounces piling up towards infinitely many events
+  std::vector<int>& resting = m_resting[i];
+  resting.erase(std::remove(resting.begin(), resting.end(), (int)k), resting.end());
+  float an = glm::dot(gravity + particles.applied.get(i) * particles.inv_mass[i], n);
+  if (an < 0.0f && vn * vn < -2.0f * an * rest_height * particles.radius[i]) {
+    v -= n * vn;
+    float gap = glm::dot(particles.position.get(i) - contacts[k].point, n) - particles.radius[i];
+    particles.position.add(i, -n * gap);
+    resting.push_back((int)k);
+  }
+  // contacts it now moves away from are left, the rest keep it out,
+  // so sliding into a second plane holds it in the crease rather than
+  // swapping from one plane to the other at the same instant
+  for (size_t r = 0; r < resting.size();) {
+    if (glm::dot(v, contacts[resting[r]].normal) > 0.0f)
+      resting.erase(resting.begin() + r);
+    else
+      r++;
+  }
+  particles.velocity.set(i, constrain(i, v));
+}
+
+void event_system::advance(float time) {
+  if (time < m_time)
+    return;
+  for (;;) {
+    // drop events for particles that changed path after the prediction
+    while (!m_queue.empty()) {
+      const event& e = m_queue.top();
+      if (e.count_a == m_count[e.a] && (e.b < 0 || e.count_b == m_count[e.b]))
+        break;
+      m_queue.pop();
+      stale_events++;
+    }
+    if (m_queue.empty() || m_queue.top().time > time) {
+      if (time <= m_horizon)
+        break;
+      // window exhausted, predict the next one from its end
+      m_time = m_horizon;
+      sync_all(m_time);
+      m_horizon = std::max(time, m_time + window);
+      schedule_all();
+      continue;
+    }
+    event e = m_queue.top();
+    m_queue.pop();
+    m_time = std::max(m_time, e.time);
+    events++;
+    sync(e.a, m_time);
+    if (e.b >= 0) {
+      sync(e.b, m_time);
+      collide_pair(e.a, e.b);
+      m_count[e.a]++;
+      m_count[e.b]++;
+      predict(e.a);
+      predict(e.b);
+    } else {
+      collide_contact(e.a, -1 - e.b);
+      m_count[e.a]++;
+      predict(e.a);
+    }
+  }
+  sync_all(time);
+  m_time = time;
+}
@@ -0,0 +1,92 @@
+#ifndef EVENT_SYSTEM_H
+#define EVENT_SYSTEM_H
+
+#include <cstddef>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "particle_store.hpp"
+
+// event driven simulation of ballistic particles
+// every particle follows an exact constant acceleration path between
+// impacts, so instead of stepping, the time of every particle against
+// particle and particle against plane impact is predicted and kept in a
+// priority queue. the system jumps from one impact to the next and only
+// predicts again for the particles an impact changed, events involving
+// a particle that has since changed path are dropped when they surface
+class event_system {
+public:
+  // plane contact, particles are kept on the positive side of the normal
+  struct contact {
+    glm::vec3 point;
+    glm::vec3 normal;
+  };
+
+  // particle state, valid at each particle's own m_state_time
+  particle_store particles;
+  std::vector<contact> contacts;
+  glm::vec3 gravity;
+  float restitution;
+  // impacts are predicted this far ahead, then every particle is
+  // predicted again from the end of the window
+  float window;
+
+  // statistics since the last build()
+  size_t events;
+  size_t stale_events;
+
+  event_system();
+  // add a particle, returns its index
+  int add_particle(glm::vec3 position, glm::vec3 velocity, float mass, float radius);
+  size_t size() const { return particles.size(); }
+  // move the system to time 0 and predict every impact, call after
+  // adding particles and contacts
+  void build();
+  // process every impact up to 'time' and move all particles there
+  void advance(float time);
+  float get_time() const { return m_time; }
+
+private:
+  // impact of particle a with particle b, or with contact -1-b when b < 0
+  // counts are the path versions the prediction was made from
+  struct event {
+    float time;
+    int a;
+    int b;
+    unsigned int count_a;
+    unsigned int count_b;
+    bool operator>(const event& other) const { return time > other.time; }
+  };
+
+  std::priority_queue<event, std::vector<event>, std::greater<event> > m_queue;
+  // time the stored position and velocity of each particle refer to
+  std::vector<float> m_state_time;
+  // bumped whenever a particle changes path, invalidating its events
+  std::vector<unsigned int> m_count;
+  // contacts each particle is sliding along, none while in flight, two
+  // when it sits in the crease between planes
+  std::vector<std::vector<int> > m_resting;
+  float m_time;
+  // end of the current prediction window
+  float m_horizon;
+
+  bool is_resting(size_t i, size_t k) const;
+  // 'u' less the part pushing into particle i's resting contacts
+  glm::vec3 constrain(size_t i, glm::vec3 u) const;
+  glm::vec3 acceleration(size_t i) const;
+  // bring particle i's state forward to time t along its path
+  void sync(size_t i, float t);
+  void sync_all(float t);
+  // queue the next impact of particle i with every other particle and contact
+  void predict(size_t i);
+  void predict_pair(size_t i, size_t j);
+  void predict_contact(size_t i, size_t k);
+  void schedule_all();
+  void collide_pair(size_t i, size_t j);
+  void collide_contact(size_t i, size_t k);
+};
+
+#endif // !EVENT_SYSTEM_H
@@ -0,0 +1,261 @@
+#include "gravity_tree.hpp"
+#include <algorithm>
+#include <cmath>
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// groups walked per pool job in accumulate()
+static const size_t groups_per_job = 4;
+
+static float lane_sum(vfloat v) {
+  float lanes[SIMD_WIDTH];
+  vstore(lanes, v);
+  float sum = 0.0f;
+  for (int i = 0; i < SIMD_WIDTH; i++)
+    sum += lanes[i];
+  return sum;
+}
+
+void gravity_tree::build(const vec3_array& x, const std::vector<float>& mass) {
+  const size_t n = x.size();
+  m_nodes.clear();
+  m_groups.clear();
+  m_order.resize(n);
+  m_scratch.resize(n);
+  for (size_t i = 0; i < n; i++)
+    m_order[i] = (unsigned int)i;
+  if (n == 0)
+    return;
+
+  // root cube around every particle
+  glm::vec3 lo = x.get(0), hi = lo;
+  for (size_t i = 1; i < n; i++) {
+    glm::vec3 p = x.get(i);
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  glm::vec3 extent = hi - lo;
+  node root;
+  root.width = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f)) * 1.0001f;
+  root.first_child = -1;
+  root.child_count = 0;
+  root.begin = 0;
+  root.count = (unsigned int)n;
+  m_nodes.push_back(root);
+  split(0, (lo + hi) * 0.5f, 0, false, x, mass);
+
+  // copy the particles in tree order so leaves read contiguous memory
+  m_x.resize(n);
+  m_y.resize(n);
+  m_z.resize(n);
+  m_mass.resize(n);
+  for (size_t k = 0; k < n; k++) {
+    unsigned int i = m_order[k];
+    m_x[k] = x.x[i];
+    m_y[k] = x.y[i];
+    m_z[k] = x.z[i];
+    m_mass[k] = mass[i];
+  }
+}
+
+void gravity_tree::split(int n, glm::vec3 centre, int depth, bool grouped, const vec3_array& x, const std::vector<float>& mass) {
+  const unsigned int begin = m_nodes[n].begin, count = m_nodes[n].count;
+  const float width = m_nodes[n].width;
+  if (!grouped && (count <= group_size || depth >= max_depth)) {
+    m_groups.push_back(n);
+    grouped = true;
+  }
+  if (count <= leaf_size || depth >= max_depth) {
+    float total = 0.0f;
+    glm::vec3 moment(0.0f);
+    for (unsigned int k = begin; k < begin + count; k++) {
+      unsigned int i = m_order[k];
+      total += mass[i];
+      moment += x.get(i) * mass[i];
+    }
+    m_nodes[n].mass = total;
+    m_nodes[n].centre_of_mass = total > 0.0f ? moment / total : centre;
+    return;
+  }
+
+  // counting sort of the node's particles into octants, through the
+  // scratch buffer and back
+  auto octant = [&](unsigned int i) {
+    return (x.x[i] > centre.x) | (x.y[i] > centre.y) << 1 | (x.z[i] > centre.z) << 2;
+  };
+  unsigned int octant_count[8] = {0};
+  for (unsigned int k = begin; k < begin + count; k++)
+    octant_count[octant(m_order[k])]++;
+  unsigned int octant_start[8], fill[8];
+  unsigned int next = begin;
+  for (int o = 0; o < 8; o++) {
+    octant_start[o] = fill[o] = next;
+    next += octant_count[o];
+  }
+  for (unsigned int k = begin; k < begin + count; k++)
+    m_scratch[fill[octant(m_order[k])]++] = m_order[k];
+  std::copy(m_scratch.begin() + begin, m_scratch.begin() + begin + count, m_order.begin() + begin);
+
+  // only occupied octants get a child, all stored side by side
+  int first = (int)m_nodes.size();
+  int children = 0;
+  glm::vec3 child_centre[8];
+  for (int o = 0; o < 8; o++) {
+    if (!octant_count[o])
+      continue;
+    float q = width * 0.25f;
+    child_centre[children] = centre + glm::vec3(o & 1 ? q : -q, o & 2 ? q : -q, o & 4 ? q : -q);
+    node c;
+    c.width = width * 0.5f;
+    c.first_child = -1;
+    c.child_count = 0;
+    c.begin = octant_start[o];
+    c.count = octant_count[o];
+    m_nodes.push_back(c);
+    children++;
+  }
+  m_nodes[n].first_child = first;
+  m_nodes[n].child_count = children;
+
+  float total = 0.0f;
+  glm::vec3 moment(0.0f);
+  for (int c = 0; c < children; c++) {
+    split(first + c, child_centre[c], depth + 1, grouped, x, mass);
+    total += m_nodes[first + c].mass;
+    moment += m_nodes[first + c].centre_of_mass * m_nodes[first + c].mass;
+  }
+  m_nodes[n].mass = total;
+  m_nodes[n].centre_of_mass = total > 0.0f ? moment / total : centre;
+}
+
+void gravity_tree::walk(int n, interaction_list& list) const {
+  // bounds of the group's particles
+  const node& group = m_nodes[n];
+  float lo_x = m_x[group.begin], lo_y = m_y[group.begin], lo_z = m_z[group.begin];
+  float hi_x = lo_x, hi_y = lo_y, hi_z = lo_z;
+  for (unsigned int k = group.begin + 1; k < group.begin + group.count; k++) {
+    lo_x = std::min(lo_x, m_x[k]);
+    lo_y = std::min(lo_y, m_y[k]);
+    lo_z = std::min(lo_z, m_z[k]);
+    hi_x = std::max(hi_x, m_x[k]);
+    hi_y = std::max(hi_y, m_y[k]);
+    hi_z = std::max(hi_z, m_z[k]);
+  }
+  const float theta2 = opening_angle * opening_angle;
+  list.clear();
+  // every level can push at most seven more nodes than it pops
+  int stack[8 * max_depth + 8];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const node& nd = m_nodes[stack[--top]];
+    // distance to the nearest particle the group could hold
+    const glm::vec3& c = nd.centre_of_mass;
+    float dx = std::max(std::max(lo_x - c.x, c.x - hi_x), 0.0f);
+    float dy = std::max(std::max(lo_y - c.y, c.y - hi_y), 0.0f);
+    float dz = std::max(std::max(lo_z - c.z, c.z - hi_z), 0.0f);
+    if (nd.width * nd.width < theta2 * (dx * dx + dy * dy + dz * dz)) {
+      list.push_back(c.x, c.y, c.z, nd.mass);
+      list.nodes++;
+    } else if (nd.child_count == 0) {
+      for (unsigned int k = nd.begin; k < nd.begin + nd.count; k++)
+        list.push_back(m_x[k], m_y[k], m_z[k], m_mass[k]);
+    } else {
+      for (int i = 0; i < nd.child_count; i++)
+        stack[top++] = nd.first_child + i;
+    }
+  }
+}
+
+void gravity_tree::accumulate(vec3_array& out, thread_pool* pool) {
+  const size_t groups = m_groups.size();
+  const size_t blocks = (groups + groups_per_job - 1) / groups_per_job;
+  const vfloat eps2 = vset(softening * softening);
+  const vfloat zero = vset(0.0f), one = vset(1.0f);
+  const float g = gravitational_constant;
+  // counts per block so pool jobs never share a counter
+  std::vector<size_t> block_nodes(blocks, 0), block_pairs(blocks, 0);
+  auto job = [&](size_t b) {
+    interaction_list list;
+    size_t end = std::min(groups, (b + 1) * groups_per_job);
+    for (size_t l = b * groups_per_job; l < end; l++) {
+      const node& group = m_nodes[m_groups[l]];
+      walk(m_groups[l], list);
+      // pad to whole simd lanes with massless points
+      const size_t count = list.x.size();
+      while (list.x.size() % SIMD_WIDTH)
+        list.push_back(0.0f, 0.0f, 0.0f, 0.0f);
+      const float* lx = list.x.data();
+      const float* ly = list.y.data();
+      const float* lz = list.z.data();
+      const float* lm = list.mass.data();
+      const size_t padded = list.x.size();
+      for (unsigned int k = group.begin; k < group.begin + group.count; k++) {
+        const vfloat px = vset(m_x[k]), py = vset(m_y[k]), pz = vset(m_z[k]);
+        vfloat ax = vset(0.0f), ay = vset(0.0f), az = vset(0.0f);
+        for (size_t j = 0; j < padded; j += SIMD_WIDTH) {
+          vfloat dx = vsub(vload(lx + j), px);
+          vfloat dy = vsub(vload(ly + j), py);
+          vfloat dz = vsub(vload(lz + j), pz);
+          vfloat r2 = vfmadd(dx, dx, vfmadd(dy, dy, vfmadd(dz, dz, eps2)));
+          // a particle meets itself at zero distance and adds nothing
+          vfloat inv = vmask_lt(zero, r2, vdiv(one, vsqrt(r2)));
+          vfloat s = vmul(vload(lm + j), vmul(inv, vmul(inv, inv)));
+          ax = vfmadd(dx, s, ax);
+          ay = vfmadd(dy, s, ay);
+          az = vfmadd(dz, s, az);
+        }
+        out.add(m_order[k], glm::vec3(lane_sum(ax), lane_sum(ay), lane_sum(az)) * g);
+      }
+      block_nodes[b] += list.nodes * group.count;
+      block_pairs[b] += (count - list.nodes) * group.count;
+    }
+  };
+  if (pool && blocks > 1) {
+    pool->run(blocks, job);
+  } else {
+    for (size_t b = 0; b < blocks; b++)
+      job(b);
+  }
+  node_interactions = 0;
+  pair_interactions = 0;
+  for (size_t b = 0; b < blocks; b++) {
+    node_interactions += block_nodes[b];
+    pair_interactions += block_pairs[b];
+  }
+}
+
+void gravity_direct(const vec3_array& x, const std::vector<float>& mass, float gravitational_constant,
+                    float softening, vec3_array& out) {
+  const size_t n = x.size();
+  const size_t whole = n - n % SIMD_WIDTH;
+  const float eps2 = softening * softening;
+  const vfloat veps2 = vset(eps2), zero = vset(0.0f), one = vset(1.0f);
+  for (size_t i = 0; i < n; i++) {
+    const vfloat px = vset(x.x[i]), py = vset(x.y[i]), pz = vset(x.z[i]);
+    vfloat vx = zero, vy = zero, vz = zero;
+    // a particle meets itself at zero distance and adds nothing
+    for (size_t j = 0; j < whole; j += SIMD_WIDTH) {
+      vfloat dx = vsub(vload(&x.x[j]), px);
+      vfloat dy = vsub(vload(&x.y[j]), py);
+      vfloat dz = vsub(vload(&x.z[j]), pz);
+      vfloat r2 = vfmadd(dx, dx, vfmadd(dy, dy, vfmadd(dz, dz, veps2)));
+      vfloat inv = vmask_lt(zero, r2, vdiv(one, vsqrt(r2)));
+      vfloat s = vmul(vload(&mass[j]), vmul(inv, vmul(inv, inv)));
+      vx = vfmadd(dx, s, vx);
+      vy = vfmadd(dy, s, vy);
+      vz = vfmadd(dz, s, vz);
+    }
+    float ax = lane_sum(vx), ay = lane_sum(vy), az = lane_sum(vz);
+    for (size_t j = whole; j < n; j++) {
+      float dx = x.x[j] - x.x[i], dy = x.y[j] - x.y[i], dz = x.z[j] - x.z[i];
+      float r2 = dx * dx + dy * dy + dz * dz + eps2;
+      float inv = r2 > 0.0f ? 1.0f / std::sqrt(r2) : 0.0f;
+      float s = mass[j] * inv * inv * inv;
+      ax += dx * s;
+      ay += dy * s;
+      az += dz * s;
+    }
+    out.add(i, glm::vec3(ax, ay, az) * gravitational_constant);
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef GRAVITY_TREE_H
+#define GRAVITY_TREE_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "particle_store.hpp"
+
+class thread_pool;
+
+// barnes-hut octree for mutual gravitation between particles
+// the tree is rebuilt from the positions on every build(), each node keeps
+// the total mass and centre of mass of the particles under it. a node is
+// taken as one point mass when its width over its distance is below the
+// opening angle, and opened otherwise, so a pass costs O(n log n) instead
+// of the O(n^2) of summing every pair. the tree is walked once per group
+// of nearby particles, measuring distance from the group's bounds, and
+// every particle of the group then sums the same interaction list in one
+// flat simd loop
+class gravity_tree {
+  struct node {
+    glm::vec3 centre_of_mass;
+    float mass;
+    // cube edge length
+    float width;
+    // children are stored together from first_child, leaves have none
+    // and own the sorted particles [begin, begin + count)
+    int first_child;
+    int child_count;
+    unsigned int begin;
+    unsigned int count;
+  };
+  std::vector<node> m_nodes;
+  // particle indices in tree order, leaves own contiguous runs
+  std::vector<unsigned int> m_order;
+  // positions and masses copied in tree order for the leaf sums
+  std::vector<float> m_x, m_y, m_z, m_mass;
+  std::vector<unsigned int> m_scratch;
+  // nodes walked as one group, see group_size
+  std::vector<int> m_groups;
+
+  // point masses one leaf interacts with, nodes and particles alike
+  struct interaction_list {
+    std::vector<float> x, y, z, mass;
+    size_t nodes;
+    void clear() { x.clear(); y.clear(); z.clear(); mass.clear(); nodes = 0; }
+    void push_back(float px, float py, float pz, float m) { x.push_back(px); y.push_back(py); z.push_back(pz); mass.push_back(m); }
+  };
+
+  // split node 'n' covering the cube at 'centre' into its children, down
+  // to the leaves, and sum the mass of each node on the way back up
+  void split(int n, glm::vec3 centre, int depth, bool grouped, const vec3_array& x, const std::vector<float>& mass);
+  // gather what the particles of node 'n' interact with into 'list'
+  void walk(int n, interaction_list& list) const;
+
+public:
+  // nodes with at most this many particles are not split further
+  static constexpr unsigned int leaf_size = 8;
+  // the largest nodes holding at most this many particles are walked
+  // once for all of them, fewer walks at the cost of longer lists
+  static constexpr unsigned int group_size = 64;
+  // below this many particles the direct sum beats building and walking
+  // a tree, see the gravity bench
+  static constexpr size_t direct_limit = 2048;
+  // nodes deeper than this are kept as leaves whatever they hold, stops
+  // coincident particles from splitting forever
+  static constexpr int max_depth = 32;
+
+  float gravitational_constant;
+  // largest node width over distance still taken as a single point mass,
+  // 0 opens every node and reproduces the direct sum
+  float opening_angle;
+  // plummer softening length, keeps close passes finite
+  float softening;
+  // point mass interactions from the last accumulate(), with whole
+  // nodes and with single particles
+  size_t node_interactions;
+  size_t pair_interactions;
+
+  gravity_tree()
+      : gravitational_constant(1.0f), opening_angle(0.5f), softening(0.01f),
+        node_interactions(0), pair_interactions(0) {}
+  // sort the particles into a fresh tree
+  void build(const vec3_array& x, const std::vector<float>& mass);
+  // add the gravitational acceleration of every particle to 'out', using
+  // the positions the tree was built from, spread across 'pool' if given
+  void accumulate(vec3_array& out, thread_pool* pool = NULL);
+  size_t get_node_count() const { return m_nodes.size(); }
+};
+
+// direct O(n^2) sum of the same field, for reference and small systems
+void gravity_direct(const vec3_array& x, const std::vector<float>& mass, float gravitational_constant,
+                    float softening, vec3_array& out);
+
+#endif // !GRAVITY_TREE_H
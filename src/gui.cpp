@@ -25,6 +25,10 @@ static object * create_world(std::string& name) {
  return new world(name, 300); 
 }
 
+static object * create_fluid(std::string& name) {
+ return new fluid(name, 5); 
+}
+
 static object * create_spring(std::string& name) {
  return new spring(name, 5); 
 }
@@ -92,7 +96,7 @@ void GUI::show(environment& env) {
   // simulation start button
   // button text reflects gui state
   // activates only if there is a legal simulation
-  if (ImGui::Button((GUI::state == GUI::EDIT ? "Start" : "Stop"), ImVec2(100, 30))) {
+  if (ImGui::Button((GUI::state == GUI::EDIT ? "Start" : GUI::state == GUI::SIMULATE ? "Stop" : "Close"), ImVec2(100, 30))) {
       DEBUG_TEXT("start simulation button clicked")
       // update gui state
       if (env.is_simulation_legal() && GUI::state == GUI::EDIT) {
@@ -103,6 +107,10 @@ void GUI::show(environment& env) {
         env.deselect();
       } else if (GUI::state == GUI::SIMULATE) {
         env.simulation_end();
+        // a recorded run opens in the replay
+        GUI::state = env.has_replay() ? GUI::REPLAY : GUI::EDIT;
+      } else if (GUI::state == GUI::REPLAY) {
+        env.replay_end();
       GUI::state = GUI::EDIT;
     }
   }
@@ -110,12 +118,24 @@ void GUI::show(environment& env) {
   if (GUI::state == GUI::SIMULATE) {
     ImGui::SameLine(120.0f);
     ImGui::Text("Simulating, GUI locked");
+  } else if (GUI::state == GUI::REPLAY) {
+    ImGui::SameLine(120.0f);
+    ImGui::Text("Replaying, GUI locked");
+  } else {
+    // run every world at once instead of the selection
+    ImGui::SameLine(120.0f);
+    ImGui::Checkbox("simulate all", &env.simulate_all);
+    // capture running worlds to files named after them
+    ImGui::SameLine(250.0f);
+    ImGui::Checkbox("record", &env.record);
   }
 
   auto io = ImGui::GetIO();
   static struct { float x; float y; } last_xy;
   // scroll to zoom if the cursor is not hovering the main input panel
   if (io.MousePos.x > window_width) {
+    // the camera belongs to the simulation thread while it runs
+    std::lock_guard<std::mutex> lock(env.get_simulation_mutex());
     env.current_camera.zoom += io.MouseWheel*0.7f;
     if (env.current_camera.zoom < 0)
       env.current_camera.zoom = 0;
@@ -164,8 +184,8 @@ void GUI::show(environment& env) {
               ImGui::InputInt("  ", &count);
               // create 'count' objects and add them to gui tree at 'node'
               // used to spawn multiple objects in one command
-              // does not activate while simulating
-              if (spawn && GUI::state != GUI::SIMULATE) {
+              // does not activate while simulating or replaying
+              if (spawn && GUI::state == GUI::EDIT) {
                 for (int i = 0; i < count; i++) {
                   std::string s_alt = s_input;
                   if (i != 0)
@@ -177,8 +197,8 @@ void GUI::show(environment& env) {
               }
               ImGui::SameLine(364.0f);
               // remove selected node and its children from gui tree
-              // does not activate while simulating
-              if (ImGui::Button("remove object") && GUI::state != GUI::SIMULATE) {
+              // does not activate while simulating or replaying
+              if (ImGui::Button("remove object") && GUI::state == GUI::EDIT) {
                 auto node = env.get_selection();
                 if (node && node->get_data()->get_name() != "root") {
                   // cannot delete root node world 
@@ -197,7 +217,9 @@ void GUI::show(environment& env) {
     tab_item(env, "world", create_world);
     tab_item(env, "particle", create_particle);
     tab_item(env, "plane", create_plane);
+    tab_item(env, "point", create_point);
     tab_item(env, "spring", create_spring);
+    tab_item(env, "fluid", create_fluid);
     ImGui::EndTabBar();
   }
   ImGui::Separator();
@@ -214,7 +236,33 @@ void GUI::show(environment& env) {
   } 
   if (GUI::state == GUI::SIMULATE){
     // in gui state simulate, calculate and show simulation data
+      std::lock_guard<std::mutex> lock(env.get_simulation_mutex());
       env.get_simulation()->get_data()->show();
+      // update cost of each world when several run side by side
+      if (env.get_running().size() > 1) {
+        ImGui::Separator();
+        for (world* w : env.get_running())
+          ImGui::Text("%s: %.3f ms", w->get_name().c_str(), w->get_simulation()->get_update_seconds()*1000.0);
+      }
+      // frames captured and lost to a full ring per recording
+      if (!env.get_recorders().empty()) {
+        ImGui::Separator();
+        for (size_t i = 0; i < env.get_recorders().size(); i++) {
+          const recorder* r = env.get_recorders()[i];
+          ImGui::Text("%s.rec: %llu frames, %llu dropped", env.get_running()[i]->get_name().c_str(),
+                      (unsigned long long)r->get_captured(), (unsigned long long)r->get_dropped());
+        }
+      }
+  }
+
+  if (GUI::state == GUI::REPLAY) {
+    // scrub through the recorded run, playing stops at either end
+    ImGui::SliderFloat("time", &env.replay_time, env.get_replay_start(), env.get_replay_end());
+    if (ImGui::Checkbox("play", &env.replay_playing) && env.replay_playing
+        && env.replay_rate > 0.0f && env.replay_time >= env.get_replay_end())
+      env.replay_time = env.get_replay_start();
+    ImGui::SameLine();
+    ImGui::InputFloat("rate", &env.replay_rate, 0.25f, 1.0f);
   }
 
   ImGui::Spacing();
@@ -27,7 +27,7 @@ class GUIitem;
 // static gui class to contain gui code
 class GUI {
 public:
-  enum STATE { EDIT,SIMULATE };
+  enum STATE { EDIT,SIMULATE,REPLAY };
 private:
   // store gui state
   static STATE state;
@@ -0,0 +1,617 @@
+#include "integrator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "thread_pool.hpp"
+
+// ode system
+int ode_system::add_particle(glm::vec3 p, glm::vec3 v, float m, float r) {
+  return (int)particles.add(p, v, m, r);
+}
+
+void ode_system::accelerations(const vec3_array& x, const vec3_array& /*v*/, vec3_array& out) const {
+  // gravity and constant applied forces
+  particles.accelerations(gravity, out);
+  // spring forces
+  for (const link& l : links) {
+    glm::vec3 other = l.b < 0 ? l.anchor : x.get(l.b);
+    glm::vec3 d = x.get(l.a) - other;
+    float length = glm::length(d);
+    if (length <= 0.0f)
+      continue;
+    float extension = length - l.rest_length;
+    // a push only spring has released the particle
+    if (l.push_only && extension > 0.0f)
+      continue;
+    glm::vec3 f = d * (-l.stiffness * extension / length);
+    out.add(l.a, f * particles.inv_mass[l.a]);
+    if (l.b >= 0)
+      out.add(l.b, -f * particles.inv_mass[l.b]);
+  }
+  add_mutual_gravity(x, out);
+}
+
+void ode_system::external_accelerations(const vec3_array& x, vec3_array& out) const {
+  particles.accelerations(gravity, out);
+  add_mutual_gravity(x, out);
+}
+
+void ode_system::add_mutual_gravity(const vec3_array& x, vec3_array& out) const {
+  if (mutual_gravity && size() > 1) {
+    if (size() < gravity_tree::direct_limit) {
+      gravity_direct(x, particles.mass, attraction.gravitational_constant, attraction.softening, out);
+    } else {
+      attraction.build(x, particles.mass);
+      attraction.accumulate(out, pool);
+    }
+  }
+}
+
+bool ode_system::resolve_contacts() {
+  bool moved = false;
+  if (collide_particles && size() > 1) {
+    grid.build(particles);
+    grid.resolve(particles, restitution);
+    moved = grid.contacts > 0;
+  }
+  for (const contact& c : contacts)
+    moved = particles.collide_plane(c.point, c.normal, restitution) || moved;
+  return moved;
+}
+
+// semi-implicit euler
+void euler::step(ode_system& s, float dt) {
+  s.accelerations(s.particles.position, s.particles.velocity, m_acceleration);
+  s.particles.integrate(m_acceleration, dt);
+  s.resolve_contacts();
+}
+
+// velocity verlet
+void verlet::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  if (!m_primed || m_acceleration.size() != s.size()) {
+    s.accelerations(p.position, p.velocity, m_acceleration);
+    m_primed = true;
+  }
+  axpy(p.position, p.velocity, dt);
+  axpy(p.position, m_acceleration, 0.5f * dt * dt);
+  s.accelerations(p.position, p.velocity, m_next_acceleration);
+  axpy(p.velocity, m_acceleration, 0.5f * dt);
+  axpy(p.velocity, m_next_acceleration, 0.5f * dt);
+  std::swap(m_acceleration, m_next_acceleration);
+  // a contact moves the state the closing acceleration was taken at
+  if (s.resolve_contacts())
+    m_primed = false;
+}
+
+// yoshida 4
+void yoshida4::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  if (!m_primed || m_acceleration.size() != s.size()) {
+    s.accelerations(p.position, p.velocity, m_acceleration);
+    m_primed = true;
+  }
+  // weights 1/(2 - 2^(1/3)) and -2^(1/3)/(2 - 2^(1/3)), summing to one
+  const float cube_root = std::cbrt(2.0f);
+  const float outer = 1.0f / (2.0f - cube_root);
+  const float weights[3] = { outer, -cube_root * outer, outer };
+  for (float w : weights) {
+    const float h = w * dt;
+    axpy(p.velocity, m_acceleration, 0.5f * h);
+    axpy(p.position, p.velocity, h);
+    s.accelerations(p.position, p.velocity, m_acceleration);
+    axpy(p.velocity, m_acceleration, 0.5f * h);
+  }
+  if (s.resolve_contacts())
+    m_primed = false;
+}
+
+// runge-kutta 4
+void rk4::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  // stage 1 at the current state
+  m_kx[0] = p.velocity;
+  s.accelerations(p.position, p.velocity, m_kv[0]);
+  // stages 2 to 4, each evaluated from the previous slope
+  const float weights[3] = { 0.5f, 0.5f, 1.0f };
+  for (int k = 1; k < 4; k++) {
+    float h = dt * weights[k - 1];
+    madd(m_x, p.position, m_kx[k - 1], h);
+    madd(m_v, p.velocity, m_kv[k - 1], h);
+    m_kx[k] = m_v;
+    s.accelerations(m_x, m_v, m_kv[k]);
+  }
+  // combine slopes with weights 1, 2, 2, 1
+  const float sum[4] = { dt / 6.0f, dt / 3.0f, dt / 3.0f, dt / 6.0f };
+  for (int k = 0; k < 4; k++) {
+    axpy(p.position, m_kx[k], sum[k]);
+    axpy(p.velocity, m_kv[k], sum[k]);
+  }
+  s.resolve_contacts();
+}
+
+// implicit euler
+void implicit_euler::reset() {
+  m_pattern_links = 0;
+  m_pattern_rows = 0;
+  m_matrix = block_sparse_matrix();
+  m_dv.clear();
+  unconverged = 0;
+}
+
+void implicit_euler::build_pattern(const ode_system& s) {
+  std::vector<std::pair<int, int>> pairs;
+  for (const ode_system::link& l : s.links) {
+    if (l.b >= 0 && l.b != l.a)
+      pairs.push_back(std::make_pair(l.a, l.b));
+  }
+  m_matrix.build_pattern(s.size(), pairs);
+  m_slots.resize(4 * s.links.size());
+  for (size_t i = 0; i < s.links.size(); i++) {
+    const ode_system::link& l = s.links[i];
+    bool coupled = l.b >= 0 && l.b != l.a;
+    m_slots[4 * i] = m_matrix.diagonal[l.a];
+    m_slots[4 * i + 1] = coupled ? (int)m_matrix.diagonal[l.b] : -1;
+    m_slots[4 * i + 2] = coupled ? m_matrix.find(l.a, l.b) : -1;
+    m_slots[4 * i + 3] = coupled ? m_matrix.find(l.b, l.a) : -1;
+  }
+  m_pattern_links = s.links.size();
+  m_pattern_rows = s.size();
+  m_dv.assign(3 * s.size(), 0.0f);
+}
+
+// blocks[slot] += s*k
+static void add_block(block_sparse_matrix& m, int slot, const block3& k, float s) {
+  if (slot < 0)
+    return;
+  for (int i = 0; i < 9; i++)
+    m.blocks[slot].m[i] += s * k.m[i];
+}
+
+void implicit_euler::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  const size_t n = s.size();
+  if (m_pattern_links != s.links.size() || m_pattern_rows != n)
+    build_pattern(s);
+  // every force at the start of the step
+  s.accelerations(p.position, p.velocity, m_acceleration);
+
+  // A = M - h^2 K
+  m_matrix.set_zero();
+  for (size_t i = 0; i < n; i++) {
+    block3& d = m_matrix.blocks[m_matrix.diagonal[i]];
+    d.m[0] = d.m[4] = d.m[8] = p.mass[i];
+  }
+  m_kv.assign(3 * n, 0.0f);
+  const float h2 = dt * dt;
+  for (size_t i = 0; i < s.links.size(); i++) {
+    const ode_system::link& l = s.links[i];
+    glm::vec3 other = l.b < 0 ? l.anchor : p.position.get(l.b);
+    glm::vec3 d = p.position.get(l.a) - other;
+    float length = glm::length(d);
+    if (length <= 0.0f)
+      continue;
+    // a push only spring that has released adds nothing, as in accelerations()
+    if (l.push_only && length > l.rest_length)
+      continue;
+    // jacobian of the spring force on a with respect to a's position,
+    // -k (n n^T + (1 - L/l)(I - n n^T)), the transverse part dropped while
+    // compressed so the matrix stays definite
+    glm::vec3 u = d / length;
+    float transverse = std::max(0.0f, 1.0f - l.rest_length / length);
+    block3 k;
+    for (int r = 0; r < 3; r++)
+      for (int c = 0; c < 3; c++)
+        k.m[3 * r + c] = -l.stiffness * ((1.0f - transverse) * u[r] * u[c] + (r == c ? transverse : 0.0f));
+    add_block(m_matrix, m_slots[4 * i], k, -h2);
+    add_block(m_matrix, m_slots[4 * i + 1], k, -h2);
+    add_block(m_matrix, m_slots[4 * i + 2], k, h2);
+    add_block(m_matrix, m_slots[4 * i + 3], k, h2);
+    // K v, the spring force change the step's velocity will cause
+    glm::vec3 dv = p.velocity.get(l.a) - (l.b < 0 ? glm::vec3(0.0f) : p.velocity.get(l.b));
+    float rel[3] = { dv.x, dv.y, dv.z };
+    float kv[3] = { 0.0f, 0.0f, 0.0f };
+    k.multiply_add(rel, kv);
+    for (int c = 0; c < 3; c++) {
+      m_kv[3 * l.a + c] += kv[c];
+      if (l.b >= 0)
+        m_kv[3 * l.b + c] -= kv[c];
+    }
+  }
+
+  // b = h (f + h K v)
+  m_rhs.resize(3 * n);
+  for (size_t i = 0; i < n; i++) {
+    m_rhs[3 * i] = dt * (p.mass[i] * m_acceleration.x[i] + dt * m_kv[3 * i]);
+    m_rhs[3 * i + 1] = dt * (p.mass[i] * m_acceleration.y[i] + dt * m_kv[3 * i + 1]);
+    m_rhs[3 * i + 2] = dt * (p.mass[i] * m_acceleration.z[i] + dt * m_kv[3 * i + 2]);
+  }
+  // the last step's change is a close first guess for a smooth motion
+  if (!solver.solve(m_matrix, m_rhs, m_dv))
+    unconverged++;
+
+  for (size_t i = 0; i < n; i++)
+    p.velocity.add(i, glm::vec3(m_dv[3 * i], m_dv[3 * i + 1], m_dv[3 * i + 2]));
+  axpy(p.position, p.velocity, dt);
+  s.resolve_contacts();
+}
+
+// position based dynamics
+void pbd::project(ode_system& s, unsigned int i, float alpha) {
+  const ode_system::link& l = s.links[i];
+  vec3_array& x = s.particles.position;
+  const std::vector<float>& w = s.particles.inv_mass;
+  float dx = x.x[l.a], dy = x.y[l.a], dz = x.z[l.a];
+  if (l.b < 0) {
+    dx -= l.anchor.x;
+    dy -= l.anchor.y;
+    dz -= l.anchor.z;
+  } else {
+    dx -= x.x[l.b];
+    dy -= x.y[l.b];
+    dz -= x.z[l.b];
+  }
+  float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+  if (length <= 0.0f)
+    return;
+  float c = length - l.rest_length;
+  // a push only spring has released the particle
+  if ((l.push_only && c > 0.0f) || l.stiffness <= 0.0f)
+    return;
+  float wa = w[l.a], wb = l.b < 0 ? 0.0f : w[l.b];
+  // compliance, the inverse stiffness scaled by the step
+  float a = alpha / l.stiffness;
+  if (wa + wb + a <= 0.0f)
+    return;
+  float dlambda = (-c - a * m_lambda[i]) / (wa + wb + a);
+  m_lambda[i] += dlambda;
+  float k = dlambda / length;
+  x.x[l.a] += wa * k * dx;
+  x.y[l.a] += wa * k * dy;
+  x.z[l.a] += wa * k * dz;
+  if (l.b >= 0) {
+    x.x[l.b] -= wb * k * dx;
+    x.y[l.b] -= wb * k * dy;
+    x.z[l.b] -= wb * k * dz;
+  }
+}
+
+void pbd::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  const size_t n = s.size();
+  if (m_coloured_links != s.links.size() || m_coloured_rows != n) {
+    std::vector<std::pair<int, int>> ends;
+    for (const ode_system::link& l : s.links)
+      ends.push_back(std::make_pair(l.a, l.b == l.a ? -1 : l.b));
+    m_colouring.build(n, ends);
+    m_coloured_links = s.links.size();
+    m_coloured_rows = n;
+  }
+  // predict from the external forces
+  s.external_accelerations(p.position, m_acceleration);
+  axpy(p.velocity, m_acceleration, dt);
+  m_previous = p.position;
+  axpy(p.position, p.velocity, dt);
+
+  // project the links, a colour at a time
+  m_lambda.assign(s.links.size(), 0.0f);
+  const float alpha = 1.0f / (dt * dt);
+  for (unsigned int it = 0; it < iterations; it++) {
+    for (size_t c = 0; c < m_colouring.colours(); c++) {
+      const unsigned int first = m_colouring.colour_start[c];
+      const unsigned int end = m_colouring.colour_start[c + 1];
+      const size_t chunks = (end - first + chunk_links - 1) / chunk_links;
+      auto job = [&](size_t k) {
+        size_t last = std::min((size_t)end, first + (k + 1) * chunk_links);
+        for (size_t j = first + k * chunk_links; j < last; j++)
+          project(s, m_colouring.order[j], alpha);
+      };
+      if (pool && chunks > 1) {
+        pool->run(chunks, job);
+      } else {
+        for (size_t k = 0; k < chunks; k++)
+          job(k);
+      }
+    }
+  }
+
+  // velocity from the corrected positions
+  const float inv_dt = 1.0f / dt;
+  for (size_t i = 0; i < n; i++) {
+    p.velocity.x[i] = (p.position.x[i] - m_previous.x[i]) * inv_dt;
+    p.velocity.y[i] = (p.position.y[i] - m_previous.y[i]) * inv_dt;
+    p.velocity.z[i] = (p.position.z[i] - m_previous.z[i]) * inv_dt;
+  }
+  s.resolve_contacts();
+}
+
+// constrained euler
+void constrained_euler::reset() {
+  m_coloured_rods = 0;
+  m_coloured_rows = 0;
+}
+
+void constrained_euler::apply(ode_system& s, const ode_system::rod& r, glm::vec3 n, float impulse) {
+  particle_store& p = s.particles;
+  p.velocity.add(r.a, n * (impulse * p.inv_mass[r.a]));
+  if (r.b >= 0)
+    p.velocity.add(r.b, n * (-impulse * p.inv_mass[r.b]));
+}
+
+void constrained_euler::solve(ode_system& s, unsigned int i) {
+  const ode_system::rod& r = s.rods[i];
+  particle_store& p = s.particles;
+  glm::vec3 d = p.position.get(r.a) - (r.b < 0 ? r.anchor : p.position.get(r.b));
+  float w = p.inv_mass[r.a] + (r.b < 0 ? 0.0f : p.inv_mass[r.b]);
+  if (w <= 0.0f)
+    return;
+  auto relative = [&]() {
+    return p.velocity.get(r.a) - (r.b < 0 ? glm::vec3(0.0f) : p.velocity.get(r.b));
+  };
+  // cancel the stretching speed along the rod
+  float length = glm::length(d);
+  if (length > 0.0f) {
+    glm::vec3 n = d / length;
+    float impulse = -glm::dot(n, relative()) / w;
+    m_impulse[i] += impulse;
+    apply(s, r, n, impulse);
+  }
+  // and the speed out of the hinge plane
+  if (r.hinged) {
+    float impulse = -glm::dot(r.axis, relative()) / w;
+    m_hinge_impulse[i] += impulse;
+    apply(s, r, r.axis, impulse);
+  }
+}
+
+void constrained_euler::project(ode_system& s, unsigned int i) {
+  const ode_system::rod& r = s.rods[i];
+  particle_store& p = s.particles;
+  float wa = p.inv_mass[r.a], wb = r.b < 0 ? 0.0f : p.inv_mass[r.b];
+  if (wa + wb <= 0.0f)
+    return;
+  auto move = [&](glm::vec3 correction) {
+    p.position.add(r.a, correction * (wa / (wa + wb)));
+    if (r.b >= 0)
+      p.position.add(r.b, correction * (-wb / (wa + wb)));
+  };
+  glm::vec3 d = p.position.get(r.a) - (r.b < 0 ? r.anchor : p.position.get(r.b));
+  if (r.hinged) {
+    move(r.axis * -glm::dot(r.axis, d));
+    d -= r.axis * glm::dot(r.axis, d);
+  }
+  float length = glm::length(d);
+  if (length > 0.0f)
+    move(d * ((r.length - length) / length));
+}
+
+template <typename F> void constrained_euler::for_colours(F fn) {
+  for (size_t c = 0; c < m_colouring.colours(); c++) {
+    const unsigned int first = m_colouring.colour_start[c];
+    const unsigned int end = m_colouring.colour_start[c + 1];
+    const size_t chunks = (end - first + chunk_rods - 1) / chunk_rods;
+    auto job = [&](size_t k) {
+      size_t last = std::min((size_t)end, first + (k + 1) * chunk_rods);
+      for (size_t j = first + k * chunk_rods; j < last; j++)
+        fn(m_colouring.order[j]);
+    };
+    if (pool && chunks > 1) {
+      pool->run(chunks, job);
+    } else {
+      for (size_t k = 0; k < chunks; k++)
+        job(k);
+    }
+  }
+}
+
+void constrained_euler::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  const size_t n = s.size();
+  if (m_coloured_rods != s.rods.size() || m_coloured_rows != n) {
+    std::vector<std::pair<int, int>> ends;
+    for (const ode_system::rod& r : s.rods)
+      ends.push_back(std::make_pair(r.a, r.b == r.a ? -1 : r.b));
+    m_colouring.build(n, ends);
+    m_coloured_rods = s.rods.size();
+    m_coloured_rows = n;
+    m_impulse.assign(s.rods.size(), 0.0f);
+    m_hinge_impulse.assign(s.rods.size(), 0.0f);
+  }
+  s.accelerations(p.position, p.velocity, m_acceleration);
+  axpy(p.velocity, m_acceleration, dt);
+
+  // start from the last step's impulses, along the rods as they are now
+  for (size_t i = 0; i < s.rods.size(); i++) {
+    const ode_system::rod& r = s.rods[i];
+    if (!warm_start) {
+      m_impulse[i] = 0.0f;
+      m_hinge_impulse[i] = 0.0f;
+      continue;
+    }
+    glm::vec3 d = p.position.get(r.a) - (r.b < 0 ? r.anchor : p.position.get(r.b));
+    float length = glm::length(d);
+    if (length > 0.0f)
+      apply(s, r, d / length, m_impulse[i]);
+    if (r.hinged)
+      apply(s, r, r.axis, m_hinge_impulse[i]);
+  }
+  for (unsigned int it = 0; it < iterations; it++)
+    for_colours([&](unsigned int i) { solve(s, i); });
+  axpy(p.position, p.velocity, dt);
+  for (unsigned int it = 0; it < position_iterations; it++)
+    for_colours([&](unsigned int i) { project(s, i); });
+  s.resolve_contacts();
+}
+
+// dormand-prince 5(4)
+// butcher tableau, the fifth order weights are the last row
+static const float dp_a[7][6] = {
+  { 0.0f },
+  { 1.0f / 5.0f },
+  { 3.0f / 40.0f, 9.0f / 40.0f },
+  { 44.0f / 45.0f, -56.0f / 15.0f, 32.0f / 9.0f },
+  { 19372.0f / 6561.0f, -25360.0f / 2187.0f, 64448.0f / 6561.0f, -212.0f / 729.0f },
+  { 9017.0f / 3168.0f, -355.0f / 33.0f, 46732.0f / 5247.0f, 49.0f / 176.0f, -5103.0f / 18656.0f },
+  { 35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f },
+};
+// fifth minus fourth order weights, the error estimate
+static const float dp_e[7] = {
+  71.0f / 57600.0f, 0.0f, -71.0f / 16695.0f, 71.0f / 1920.0f, -17253.0f / 339200.0f, 22.0f / 525.0f, -1.0f / 40.0f,
+};
+// weights of the fourth order continuous extension, as in hairer's dopri5
+static const float dp_d[7] = {
+  -12715105075.0f / 11282082432.0f, 0.0f, 87487479700.0f / 32700410799.0f, -10690763975.0f / 1880347072.0f,
+  701980252875.0f / 199316789632.0f, -1453857185.0f / 822651844.0f, 69997945.0f / 29380423.0f,
+};
+
+void dormand_prince::reset() {
+  m_primed = false;
+  m_slope_ready = false;
+  m_reuse_last = false;
+  m_time = 0.0;
+  m_output_time = 0.0;
+  m_last_step = 0.0f;
+  m_h = 0.0f;
+  accepted = 0;
+  rejected = 0;
+  evaluations = 0;
+  smallest_step = 0.0f;
+  largest_step = 0.0f;
+}
+
+float dormand_prince::attempt(ode_system& s, float h) {
+  const size_t n = m_x.size();
+  if (m_reuse_last) {
+    std::swap(m_kx[0], m_kx[6]);
+    std::swap(m_kv[0], m_kv[6]);
+    m_reuse_last = false;
+    m_slope_ready = true;
+  }
+  if (!m_slope_ready) {
+    m_kx[0] = m_v;
+    s.accelerations(m_x, m_v, m_kv[0]);
+    evaluations++;
+    m_slope_ready = true;
+  }
+  // stages 2 to 7, the last at the fifth order solution
+  for (int k = 1; k < 7; k++) {
+    vec3_array& out_x = k == 6 ? m_nx : m_sx;
+    vec3_array& out_v = k == 6 ? m_nv : m_sv;
+    out_x = m_x;
+    out_v = m_v;
+    for (int j = 0; j < k; j++) {
+      if (dp_a[k][j] == 0.0f)
+        continue;
+      axpy(out_x, m_kx[j], h * dp_a[k][j]);
+      axpy(out_v, m_kv[j], h * dp_a[k][j]);
+    }
+    m_kx[k] = out_v;
+    s.accelerations(out_x, out_v, m_kv[k]);
+    evaluations++;
+  }
+  // rms of the error over the allowed error of every component
+  double sum = 0.0;
+  auto norm = [&](const vec3_array& y, const vec3_array& next, const vec3_array* slope) {
+    for (std::vector<float> vec3_array::*c : { &vec3_array::x, &vec3_array::y, &vec3_array::z }) {
+      for (size_t i = 0; i < n; i++) {
+        float error = 0.0f;
+        for (int k = 0; k < 7; k++)
+          error += dp_e[k] * (slope[k].*c)[i];
+        float scale = tolerance * (1.0f + std::max(std::fabs((y.*c)[i]), std::fabs((next.*c)[i])));
+        float r = h * error / scale;
+        sum += (double)r * r;
+      }
+    }
+  };
+  norm(m_x, m_nx, m_kx);
+  norm(m_v, m_nv, m_kv);
+  return n ? (float)std::sqrt(sum / (6.0 * n)) : 0.0f;
+}
+
+void dormand_prince::interpolate(ode_system& s, float theta) {
+  const float h = m_last_step;
+  const float u = 1.0f - theta;
+  auto blend = [&](const vec3_array& y0, const vec3_array& y1, const vec3_array* slope, vec3_array& out) {
+    for (std::vector<float> vec3_array::*c : { &vec3_array::x, &vec3_array::y, &vec3_array::z }) {
+      for (size_t i = 0; i < y0.size(); i++) {
+        float diff = (y1.*c)[i] - (y0.*c)[i];
+        float b = h * (slope[0].*c)[i] - diff;
+        float r4 = diff - h * (slope[6].*c)[i] - b;
+        float r5 = 0.0f;
+        for (int k = 0; k < 7; k++)
+          r5 += dp_d[k] * (slope[k].*c)[i];
+        (out.*c)[i] = (y0.*c)[i] + theta * (diff + u * (b + theta * (r4 + u * h * r5)));
+      }
+    }
+  };
+  blend(m_px, m_nx, m_kx, s.particles.position);
+  blend(m_pv, m_nv, m_kv, s.particles.velocity);
+}
+
+void dormand_prince::step(ode_system& s, float dt) {
+  particle_store& p = s.particles;
+  if (!m_primed || m_x.size() != s.size()) {
+    m_x = p.position;
+    m_v = p.velocity;
+    m_time = 0.0;
+    m_output_time = 0.0;
+    m_slope_ready = false;
+    m_reuse_last = false;
+    m_h = max_step > 0.0f ? std::min(dt, max_step) : dt;
+    m_primed = true;
+  }
+  const double target = m_output_time + dt;
+  // no growth straight after a rejection, as in hairer's dopri5
+  bool retried = false;
+  while (m_time < target) {
+    float h = m_h;
+    if (max_step > 0.0f)
+      h = std::min(h, max_step);
+    float error = attempt(s, h);
+    if (!(error <= 1.0f)) {
+      // shrink by the error, never below a tenth
+      rejected++;
+      retried = true;
+      m_h = h * std::max(0.1f, std::isfinite(error) ? 0.9f * std::pow(error, -0.2f) : 0.1f);
+      continue;
+    }
+    // contacts on the accepted state. a step that ends further inside a
+    // plane or particle than the tolerance allows is retried shorter, the
+    // depth falls with the time since the impact
+    p.position = m_nx;
+    p.velocity = m_nv;
+    s.resolve_contacts();
+    bool contact = false;
+    float depth = 0.0f;
+    for (size_t i = 0; i < p.size(); i++) {
+      glm::vec3 x = m_nx.get(i);
+      float d = glm::length(p.position.get(i) - x);
+      contact = contact || d > 0.0f || p.velocity.get(i) != m_nv.get(i);
+      depth = std::max(depth, d / (tolerance * (1.0f + glm::length(x))));
+    }
+    if (depth > 1.0f && h > contact_step) {
+      rejected++;
+      retried = true;
+      m_h = std::max(contact_step, h * std::min(0.5f, std::max(0.1f, 0.9f / depth)));
+      continue;
+    }
+    accepted++;
+    smallest_step = accepted == 1 ? h : std::min(smallest_step, h);
+    largest_step = std::max(largest_step, h);
+    std::swap(m_px, m_x);
+    std::swap(m_pv, m_v);
+    m_x = p.position;
+    m_v = p.velocity;
+    m_time += h;
+    m_last_step = h;
+    // the final stage is the next step's first slope unless a contact
+    // changed the state, taken over when that step begins so the dense
+    // output still sees this step's stages
+    m_slope_ready = false;
+    m_reuse_last = !contact;
+    m_h = h * std::min(retried ? 1.0f : 5.0f, std::max(0.2f, error > 0.0f ? 0.9f * std::pow(error, -0.2f) : 5.0f));
+    retried = false;
+  }
+  m_output_time = target;
+  interpolate(s, m_last_step > 0.0f ? (float)((target - (m_time - m_last_step)) / m_last_step) : 1.0f);
+}
@@ -0,0 +1,314 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "collision.hpp"
+#include "colouring.hpp"
+#include "gravity_tree.hpp"
+#include "particle_store.hpp"
+#include "sparse.hpp"
+
+// particle system advanced by a numerical integrator
+// particles live in a structure of arrays store, forces come from
+// gravity, a constant applied force, springs and optionally the mutual
+// gravitation of the particles, planes and optionally other particles are
+// resolved as contacts after each step
+struct ode_system {
+  // spring between two particles, or a particle and a fixed anchor
+  struct link {
+    int a;
+    // second particle, -1 when the spring is fixed to 'anchor'
+    int b;
+    glm::vec3 anchor;
+    float rest_length;
+    // hooke constant, modulus of elasticity over natural length
+    float stiffness;
+    // springs that only push release the particle at natural length
+    bool push_only;
+  };
+  // rigid rod between two particles, or a particle and a fixed anchor,
+  // held at its length by the constrained solver. a hinged rod also keeps
+  // particle a in the plane through b normal to 'axis', so it swings
+  // about the axis alone
+  struct rod {
+    int a;
+    int b;
+    glm::vec3 anchor;
+    float length;
+    bool hinged;
+    glm::vec3 axis;
+  };
+  // plane contact, particles are kept on the positive side of the normal
+  struct contact {
+    glm::vec3 point;
+    glm::vec3 normal;
+  };
+
+  particle_store particles;
+  std::vector<link> links;
+  std::vector<rod> rods;
+  std::vector<contact> contacts;
+  glm::vec3 gravity;
+  float restitution;
+  // particle against particle collisions through the broad phase grid
+  bool collide_particles;
+  collision_grid grid;
+  // particles attract each other through a barnes-hut tree, rebuilt from
+  // the positions of every accelerations() call, or by the direct sum
+  // while there are few of them
+  bool mutual_gravity;
+  mutable gravity_tree attraction;
+  // pool the gravity tree walk is split across, when given
+  thread_pool* pool;
+
+  ode_system()
+      : gravity(0.0f, -9.8f, 0.0f), restitution(0.5f), collide_particles(false), mutual_gravity(false), pool(NULL) {}
+
+  // add a particle, returns its index
+  int add_particle(glm::vec3 position, glm::vec3 velocity, float mass, float radius);
+  size_t size() const { return particles.size(); }
+  // write the acceleration of every particle for the given state into 'out'
+  void accelerations(const vec3_array& x, const vec3_array& v, vec3_array& out) const;
+  // the same without the spring forces, for solvers that handle the
+  // links as constraints
+  void external_accelerations(const vec3_array& x, vec3_array& out) const;
+  // separate colliding particles, then push particles out of planes
+  // and reflect their normal velocity. returns whether any particle was
+  // moved, so accelerations kept from before are stale
+  bool resolve_contacts();
+
+private:
+  void add_mutual_gravity(const vec3_array& x, vec3_array& out) const;
+};
+
+// integrator interface
+// step() advances the system by dt seconds
+class integrator {
+public:
+  virtual ~integrator() {}
+  virtual void step(ode_system& system, float dt) = 0;
+  // drop any state cached between steps, called when the system is rebuilt
+  virtual void reset() {}
+  virtual const char* get_name() const = 0;
+};
+
+// semi-implicit (symplectic) euler, velocity first then position
+class euler : public integrator {
+  vec3_array m_acceleration;
+public:
+  void step(ode_system& system, float dt) override;
+  const char* get_name() const override { return "semi-implicit euler"; }
+};
+
+// velocity verlet, reuses the acceleration from the end of the last step
+// unless a contact has moved a particle since
+// the kick-drift-kick leapfrog, symplectic and second order, so the energy
+// of a spring system oscillates about its true value instead of drifting
+class verlet : public integrator {
+  vec3_array m_acceleration;
+  vec3_array m_next_acceleration;
+  bool m_primed;
+public:
+  verlet() : m_primed(false) {}
+  void step(ode_system& system, float dt) override;
+  void reset() override { m_primed = false; }
+  const char* get_name() const override { return "velocity verlet"; }
+};
+
+// yoshida's fourth order composition of three leapfrog steps, the middle
+// one backwards in time. symplectic like verlet, with an energy error that
+// falls with dt^4, so long runs keep their energy at longer steps. the
+// state is float, so below an error of a few 1e-6 rounding dominates and
+// it gains little on verlet. the acceleration ending each leapfrog starts
+// the next, three evaluations a step, and the last is dropped when a
+// contact moves a particle. contacts and released springs are not
+// smooth, near them it is no better than verlet
+class yoshida4 : public integrator {
+  vec3_array m_acceleration;
+  bool m_primed;
+public:
+  yoshida4() : m_primed(false) {}
+  void step(ode_system& system, float dt) override;
+  void reset() override { m_primed = false; }
+  const char* get_name() const override { return "yoshida 4"; }
+};
+
+// classic fourth order runge-kutta
+class rk4 : public integrator {
+  vec3_array m_x, m_v;
+  vec3_array m_kx[4], m_kv[4];
+public:
+  void step(ode_system& system, float dt) override;
+  const char* get_name() const override { return "runge-kutta 4"; }
+};
+
+// dormand-prince 5(4), adaptive steps with dense output
+// internal steps are sized by the difference between the embedded fifth
+// and fourth order solutions, growing through smooth motion and shrinking
+// where a spring releases. steps run free of the step() calls, and the
+// state at the end of each call is interpolated from the step spanning it.
+// contacts are resolved after every accepted step, and a step that ends
+// deeper inside a plane or another particle than the tolerance allows is
+// retried shorter, down to contact_step, so a bounce lands close to its
+// real time
+class dormand_prince : public integrator {
+  // state at m_time, and where the last accepted step began
+  vec3_array m_x, m_v;
+  vec3_array m_px, m_pv;
+  // end of the last accepted step before contacts, for dense output
+  vec3_array m_nx, m_nv;
+  // stages, the position slope is the stage velocity
+  vec3_array m_kx[7], m_kv[7];
+  vec3_array m_sx, m_sv;
+  double m_time;
+  // time the system state was last written for, and length of the last
+  // accepted step
+  double m_output_time;
+  float m_last_step;
+  // step to try next
+  float m_h;
+  // m_kx[0], m_kv[0] hold the slope at m_time, or m_kx[6], m_kv[6] do
+  // after a step that ended without a contact
+  bool m_slope_ready;
+  bool m_reuse_last;
+  bool m_primed;
+  // one attempted step of length h into m_nx, m_nv, returns the error norm
+  float attempt(ode_system& system, float h);
+  // state at m_time - m_last_step + theta * m_last_step into the system
+  void interpolate(ode_system& system, float theta);
+
+public:
+  // relative and absolute error allowed per step
+  float tolerance;
+  // longest step, 0 for no limit, and the shortest an impact is retried at
+  float max_step;
+  float contact_step;
+  // statistics since the last reset()
+  unsigned long accepted;
+  unsigned long rejected;
+  unsigned long evaluations;
+  float smallest_step;
+  float largest_step;
+
+  dormand_prince(float tolerance = 1e-4f)
+      : m_time(0.0), m_output_time(0.0), m_last_step(0.0f), m_h(0.0f), m_slope_ready(false), m_reuse_last(false),
+        m_primed(false),
+        tolerance(tolerance), max_step(0.0f), contact_step(1e-6f) { reset(); }
+  void step(ode_system& system, float dt) override;
+  void reset() override;
+  const char* get_name() const override { return "dormand-prince 45"; }
+};
+
+// backward euler, implicit in the spring forces
+// each step solves (M - h^2 K) dv = h (f + h K v) for the velocity change,
+// K being the spring stiffness matrix at the start of the step, so stiff
+// springs stay stable at steps far past the explicit limit. the system is
+// assembled into a block sparse matrix over the spring network and solved
+// by preconditioned conjugate gradient, warm started from the last step
+class implicit_euler : public integrator {
+  block_sparse_matrix m_matrix;
+  // matrix slots of each link's (a, a), (b, b), (a, b) and (b, a) blocks,
+  // -1 for the blocks of an anchored link
+  std::vector<int> m_slots;
+  // links and particles the pattern was built for
+  size_t m_pattern_links;
+  size_t m_pattern_rows;
+  vec3_array m_acceleration;
+  std::vector<float> m_rhs;
+  std::vector<float> m_dv;
+  std::vector<float> m_kv;
+  void build_pattern(const ode_system& system);
+
+public:
+  conjugate_gradient solver;
+  // solves that ran out of iterations since the last reset()
+  unsigned int unconverged;
+  // the step itself is only first order accurate, a looser solve than
+  // the solver's default costs nothing visible
+  implicit_euler() : m_pattern_links(0), m_pattern_rows(0), unconverged(0) { solver.tolerance = 1e-3f; }
+  void step(ode_system& system, float dt) override;
+  void reset() override;
+  const char* get_name() const override { return "implicit euler"; }
+};
+
+// extended position based dynamics
+// particles move under the external forces alone, then every link is
+// projected as a distance constraint for a fixed number of iterations and
+// the velocities taken from the corrected positions. the compliance of a
+// link is the inverse of its stiffness, so a stiff spring acts as a rod
+// and a soft one keeps its elasticity, and the cost of a step is set by
+// 'iterations' alone, whatever the step length. links are coloured so
+// that none of one colour share a particle, and each colour is projected
+// in chunks across the pool when given
+class pbd : public integrator {
+  constraint_colouring m_colouring;
+  // links the colouring was built for
+  size_t m_coloured_links;
+  size_t m_coloured_rows;
+  vec3_array m_acceleration;
+  vec3_array m_previous;
+  // accumulated lagrange multiplier of each link over a step
+  std::vector<float> m_lambda;
+  void project(ode_system& system, unsigned int link, float alpha);
+
+public:
+  // links projected per pool job
+  static constexpr size_t chunk_links = 2048;
+
+  unsigned int iterations;
+  thread_pool* pool;
+  pbd(unsigned int iterations = 10) : m_coloured_links(0), m_coloured_rows(0), iterations(iterations), pool(NULL) {}
+  void step(ode_system& system, float dt) override;
+  void reset() override { m_coloured_links = 0; m_coloured_rows = 0; }
+  const char* get_name() const override { return "position based"; }
+  size_t get_colours() const { return m_colouring.colours(); }
+};
+
+// semi-implicit euler with rods solved by sequential impulses
+// after the forces change the velocities, every rod's relative velocity
+// along it, and across its hinge plane, is cancelled by impulses over a
+// fixed number of iterations. the impulses of the last step are applied
+// again first, so a resting chain starts each step from the answer of the
+// last. once the particles have moved, the drift the velocities left is
+// projected out of the positions directly, which keeps that correction
+// out of the impulses carried to the next step. rods are coloured so none
+// of one colour share a particle and each colour runs in chunks across
+// the pool when given
+class constrained_euler : public integrator {
+  constraint_colouring m_colouring;
+  size_t m_coloured_rods;
+  size_t m_coloured_rows;
+  vec3_array m_acceleration;
+  // accumulated impulse of each rod, along it and across its hinge
+  std::vector<float> m_impulse;
+  std::vector<float> m_hinge_impulse;
+  // one rod's velocity rows for one iteration
+  void solve(ode_system& system, unsigned int rod);
+  // move one rod's ends back onto its length and hinge plane
+  void project(ode_system& system, unsigned int rod);
+  // call fn(rod) for every rod a colour at a time
+  template <typename F> void for_colours(F fn);
+  // apply an impulse along 'n' to a rod's ends
+  static void apply(ode_system& system, const ode_system::rod& r, glm::vec3 n, float impulse);
+
+public:
+  // rods solved per pool job
+  static constexpr size_t chunk_rods = 2048;
+
+  unsigned int iterations;
+  unsigned int position_iterations;
+  bool warm_start;
+  thread_pool* pool;
+  constrained_euler(unsigned int iterations = 10)
+      : m_coloured_rods(0), m_coloured_rows(0), iterations(iterations), position_iterations(2),
+        warm_start(true), pool(NULL) {}
+  void step(ode_system& system, float dt) override;
+  void reset() override;
+  const char* get_name() const override { return "constrained euler"; }
+  size_t get_colours() const { return m_colouring.colours(); }
+};
+
+#endif // !INTEGRATOR_H
@@ -0,0 +1,169 @@
+#include "kepler.hpp"
+#include <algorithm>
+#include <cmath>
+#include "simd_math.hpp"
+#include "thread_pool.hpp"
+
+// groups per pool job
+static const size_t groups_per_job = 512;
+
+static const double two_pi = 6.283185307179586;
+
+void kepler_orbits::clear() {
+  m_phase.clear();
+  m_rate.clear();
+  m_e.clear();
+  m_origin.clear();
+  m_p.clear();
+  m_q.clear();
+  m_escaping.clear();
+  m_size = 0;
+}
+
+size_t kepler_orbits::add(glm::dvec3 position, glm::dvec3 velocity) {
+  const size_t index = m_size++;
+  glm::dvec3 r = position - centre;
+  const double distance = glm::length(r);
+  // lanes that stay at the centre
+  auto hold = [&]() {
+    m_phase.push_back(0.0);
+    m_rate.push_back(0.0);
+    m_e.push_back(0.0f);
+    m_origin.push_back(glm::vec3(centre));
+    m_p.push_back(glm::vec3(0.0f));
+    m_q.push_back(glm::vec3(0.0f));
+  };
+  if (distance <= 0.0) {
+    hold();
+    return index;
+  }
+  const double energy = 0.5 * glm::dot(velocity, velocity) - mu / distance;
+  glm::dvec3 h = glm::cross(r, velocity);
+  // eccentricity vector points at the periapsis
+  glm::dvec3 ev = glm::cross(velocity, h) / mu - r / distance;
+  double e = glm::length(ev);
+  // periapsis and the direction of travel across it, a circle starts its
+  // periapsis where the particle is
+  glm::dvec3 p = e > 1e-9 ? ev / e : r / distance;
+  glm::dvec3 normal = glm::length(h) > 0.0 ? glm::normalize(h) : glm::dvec3(0.0);
+  glm::dvec3 q = glm::cross(normal, p);
+  if (glm::length(q) == 0.0) {
+    // a radial drop, the semi-minor axis is zero so any normal will do
+    glm::dvec3 any = std::fabs(p.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+    q = glm::normalize(glm::cross(p, any));
+  }
+  const double radial = glm::dot(r, velocity);
+
+  if (energy < 0.0) {
+    const double a = -mu / (2.0 * energy);
+    const double b = a * std::sqrt(std::max(0.0, 1.0 - e * e));
+    // e*sin(E) and e*cos(E) where the particle starts
+    const double anomaly = e > 1e-9 ? std::atan2(radial / std::sqrt(mu * a), 1.0 - distance / a) : 0.0;
+    const double mean = anomaly - e * std::sin(anomaly);
+    m_phase.push_back(mean / two_pi);
+    m_rate.push_back(std::sqrt(mu / (a * a * a)) / two_pi);
+    m_e.push_back((float)e);
+    m_origin.push_back(glm::vec3(centre - p * (a * e)));
+    m_p.push_back(glm::vec3(p * a));
+    m_q.push_back(glm::vec3(q * b));
+  } else {
+    // the lanes leave it at the centre and the hyperbola overwrites it
+    hold();
+    hyperbola o;
+    o.index = index;
+    o.e = std::max(e, 1.0 + 1e-9);
+    const double a = mu / std::max(2.0 * energy, 1e-300);
+    const double b = a * std::sqrt(o.e * o.e - 1.0);
+    const double anomaly = std::asinh(radial / (o.e * std::sqrt(mu * a)));
+    o.anomaly = o.e * std::sinh(anomaly) - anomaly;
+    o.rate = std::sqrt(mu / (a * a * a));
+    o.origin = centre + p * (a * o.e);
+    o.p = -p * a;
+    o.q = q * b;
+    m_escaping.push_back(o);
+  }
+  return index;
+}
+
+void kepler_orbits::solve_group(double t, size_t i, vec3_array& out) const {
+  // mean anomaly in [-pi, pi), reduced in double
+  float mean[group];
+  for (size_t k = 0; k < group; k++) {
+    size_t o = std::min(i + k, m_size - 1);
+    double turns = m_phase[o] + m_rate[o] * t;
+    mean[k] = (float)((turns - std::floor(turns + 0.5)) * two_pi);
+  }
+  // every lane of a partial group reads an orbit, the last one repeated
+  float lanes[10][group];
+  const float* table[10];
+  const std::vector<float>* columns[10] = {
+    &m_e, &m_origin.x, &m_origin.y, &m_origin.z, &m_p.x, &m_p.y, &m_p.z, &m_q.x, &m_q.y, &m_q.z,
+  };
+  const bool whole = i + group <= m_size;
+  for (int c = 0; c < 10; c++) {
+    if (whole) {
+      table[c] = &(*columns[c])[i];
+    } else {
+      for (size_t k = 0; k < group; k++)
+        lanes[c][k] = (*columns[c])[std::min(i + k, m_size - 1)];
+      table[c] = lanes[c];
+    }
+  }
+  float x[group], y[group], z[group];
+  for (size_t k = 0; k < group; k += SIMD_WIDTH) {
+    const vfloat e = vload(table[0] + k);
+    const vfloat m = vload(mean + k);
+    // danby's start, E = M + 0.85e towards the apoapsis
+    vfloat s, c;
+    vsincos(m, s, c);
+    vfloat step = vmul(vset(0.85f), e);
+    vfloat anomaly = vadd(m, vselect_lt(s, vset(0.0f), vneg(step), step));
+    for (int n = 0; n < iterations; n++) {
+      // f = E - e*sin(E) - M, f' = 1 - e*cos(E)
+      vsincos(anomaly, s, c);
+      vfloat f = vsub(vsub(anomaly, vmul(e, s)), m);
+      vfloat slope = vsub(vset(1.0f), vmul(e, c));
+      anomaly = vsub(anomaly, vdiv(f, vmax(slope, vset(1e-6f))));
+    }
+    vsincos(anomaly, s, c);
+    vstore(x + k, vfmadd(vload(table[4] + k), c, vfmadd(vload(table[7] + k), s, vload(table[1] + k))));
+    vstore(y + k, vfmadd(vload(table[5] + k), c, vfmadd(vload(table[8] + k), s, vload(table[2] + k))));
+    vstore(z + k, vfmadd(vload(table[6] + k), c, vfmadd(vload(table[9] + k), s, vload(table[3] + k))));
+  }
+  const size_t end = std::min(group, m_size - i);
+  std::copy(x, x + end, &out.x[i]);
+  std::copy(y, y + end, &out.y[i]);
+  std::copy(z, z + end, &out.z[i]);
+}
+
+void kepler_orbits::positions(double t, vec3_array& out) const {
+  out.resize(m_size);
+  if (m_size == 0)
+    return;
+  const size_t groups = (m_size + group - 1) / group;
+  const size_t jobs = (groups + groups_per_job - 1) / groups_per_job;
+  auto job = [&](size_t j) {
+    const size_t end = std::min(groups, (j + 1) * groups_per_job);
+    for (size_t g = j * groups_per_job; g < end; g++)
+      solve_group(t, g * group, out);
+  };
+  if (pool && jobs > 1) {
+    pool->run(jobs, job);
+  } else {
+    for (size_t j = 0; j < jobs; j++)
+      job(j);
+  }
+  for (const hyperbola& o : m_escaping) {
+    // newton on e*sinh(H) - H = M from a start past the root
+    const double mean = o.anomaly + o.rate * t;
+    double anomaly = std::asinh(mean / o.e);
+    for (int n = 0; n < 50; n++) {
+      double f = o.e * std::sinh(anomaly) - anomaly - mean;
+      double step = f / (o.e * std::cosh(anomaly) - 1.0);
+      anomaly -= step;
+      if (std::fabs(step) <= 1e-12 * (1.0 + std::fabs(anomaly)))
+        break;
+    }
+    out.set(o.index, glm::vec3(o.origin + o.p * std::cosh(anomaly) + o.q * std::sinh(anomaly)));
+  }
+}
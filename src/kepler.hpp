@@ -0,0 +1,72 @@
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "particle_store.hpp"
+
+class thread_pool;
+
+// two body orbits about a fixed heavy centre
+// each orbit is reduced on add() to its conic, so positions() gives every
+// orbit at any time from kepler's equation with no stepping. bound orbits
+// solve it by newton's method in float lanes, eight orbits to a lane
+// group, one avx2 vector or two sse ones, always taking the same number
+// of iterations so no lane waits on another. the phase is advanced in
+// double before it reaches the lanes so long runs keep their place on the
+// orbit. orbits that escape follow their hyperbola one at a time
+class kepler_orbits {
+  // bound orbit i: turns through its mean anomaly at time 0 and per second
+  std::vector<double> m_phase;
+  std::vector<double> m_rate;
+  // eccentricity, and position = origin + p*cos(E) + q*sin(E) for the
+  // eccentric anomaly E, p along the periapsis scaled by the semi-major
+  // axis and q across it by the semi-minor
+  std::vector<float> m_e;
+  vec3_array m_origin;
+  vec3_array m_p;
+  vec3_array m_q;
+  // escaping orbits, position = origin + p*cosh(H) + q*sinh(H) as
+  // e*sinh(H) - H runs through its mean anomaly
+  struct hyperbola {
+    size_t index;
+    double e;
+    double anomaly;
+    double rate;
+    glm::dvec3 origin;
+    glm::dvec3 p;
+    glm::dvec3 q;
+  };
+  std::vector<hyperbola> m_escaping;
+  size_t m_size;
+
+  // positions of the lane group starting at orbit i
+  void solve_group(double t, size_t i, vec3_array& out) const;
+
+public:
+  // orbits per lane group, the tables are padded to a whole group
+  static constexpr size_t group = 8;
+  // newton iterations, enough for float from the starting guess at any
+  // eccentricity below 0.99
+  static constexpr int iterations = 5;
+
+  glm::dvec3 centre;
+  // gravitational constant times the central mass
+  double mu;
+  thread_pool* pool;
+
+  kepler_orbits() : m_size(0), centre(0.0), mu(1.0), pool(NULL) {}
+  // orbit of a particle at 'position' moving at 'velocity', returns its
+  // index. set centre and mu first
+  size_t add(glm::dvec3 position, glm::dvec3 velocity);
+  void clear();
+  size_t size() const { return m_size; }
+  size_t escaping() const { return m_escaping.size(); }
+  // every orbit's position at time t into 'out'
+  void positions(double t, vec3_array& out) const;
+};
+
+#endif // !KEPLER_H
@@ -0,0 +1,23 @@
+#ifndef MATHS_H
+#define MATHS_H
+
+#include <glm/glm.hpp>
+#include "utils.h"
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+// linear interpolate between two vectors
+inline glm::vec3 lerp3f(glm::vec3 x, glm::vec3 y, float t) {
+  return x * (1.f - t) + y * t;
+}
+
+inline float lerp1f(float x, float y, float t) {
+  return x * (1.f - t) + y * t;
+}
+
+// modify lerp value for a more organic motion
+inline double smooth(double x) { 
+  return tanh(sqrt(x) * 6 - M_PI) / 2 + 0.503; 
+}
+
+#endif // !MATHS_H
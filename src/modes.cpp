@@ -0,0 +1,288 @@
+#include "modes.hpp"
+#include <algorithm>
+#include <cmath>
+
+void symmetric_eigen(const std::vector<double>& a, size_t n, std::vector<double>& values,
+                     std::vector<double>& vectors) {
+  // householder reduction to tridiagonal form, then the implicit ql
+  // iteration on it, as in numerical recipes' tred2 and tqli
+  vectors = a;
+  values.assign(n, 0.0);
+  std::vector<double> e(n, 0.0);
+  std::vector<double>& z = vectors;
+  double* d = values.data();
+  for (size_t i = n - 1; i > 0; i--) {
+    const size_t l = i - 1;
+    double h = 0.0;
+    if (l > 0) {
+      double scale = 0.0;
+      for (size_t k = 0; k <= l; k++)
+        scale += std::fabs(z[i * n + k]);
+      if (scale == 0.0) {
+        e[i] = z[i * n + l];
+      } else {
+        for (size_t k = 0; k <= l; k++) {
+          z[i * n + k] /= scale;
+          h += z[i * n + k] * z[i * n + k];
+        }
+        double f = z[i * n + l];
+        double g = f >= 0.0 ? -std::sqrt(h) : std::sqrt(h);
+        e[i] = scale * g;
+        h -= f * g;
+        z[i * n + l] = f - g;
+        f = 0.0;
+        for (size_t j = 0; j <= l; j++) {
+          z[j * n + i] = z[i * n + j] / h;
+          g = 0.0;
+          for (size_t k = 0; k <= j; k++)
+            g += z[j * n + k] * z[i * n + k];
+          for (size_t k = j + 1; k <= l; k++)
+            g += z[k * n + j] * z[i * n + k];
+          e[j] = g / h;
+          f += e[j] * z[i * n + j];
+        }
+        const double hh = f / (h + h);
+        for (size_t j = 0; j <= l; j++) {
+          f = z[i * n + j];
+          e[j] = g = e[j] - hh * f;
+          for (size_t k = 0; k <= j; k++)
+            z[j * n + k] -= f * e[k] + g * z[i * n + k];
+        }
+      }
+    } else {
+      e[i] = z[i * n + l];
+    }
+    d[i] = h;
+  }
+  d[0] = 0.0;
+  e[0] = 0.0;
+  // accumulate the transformations into the eigenvectors
+  for (size_t i = 0; i < n; i++) {
+    if (d[i] != 0.0) {
+      for (size_t j = 0; j < i; j++) {
+        double g = 0.0;
+        for (size_t k = 0; k < i; k++)
+          g += z[i * n + k] * z[k * n + j];
+        for (size_t k = 0; k < i; k++)
+          z[k * n + j] -= g * z[k * n + i];
+      }
+    }
+    d[i] = z[i * n + i];
+    z[i * n + i] = 1.0;
+    for (size_t j = 0; j < i; j++)
+      z[j * n + i] = z[i * n + j] = 0.0;
+  }
+
+  for (size_t i = 1; i < n; i++)
+    e[i - 1] = e[i];
+  if (n > 0)
+    e[n - 1] = 0.0;
+  for (int l = 0; l < (int)n; l++) {
+    int m;
+    for (int iteration = 0; iteration < 64; iteration++) {
+      // split off a block once an off diagonal element is negligible
+      for (m = l; m < (int)n - 1; m++) {
+        double dd = std::fabs(d[m]) + std::fabs(d[m + 1]);
+        if (std::fabs(e[m]) <= 1e-15 * dd)
+          break;
+      }
+      if (m == l)
+        break;
+      double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+      double r = std::hypot(g, 1.0);
+      g = d[m] - d[l] + e[l] / (g + (g >= 0.0 ? r : -r));
+      double s = 1.0, c = 1.0, p = 0.0;
+      int i;
+      for (i = m - 1; i >= l; i--) {
+        double f = s * e[i], b = c * e[i];
+        e[i + 1] = r = std::hypot(f, g);
+        if (r == 0.0) {
+          d[i + 1] -= p;
+          e[m] = 0.0;
+          break;
+        }
+        s = f / r;
+        c = g / r;
+        g = d[i + 1] - p;
+        r = (d[i] - g) * s + 2.0 * c * b;
+        d[i + 1] = g + (p = s * r);
+        g = c * r - b;
+        for (size_t k = 0; k < n; k++) {
+          f = z[k * n + i + 1];
+          z[k * n + i + 1] = s * z[k * n + i] + c * f;
+          z[k * n + i] = c * z[k * n + i] - s * f;
+        }
+      }
+      if (r == 0.0 && i >= l)
+        continue;
+      d[l] -= p;
+      e[l] = g;
+      e[m] = 0.0;
+    }
+  }
+}
+
+bool spring_modes::build(const std::vector<glm::dvec3>& position, const std::vector<glm::dvec3>& velocity,
+                         const std::vector<double>& mass, const std::vector<glm::dvec3>& force,
+                         const std::vector<spring>& springs) {
+  const size_t particles = position.size();
+  m_size = 0;
+  m_start.clear();
+  m_coordinate.clear();
+  m_shape.clear();
+  m_mode_start.clear();
+  m_mode_coordinate.clear();
+  m_frequency.clear();
+  m_c.clear();
+  m_a.clear();
+  m_b.clear();
+  if (particles > max_particles)
+    return false;
+  const size_t n = particles * 3;
+  m_size = n;
+  m_start.resize(n);
+  std::vector<double> f(n), root_mass(n);
+  for (size_t i = 0; i < particles; i++) {
+    for (int k = 0; k < 3; k++) {
+      m_start[i * 3 + k] = position[i][k];
+      f[i * 3 + k] = force[i][k];
+      root_mass[i * 3 + k] = std::sqrt(mass[i]);
+    }
+  }
+  // stiffness, the jacobian of the spring forces at the start, and the
+  // spring forces there joining the constant ones
+  std::vector<double> k(n * n, 0.0);
+  for (const spring& s : springs) {
+    glm::dvec3 other = s.b < 0 ? s.anchor : position[s.b];
+    glm::dvec3 d = position[s.a] - other;
+    double length = glm::length(d);
+    if (length <= 0.0)
+      continue;
+    glm::dvec3 u = d / length;
+    // along the spring, and across it from the tension
+    double across = s.stiffness * (1.0 - s.rest_length / length);
+    glm::dvec3 pull = u * (-s.stiffness * (length - s.rest_length));
+    for (int r = 0; r < 3; r++) {
+      f[s.a * 3 + r] += pull[r];
+      if (s.b >= 0)
+        f[s.b * 3 + r] -= pull[r];
+      for (int c = 0; c < 3; c++) {
+        double block = (s.stiffness - across) * u[r] * u[c] + (r == c ? across : 0.0);
+        k[(s.a * 3 + r) * n + s.a * 3 + c] += block;
+        if (s.b >= 0) {
+          k[(s.b * 3 + r) * n + s.b * 3 + c] += block;
+          k[(s.a * 3 + r) * n + s.b * 3 + c] -= block;
+          k[(s.b * 3 + r) * n + s.a * 3 + c] -= block;
+        }
+      }
+    }
+  }
+  // mass weighted so the matrix stays symmetric
+  for (size_t r = 0; r < n; r++)
+    for (size_t c = 0; c < n; c++)
+      k[r * n + c] /= root_mass[r] * root_mass[c];
+
+  // coordinates no spring couples, the axes of a straight chain or two
+  // separate chains, are solved apart. the solve grows with the cube of
+  // its size, so this is far cheaper, and their modes only touch their
+  // own coordinates
+  std::vector<size_t> root(n);
+  for (size_t i = 0; i < n; i++)
+    root[i] = i;
+  auto find = [&](size_t i) {
+    while (root[i] != i)
+      i = root[i] = root[root[i]];
+    return i;
+  };
+  for (size_t r = 0; r < n; r++)
+    for (size_t c = r + 1; c < n; c++)
+      if (k[r * n + c] != 0.0)
+        root[find(r)] = find(c);
+  std::vector<std::vector<unsigned int>> groups(n);
+  for (size_t i = 0; i < n; i++)
+    groups[find(i)].push_back((unsigned int)i);
+
+  // the largest drive and speed a mode can be given, modes the start
+  // leaves well below them are never excited and are dropped
+  double force_norm = 0.0, speed_norm = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    force_norm += f[i] * f[i] / (root_mass[i] * root_mass[i]);
+    speed_norm += velocity[i / 3][i % 3] * velocity[i / 3][i % 3] * root_mass[i] * root_mass[i];
+  }
+  force_norm = std::sqrt(force_norm);
+  speed_norm = std::sqrt(speed_norm);
+  double largest = 0.0;
+  for (size_t i = 0; i < n; i++)
+    for (size_t c = 0; c < n; c++)
+      largest = std::max(largest, std::fabs(k[i * n + c]));
+  const double zero = 1e-10 * largest;
+
+  std::vector<double> block, values, vectors;
+  for (const std::vector<unsigned int>& group : groups) {
+    const size_t g = group.size();
+    if (g == 0)
+      continue;
+    block.resize(g * g);
+    for (size_t r = 0; r < g; r++)
+      for (size_t c = 0; c < g; c++)
+        block[r * g + c] = k[group[r] * n + group[c]];
+    symmetric_eigen(block, g, values, vectors);
+    const unsigned int first = (unsigned int)m_coordinate.size();
+    m_coordinate.insert(m_coordinate.end(), group.begin(), group.end());
+    // each mode starts at zero displacement with its share of the
+    // starting velocity, driven by its share of the force
+    for (size_t j = 0; j < g; j++) {
+      double drive = 0.0, speed = 0.0;
+      for (size_t i = 0; i < g; i++) {
+        const double q = vectors[i * g + j];
+        const unsigned int d = group[i];
+        drive += q * f[d] / root_mass[d];
+        speed += q * velocity[d / 3][d % 3] * root_mass[d];
+      }
+      if (std::fabs(drive) <= 1e-12 * force_norm && std::fabs(speed) <= 1e-12 * speed_norm)
+        continue;
+      m_mode_start.push_back((unsigned int)m_shape.size());
+      m_mode_coordinate.push_back(first);
+      for (size_t i = 0; i < g; i++)
+        m_shape.push_back(vectors[i * g + j] / root_mass[group[i]]);
+      const double lambda = values[j];
+      if (std::fabs(lambda) <= zero) {
+        m_frequency.push_back(0.0);
+        m_c.push_back(0.0);
+        m_b.push_back(speed);
+        m_a.push_back(0.5 * drive);
+      } else {
+        const double w = std::sqrt(std::fabs(lambda));
+        m_frequency.push_back(lambda > 0.0 ? w : -w);
+        m_c.push_back(drive / lambda);
+        m_a.push_back(-drive / lambda);
+        m_b.push_back(speed / w);
+      }
+    }
+  }
+  m_mode_start.push_back((unsigned int)m_shape.size());
+  return true;
+}
+
+void spring_modes::positions(double t, std::vector<glm::vec3>& out) const {
+  const size_t n = m_size;
+  std::vector<double> x(m_start);
+  for (size_t j = 0; j < m_frequency.size(); j++) {
+    const double w = m_frequency[j];
+    double z;
+    if (w > 0.0)
+      z = m_c[j] + m_a[j] * std::cos(w * t) + m_b[j] * std::sin(w * t);
+    else if (w < 0.0)
+      z = m_c[j] + m_a[j] * std::cosh(w * t) - m_b[j] * std::sinh(w * t);
+    else
+      z = m_c[j] + (m_a[j] * t + m_b[j]) * t;
+    const double* shape = &m_shape[m_mode_start[j]];
+    const unsigned int* coordinate = &m_coordinate[m_mode_coordinate[j]];
+    const size_t count = m_mode_start[j + 1] - m_mode_start[j];
+    for (size_t i = 0; i < count; i++)
+      x[coordinate[i]] += shape[i] * z;
+  }
+  out.resize(n / 3);
+  for (size_t i = 0; i < out.size(); i++)
+    out[i] = glm::vec3((float)x[i * 3], (float)x[i * 3 + 1], (float)x[i * 3 + 2]);
+}
@@ -0,0 +1,69 @@
+#ifndef MODES_H
+#define MODES_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// normal modes of a network of particles joined by springs
+// the spring forces are linearised about the starting positions, which is
+// exact for a chain moving along its own line and holds for small swings
+// otherwise. the mass weighted stiffness matrix is diagonalised once by
+// build(), after which every mode is an independent oscillator driven by
+// the constant forces, so positions() gives the state at any time as a
+// sum of modes at a cost that does not depend on the time asked for.
+// modes the starting state does not excite are dropped
+class spring_modes {
+public:
+  // spring between two particles, or a particle and a fixed anchor
+  struct spring {
+    int a;
+    // -1 when fixed to 'anchor'
+    int b;
+    glm::dvec3 anchor;
+    double rest_length;
+    double stiffness;
+  };
+  // the dense eigen solve grows with the cube of the particles
+  static constexpr size_t max_particles = 400;
+
+private:
+  // three per particle
+  size_t m_size;
+  std::vector<double> m_start;
+  // coordinates of each group solved together, one after another
+  std::vector<unsigned int> m_coordinate;
+  // shape over root mass of excited mode j, m_shape[m_mode_start[j]] up to
+  // the next mode's start, over the coordinates from
+  // m_coordinate[m_mode_coordinate[j]]
+  std::vector<double> m_shape;
+  std::vector<unsigned int> m_mode_start;
+  std::vector<unsigned int> m_mode_coordinate;
+  // angular frequency, 0 for a free mode and the growth rate negated for
+  // an unstable one
+  std::vector<double> m_frequency;
+  // mode coordinate c + a*cos(wt) + b*sin(wt), c + b*t + a*t^2 for a free
+  // mode and c + a*cosh(kt) + b*sinh(kt) for an unstable one
+  std::vector<double> m_c, m_a, m_b;
+
+public:
+  spring_modes() : m_size(0) {}
+  // linearise about 'position', moving at 'velocity' under the constant
+  // 'force'. returns false with more than max_particles particles
+  bool build(const std::vector<glm::dvec3>& position, const std::vector<glm::dvec3>& velocity,
+             const std::vector<double>& mass, const std::vector<glm::dvec3>& force,
+             const std::vector<spring>& springs);
+  // positions of every particle at time t
+  void positions(double t, std::vector<glm::vec3>& out) const;
+  size_t size() const { return m_size / 3; }
+  size_t modes() const { return m_frequency.size(); }
+  double frequency(size_t j) const { return m_frequency[j]; }
+};
+
+// eigenvalues of the symmetric n x n row major matrix 'a' into 'values'
+// and the unit eigenvectors into the columns of 'vectors'
+void symmetric_eigen(const std::vector<double>& a, size_t n, std::vector<double>& values,
+                     std::vector<double>& vectors);
+
+#endif // !MODES_H
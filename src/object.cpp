@@ -1,6 +1,7 @@
 #include "object.hpp"
 #include "GLFW/glfw3.h"
 #include "simulation.hpp"
+#include <algorithm>
 #include <cmath>
 #include "utils.h"
 void mesh::bind() {
@@ -60,10 +61,14 @@ void object::update(float delta) {
 
 // main draw function
 void object::draw(glm::mat4& vp_matrix) const {
+  draw_model(vp_matrix, model_matrix());
+}
+
+void object::draw_model(const glm::mat4& vp_matrix, const glm::mat4& model) const {
   // bind mesh for opengl draw state 
   m_mesh->bind();
   // take view projection matrix and transform it into a modelviewprojection matrix to pass into the shader 
-  glm::mat4 mvp = vp_matrix * model_matrix();
+  glm::mat4 mvp = vp_matrix * model;
   // pass uniforms to shader
   glUniformMatrix4fv(m_mesh->get_shader()->mvp_location(), 1, GL_FALSE, glm::value_ptr(mvp));
   glUniform3fv(m_mesh->get_shader()->colour_location(), 1, glm::value_ptr(m_colour));
@@ -106,11 +111,9 @@ glm::mat4 world::model_matrix() const {
   return model;
 }
 
+// simulations are advanced by the environment, see environment::update
 void world::update(float delta) {
   object::update(delta);
-  if (GUI::get_state() == GUI::SIMULATE) {
-    current_simulation->update();
-  }
 }
 
 
@@ -157,95 +160,46 @@ void world::gen_vertex_data(line_mesh &plane_mesh) {
 void world::child_added(object* child) {
   // update info 
   DEBUG_TEXT("child added to world")
+  // every registered body resets the simulation when edited, the
+  // stepped solvers use all of them
+  bool registered = true;
   switch (child->get_type_code()) {
     case 1: {
-      if (!simulation_objects.pl) {
-        simulation_objects.pl = static_cast<plane*>(child);
-        child->set_modified_callback(static_cast<void (*)(GUIitem*)>(&world::reset_simulation));
-        child->set_callback_node(this);
-        DEBUG_TEXT("plane added to simulation state")
-      }
+      add_plane(static_cast<plane*>(child));
+      break;
+    }
+    case 2: {
+      add_point(static_cast<point*>(child));
       break;
     }
     case 3: {
-      if (!simulation_objects.pa1) {
-        simulation_objects.pa1 = static_cast<particle*>(child);
-        child->set_modified_callback(static_cast<void (*)(GUIitem*)>(&world::reset_simulation));
-        child->set_callback_node(this);
-        DEBUG_TEXT("particle added to simulation state")
-      } else if (!simulation_objects.pa2) {
-          simulation_objects.pa2 = static_cast<particle*>(child);
-          child->set_modified_callback(static_cast<void (*)(GUIitem*)>(&world::reset_simulation));
-          child->set_callback_node(this);
-          DEBUG_TEXT("particle added to simulation state")
-      }
+      add_particle(static_cast<particle*>(child));
       break;
     }
     case 4: {
-      if (!simulation_objects.sp) {
-        simulation_objects.sp = static_cast<spring*>(child);
-        child->set_modified_callback(static_cast<void (*)(GUIitem*)>(&world::reset_simulation));
-        child->set_callback_node(this);
-        DEBUG_TEXT("spring added to simulation state")
-      }
+      add_spring(static_cast<spring*>(child));
+      break;
+    }
+    case 5: {
+      add_fluid(static_cast<fluid*>(child));
       break;
     }
     case 0:
     default:
+      registered = false;
     break;
   }
-  create_simulation();
-}
-
-bool world::create_simulation() {
-  // decide which simulation to set up based on the available objects
-  if (simulation_objects.pa1 && simulation_objects.pl && simulation_objects.sp) {
-    DEBUG_TEXT("simulation state set to spring, particle and plane")
-        if (current_simulation) {
-            delete current_simulation;
-            current_simulation = NULL;
-        }
-    current_simulation = new spp(this, simulation_objects.pa1, simulation_objects.pl, simulation_objects.sp);
-  } else if (simulation_objects.pa1 && simulation_objects.pa2 && simulation_objects.pl) {
-    DEBUG_TEXT("simulation state set to particle and particle and plane")
-        if (current_simulation) {
-            delete current_simulation;
-            current_simulation = NULL;
-        }
-    current_simulation = new ppp(this, simulation_objects.pa1, simulation_objects.pa2, simulation_objects.pl);
-  } else if (simulation_objects.pa1 && simulation_objects.pl) {
-      DEBUG_TEXT("simulation state set to particle and plane")
-          if (current_simulation) {
-              delete current_simulation;
-              current_simulation = NULL;
-          }
-      current_simulation = new pp(this, simulation_objects.pa1, simulation_objects.pl);
-  } else {
-    return false;
+  if (registered) {
+    child->set_modified_callback(static_cast<void (*)(GUIitem*)>(&world::reset_simulation));
+    child->set_callback_node(this);
   }
-  return true;
+  create_simulation();
 }
 
 void world::child_removed(object* child) {
   // update info 
   DEBUG_TEXT("child removed")
-  if (child == simulation_objects.pa1)
-    simulation_objects.pa1 = NULL;
-  else if (child == simulation_objects.pa2)
-      simulation_objects.pa2 = NULL;
-  else if (child == simulation_objects.pl)
-    simulation_objects.pl = NULL;
-  else if (child == simulation_objects.sp)
-    simulation_objects.sp = NULL;
-
-  if (current_simulation) {
-      delete current_simulation;
-      current_simulation = NULL;
-  }
-  if (!create_simulation()) {
-    current_simulation = NULL;
-  }
-  DEBUG_TEXT("child removed from simulation context")
+  remove_body(child);
 }
 
 void world::show() const {
@@ -257,9 +211,76 @@ void world::show() const {
             reset_simulation((GUIitem*)this);
         ImGui::InputFloat("gravity", (float*)&gravity, 0.0f, 10.0f);
         ImGui::InputFloat("restitution", (float*)&restitution, 0.0f, 10.0f);
+        // pick between the closed form simulations and the integrators
+        static const char* solvers[] = { "analytic", "semi-implicit euler", "velocity verlet", "runge-kutta 4", "event driven", "implicit euler", "position based", "constrained euler", "dormand-prince 45", "yoshida 4", "normal modes", "kepler orbits" };
+        int current = solver;
+        if (ImGui::Combo("solver", &current, solvers, 12)) {
+            ((world*)this)->solver = (world_body::SOLVER)current;
+            ((world*)this)->create_simulation();
+        }
+        // stepped solvers split each tick into sub-steps this long at most
+        ImGui::InputFloat("max sub-step", (float*)&max_substep, 0.001f, 0.01f, "%.4f");
+        int budget = substep_budget;
+        if (ImGui::InputInt("sub-step budget", &budget, 256, 1024))
+            ((world*)this)->substep_budget = (unsigned int)std::max(0, budget);
+        if (solver == SOLVER::PBD || solver == SOLVER::CONSTRAINED) {
+            // fixed cost per step, more iterations stiffen the springs
+            int iterations = constraint_iterations;
+            if (ImGui::InputInt("iterations", &iterations, 1, 10)) {
+                ((world*)this)->constraint_iterations = (unsigned int)std::max(1, iterations);
+                ((world*)this)->create_simulation();
+            }
+        }
+        if (solver == SOLVER::RK45) {
+            // smaller holds the error down with shorter steps
+            if (ImGui::InputFloat("tolerance", (float*)&tolerance, 0.0f, 0.0f, "%.1e")) {
+                ((world*)this)->tolerance = std::max(1e-7f, tolerance);
+                ((world*)this)->create_simulation();
+            }
+        }
+        if (solver == SOLVER::KEPLER) {
+            // particles orbit this mass at the world's position
+            ImGui::InputFloat("central mass", (float*)&central_mass, 100.0f, 1000.0f);
+            if (!mutual_gravity)
+                ImGui::InputFloat("G", (float*)&gravitational_constant, 0.1f, 1.0f);
+        }
+        // n-body attraction between particles, stepped solvers only
+        ImGui::Checkbox("mutual gravity", (bool*)&mutual_gravity);
+        if (mutual_gravity) {
+            ImGui::InputFloat("G", (float*)&gravitational_constant, 0.1f, 1.0f);
+            // 0 sums every pair exactly, larger trades accuracy for speed
+            ImGui::SliderFloat("opening angle", (float*)&opening_angle, 0.0f, 1.5f);
+        }
     }
     if (GUI::get_state() == GUI::SIMULATE) {
-        current_simulation->show();
+        ImGui::Text((std::string("time: ") + std::to_string(current_simulation->get_time())).c_str());
+        // clock controls
+        sim_clock& clock = current_simulation->get_clock();
+        bool paused = clock.is_paused();
+        if (ImGui::Checkbox("pause", &paused)) {
+            if (paused)
+                clock.pause();
+            else
+                clock.resume();
+        }
+        if (paused) {
+            // advance a single tick while paused
+            ImGui::SameLine();
+            if (ImGui::Button("step"))
+                clock.step();
+        }
+        ImGui::SliderFloat("speed", &clock.speed, 0.0f, 10.0f);
+        // the sub-step budget cannot keep up with the requested speed
+        const substep_scheduler& scheduler = current_simulation->get_scheduler();
+        if (scheduler.is_behind())
+            ImGui::Text("behind real time, running at %.0f%%", scheduler.get_rate()*100.0f);
+        // step control of the adaptive solver
+        const numeric* stepped = dynamic_cast<const numeric*>(current_simulation);
+        const dormand_prince* adaptive = stepped ? dynamic_cast<const dormand_prince*>(stepped->get_integrator()) : NULL;
+        if (adaptive) {
+            ImGui::Text("steps: %lu accepted, %lu rejected", adaptive->accepted, adaptive->rejected);
+            ImGui::Text("step length: %.2e to %.2e", adaptive->smallest_step, adaptive->largest_step);
+        }
     }
 }
 
@@ -330,9 +351,11 @@ glm::mat4 plane::model_matrix() const {
 }
 
 void plane::show() const {
-  if (ImGui::SliderFloat("rotation", (float *)&rotation, 0.0f, M_PI/2))
+  // planes sloping up let a chain of them climb, see piecewise
+  if (ImGui::SliderFloat("rotation", (float *)&rotation, -M_PI/2, M_PI/2))
+    (*m_value_modified)(callback_node);
+  if (ImGui::SliderFloat("length", (float *)&length, 0.0f, 70.0f))
     (*m_value_modified)(callback_node);
-  ImGui::SliderFloat("length", (float *)&length, 0.0f, 70.0f);
 }
 
 // particle
@@ -429,11 +452,49 @@ void particle::show() const {
   ImGui::InputFloat("initial velocity", (float*)&u_velocity, 0.0f, 10.0f);
 }
 
+// fluid
+glm::mat4 fluid::model_matrix() const {
+  glm::mat4 model = glm::mat4(1.0f);
+  model = glm::translate(model, position);
+  model = glm::scale(model, glm::vec3(1.0f)*m_scale);
+  return model;
+}
+
+void fluid::get_model_matrices(std::vector<glm::mat4>& out) const {
+  if (samples.empty()) {
+    out.push_back(model_matrix());
+    return;
+  }
+  for (const glm::vec3& s : samples) {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), s);
+    model = glm::scale(model, glm::vec3(1.0f)*smoothing_length*0.25f);
+    out.push_back(model);
+  }
+}
+
+void fluid::draw(glm::mat4& vp_matrix) const {
+  std::vector<glm::mat4> models;
+  get_model_matrices(models);
+  for (const glm::mat4& model : models)
+    draw_model(vp_matrix, model);
+}
+
+void fluid::show() const {
+  if (ImGui::InputFloat3("size", (float*)&size))
+    (*m_value_modified)(callback_node);
+  // particles sit half a smoothing length apart
+  if (ImGui::InputFloat("smoothing length", (float*)&smoothing_length, 0.1f, 1.0f))
+    (*m_value_modified)(callback_node);
+  ImGui::InputFloat("rest density", (float*)&rest_density, 0.1f, 1.0f);
+  // the speed of sound squared, stiffer is less compressible but takes
+  // shorter steps
+  ImGui::InputFloat("stiffness", (float*)&stiffness, 1000.0f, 10000.0f);
+  ImGui::InputFloat("viscosity", (float*)&viscosity, 0.1f, 1.0f);
+}
+
 // spring
 mesh* spring::spring_mesh;
 mesh* spring::spring_mesh_highlight;
-float spring::coil_width;
-int spring::coils;
 
 glm::mat4 spring::model_matrix() const {
   glm::mat4 model = glm::mat4(1.0f);
@@ -537,10 +598,51 @@ void spring::draw(glm::mat4& vp_matrix, float scale) const {
     // return to original shader
 }
 
+// pick a spring end from the world's particles and points, the first
+// entry leaves the end free
+static bool end_combo(const char* label, body*& end, const world* w) {
+  std::vector<body*> nodes(1, (body*)NULL);
+  std::vector<std::string> names(1, "none");
+  for (particle_body* pa : w->get_particles()) {
+    nodes.push_back(pa);
+    names.push_back(dynamic_cast<GUIitem*>(pa)->get_name());
+  }
+  for (point_body* pt : w->get_points()) {
+    nodes.push_back(pt);
+    names.push_back(dynamic_cast<GUIitem*>(pt)->get_name());
+  }
+  std::vector<const char*> items;
+  int current = 0;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    items.push_back(names[i].c_str());
+    if (nodes[i] == end)
+      current = (int)i;
+  }
+  if (!ImGui::Combo(label, &current, items.data(), (int)items.size()))
+    return false;
+  end = nodes[current];
+  return true;
+}
+
 void spring::show() const {
   ImGui::InputFloat("elasticity", (float*)&elasticity, 0.0f, length, "%.3f");
   if (ImGui::InputFloat("extension", (float*)&extension, 0.0f, length, "%.3f"))
     (*m_value_modified)(callback_node);
   if (ImGui::InputFloat("length", (float*)&length, 0.0f, 20.0f, "%.3f"))
     (*m_value_modified)(callback_node);
+  // network ends, solved by the stepped simulations
+  if (callback_node) {
+    world* w = static_cast<world*>(callback_node);
+    bool changed = end_combo("end a", ((spring*)this)->end_a, w);
+    changed |= end_combo("end b", ((spring*)this)->end_b, w);
+    // rods and hinges, held by the constrained solver
+    changed |= ImGui::Checkbox("rigid", (bool*)&rigid);
+    if (rigid) {
+      changed |= ImGui::Checkbox("hinged", (bool*)&hinged);
+      if (hinged)
+        changed |= ImGui::InputFloat3("hinge axis", (float*)&hinge_axis);
+    }
+    if (changed)
+      w->create_simulation();
+  }
 }
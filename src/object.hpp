@@ -6,7 +6,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <random>
+#include "body.hpp"
 #include "gui.hpp"
+#include "maths.hpp"
 #include "shader.hpp"
 #include "simulation.hpp"
 #include "utils.h"
@@ -14,20 +16,6 @@
 #include <cmath>
 
 
-// linear interpolate between two vectors
-inline glm::vec3 lerp3f(glm::vec3 x, glm::vec3 y, float t) {
-  return x * (1.f - t) + y * t;
-}
-
-inline float lerp1f(float x, float y, float t) {
-  return x * (1.f - t) + y * t;
-}
-
-// modify lerp value for a more organic motion
-inline double smooth(double x) { 
-  return tanh(sqrt(x) * 6 - M_PI) / 2 + 0.503; 
-}
-
 // store vertices to draw with opengl 
 class mesh {
   shader *m_shader;
@@ -67,7 +55,7 @@ public:
 };
 
 // inherit GUI functionality
-class object : public GUIitem {
+class object : public GUIitem, public virtual body {
   // move_to data
   glm::vec3 m_start;
   glm::vec3 m_end;
@@ -85,14 +73,12 @@ protected:
   // pure function to pass custom object transform matrix to the draw call
   virtual glm::mat4 model_matrix() const = 0;
 public:
-  glm::vec3 position;
-
   // initialise defaults, random colour
   object(std::string &name, mesh *mesh, float scale, glm::vec3 col = glm::vec3((float)std::rand()/RAND_MAX, (float)std::rand()/RAND_MAX, (float)std::rand()/RAND_MAX))
-      : GUIitem(name), m_mesh(mesh), m_scale(scale), m_mode(MODE::STILL), position(0.0f), m_colour(col) {}
+      : GUIitem(name), m_mesh(mesh), m_scale(scale), m_mode(MODE::STILL), m_colour(col) {}
 
   object(const char * name, mesh *mesh, float scale, glm::vec3 col = glm::vec3((float)std::rand()/RAND_MAX, (float)std::rand()/RAND_MAX, (float)std::rand()/RAND_MAX))
-      : GUIitem(name), m_mesh(mesh), m_scale(scale), m_mode(MODE::STILL), position(0.0f), m_colour(col) {}
+      : GUIitem(name), m_mesh(mesh), m_scale(scale), m_mode(MODE::STILL), m_colour(col) {}
 
   // swap to another shader
   void set_shader(shader *shader) const { m_mesh->set_shader(shader); };
@@ -100,9 +86,14 @@ public:
   virtual void draw(glm::mat4 &vp_matrix) const; 
   // draw object as a single colour with custom scalar
   virtual void draw(glm::mat4 &vp_matrix, float scale) const;
+  // draw object with a model matrix taken earlier
+  void draw_model(const glm::mat4 &vp_matrix, const glm::mat4 &model) const;
+  glm::mat4 get_model_matrix() const { return model_matrix(); }
+  // append every model matrix the object is drawn with, one for most
+  virtual void get_model_matrices(std::vector<glm::mat4> &out) const { out.push_back(model_matrix()); }
   // frame logic step
   virtual void update(float delta);
-  void move_to(glm::vec3 location) {
+  void move_to(glm::vec3 location) override {
     // store time
     m_timestamp.begin();
     // store start and end points for linear interpolation
@@ -127,46 +118,16 @@ public:
 };
 
 // world class, inherits object, stands at the top of the node tree
-class world : public object {
-  struct {
-    particle* pa1;
-    particle* pa2;
-    plane* pl;
-    spring* sp;
-  } simulation_objects;
+class world : public object, public world_body {
   glm::mat4 model_matrix() const override;
-  simulation* current_simulation;
 
 public:
   static line_mesh* world_mesh;
-  // simulation data
-  float time_scale;
-  float distance;
-  float friction;
-  float gravity;
-  float restitution;
   world(std::string& name, float scale)
-      : object(name, world_mesh, scale), 
-        time_scale(1.0f),
-        distance(1.0f),
-        friction(0.0f),
-        gravity(9.8f),
-        restitution(0.5f)
-  { simulation_objects = {NULL, NULL, NULL};
-    current_simulation = NULL; }
-  ~world() { delete current_simulation; }
-
-  void start_simulation() { DEBUG_TEXT("world initiating simulation");
-    current_simulation->start(); };
-  void end_simulation() {
-    current_simulation->end();
-  }
+      : object(name, world_mesh, scale) {}
+
   void child_added(object* child);
   void child_removed(object* child);
-  bool create_simulation();
-
-  // override draw functions to disable drawing
-  bool can_simulate() const { return current_simulation != NULL; } 
 
   // called by children to reset the simulation state when editing variables
   static void reset_simulation(GUIitem* world) { 
@@ -181,39 +142,30 @@ public:
   void update(float delta) override;
 };
 
-class plane : public object {
+class plane : public object, public plane_body {
   glm::mat4 model_matrix() const override;
 public:
-  // custom orientation and length
-  float rotation;
-  float length;
   static mesh* plane_mesh;
   plane(std::string& name, float scale)
-      : object(name, plane_mesh, scale, glm::vec3(0.133, 0.11, 0.208)), rotation(3*M_PI/8), length(3.0f) {}
+      : object(name, plane_mesh, scale, glm::vec3(0.133, 0.11, 0.208)), plane_body(scale) {}
   static void gen_vertex_data(mesh &mesh);
   void show() const override;
   int get_type_code() const override { return 1; };
 };
 
-class particle : public object {
+class particle : public object, public particle_body {
   glm::mat4 model_matrix() const override;
 public:
-  // editable values
-  float force;
-  float mass;
-  float u_velocity;
   static mesh* particle_mesh;
   particle(std::string &name, float scale)
-      : object(name, particle_mesh, scale, glm::vec3(0.0f, 0.0f, 1.0f)), mass(1.0f), force(0.0f), u_velocity(0.0f) {}
+      : object(name, particle_mesh, scale, glm::vec3(0.0f, 0.0f, 1.0f)), particle_body(scale) {}
   static void gen_vertex_data(unsigned int nodes, mesh &mesh);
-  // get radius size
-  float get_radius() const { return m_scale; };
 
   void show() const override;
   int get_type_code() const override { return 3; };
 };
 
-class point : public object {
+class point : public object, public point_body {
   glm::mat4 model_matrix() const override;
 public:
   point(std::string& name, float scale)
@@ -222,31 +174,32 @@ public:
   int get_type_code() const override { return 2; };
 };
 
-class spring : public object {
+// block of fluid, drawn as a sample of its particles while simulating
+class fluid : public object, public fluid_body {
+  glm::mat4 model_matrix() const override;
+public:
+  fluid(std::string& name, float scale)
+      : object(name, particle::particle_mesh, scale, glm::vec3(0.2f, 0.5f, 0.9f)) {}
+  void draw(glm::mat4& vp_matrix) const override;
+  // a small sphere per sampled particle while simulating
+  void get_model_matrices(std::vector<glm::mat4> &out) const override;
+  void show() const override;
+  int get_type_code() const override { return 5; };
+};
+
+class spring : public object, public spring_body {
   glm::mat4 model_matrix() const override;
 public:
-  // editable values
-  float length;
-  float extension;
-  float elasticity;
-  float rotation;
-  // globals
-  static float coil_width;
-  static int coils;
   static mesh* spring_mesh;
   static mesh* spring_mesh_highlight;
   spring(std::string& name, float scale)
       : object(name, spring_mesh, scale, glm::vec3(0.667f, 0.663f, 0.678f)),
-     rotation(0.0f),
-    extension(0.5f), 
-    length(1.0f),
-    elasticity(9.8f)
+    spring_body(scale)
   {}
   static void gen_vertex_data(const int coils, const int nodes, const float coil_width, const float thickness, mesh &mesh);
   void show() const override;
   void draw(glm::mat4 &vp_matrix, float scale) const override;
   int get_type_code() const override { return 4; };
-  float get_scale() const { return m_scale; }
 };
 
 
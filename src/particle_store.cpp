@@ -0,0 +1,145 @@
+#include "particle_store.hpp"
+#include "simd.hpp"
+
+// kernels
+// each loop runs whole simd lanes first, then finishes the tail in scalar
+
+void simd_axpy(float* y, const float* x, float a, size_t n) {
+  size_t i = 0;
+  vfloat va = vset(a);
+  for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+    vstore(y + i, vfmadd(va, vload(x + i), vload(y + i)));
+  for (; i < n; i++)
+    y[i] += a * x[i];
+}
+
+void simd_madd(float* out, const float* a, const float* b, float s, size_t n) {
+  size_t i = 0;
+  vfloat vs = vset(s);
+  for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+    vstore(out + i, vfmadd(vs, vload(b + i), vload(a + i)));
+  for (; i < n; i++)
+    out[i] = a[i] + s * b[i];
+}
+
+void simd_accelerate(float* out, const float* f, const float* inv_mass, float g, size_t n) {
+  size_t i = 0;
+  vfloat vg = vset(g);
+  for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+    vstore(out + i, vfmadd(vload(f + i), vload(inv_mass + i), vg));
+  for (; i < n; i++)
+    out[i] = g + f[i] * inv_mass[i];
+}
+
+void axpy(vec3_array& y, const vec3_array& x, float a) {
+  simd_axpy(y.x.data(), x.x.data(), a, y.size());
+  simd_axpy(y.y.data(), x.y.data(), a, y.size());
+  simd_axpy(y.z.data(), x.z.data(), a, y.size());
+}
+
+void madd(vec3_array& out, const vec3_array& a, const vec3_array& b, float s) {
+  out.resize(a.size());
+  simd_madd(out.x.data(), a.x.data(), b.x.data(), s, a.size());
+  simd_madd(out.y.data(), a.y.data(), b.y.data(), s, a.size());
+  simd_madd(out.z.data(), a.z.data(), b.z.data(), s, a.size());
+}
+
+// particle store
+size_t particle_store::add(glm::vec3 p, glm::vec3 v, float m, float r) {
+  position.push_back(p);
+  velocity.push_back(v);
+  applied.push_back(glm::vec3(0.0f));
+  mass.push_back(m);
+  inv_mass.push_back(1.0f / m);
+  radius.push_back(r);
+  return mass.size() - 1;
+}
+
+void particle_store::reserve(size_t n) {
+  position.reserve(n);
+  velocity.reserve(n);
+  applied.reserve(n);
+  mass.reserve(n);
+  inv_mass.reserve(n);
+  radius.reserve(n);
+}
+
+void particle_store::clear() {
+  position.clear();
+  velocity.clear();
+  applied.clear();
+  mass.clear();
+  inv_mass.clear();
+  radius.clear();
+}
+
+void particle_store::accelerations(glm::vec3 gravity, vec3_array& out) const {
+  out.resize(size());
+  simd_accelerate(out.x.data(), applied.x.data(), inv_mass.data(), gravity.x, size());
+  simd_accelerate(out.y.data(), applied.y.data(), inv_mass.data(), gravity.y, size());
+  simd_accelerate(out.z.data(), applied.z.data(), inv_mass.data(), gravity.z, size());
+}
+
+void particle_store::integrate(const vec3_array& acceleration, float dt) {
+  axpy(velocity, acceleration, dt);
+  axpy(position, velocity, dt);
+}
+
+bool particle_store::collide_plane(glm::vec3 point, glm::vec3 normal, float restitution) {
+  const size_t n = size();
+  float* x = position.x.data();
+  float* y = position.y.data();
+  float* z = position.z.data();
+  float* vx = velocity.x.data();
+  float* vy = velocity.y.data();
+  float* vz = velocity.z.data();
+  const float* r = radius.data();
+  // plane offset along its normal
+  const float offset = glm::dot(point, normal);
+  const float bounce = 1.0f + restitution;
+
+  size_t i = 0;
+  const vfloat nx = vset(normal.x), ny = vset(normal.y), nz = vset(normal.z);
+  const vfloat voffset = vset(offset), vbounce = vset(bounce), zero = vset(0.0f);
+  // deepest penetration of every lane, checked once after the loop
+  vfloat deepest = zero;
+  for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+    vfloat px = vload(x + i), py = vload(y + i), pz = vload(z + i);
+    // signed distance from the plane to the particle surface
+    vfloat depth = vsub(vfmadd(pz, nz, vfmadd(py, ny, vmul(px, nx))), vadd(voffset, vload(r + i)));
+    // push out by the penetration only, lanes above the plane move by zero
+    vfloat push = vmin(depth, zero);
+    deepest = vmin(deepest, push);
+    vstore(x + i, vsub(px, vmul(nx, push)));
+    vstore(y + i, vsub(py, vmul(ny, push)));
+    vstore(z + i, vsub(pz, vmul(nz, push)));
+    // reflect velocity into the plane for penetrating lanes
+    vfloat ux = vload(vx + i), uy = vload(vy + i), uz = vload(vz + i);
+    vfloat vn = vfmadd(uz, nz, vfmadd(uy, ny, vmul(ux, nx)));
+    vfloat j = vmask_lt(depth, zero, vmul(vbounce, vmin(vn, zero)));
+    vstore(vx + i, vsub(ux, vmul(nx, j)));
+    vstore(vy + i, vsub(uy, vmul(ny, j)));
+    vstore(vz + i, vsub(uz, vmul(nz, j)));
+  }
+  float lanes[SIMD_WIDTH];
+  vstore(lanes, deepest);
+  bool pushed = false;
+  for (int k = 0; k < SIMD_WIDTH; k++)
+    pushed = pushed || lanes[k] < 0.0f;
+  for (; i < n; i++) {
+    float depth = x[i] * normal.x + y[i] * normal.y + z[i] * normal.z - offset - r[i];
+    if (depth >= 0.0f)
+      continue;
+    pushed = true;
+    x[i] -= normal.x * depth;
+    y[i] -= normal.y * depth;
+    z[i] -= normal.z * depth;
+    float vn = vx[i] * normal.x + vy[i] * normal.y + vz[i] * normal.z;
+    if (vn < 0.0f) {
+      vx[i] -= normal.x * bounce * vn;
+      vy[i] -= normal.y * bounce * vn;
+      vz[i] -= normal.z * bounce * vn;
+    }
+  }
+  return pushed;
+}
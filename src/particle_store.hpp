@@ -0,0 +1,92 @@
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// three component vectors stored as separate x, y and z arrays
+struct vec3_array {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  size_t size() const { return x.size(); }
+  void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); }
+  void reserve(size_t n) { x.reserve(n); y.reserve(n); z.reserve(n); }
+  void clear() { x.clear(); y.clear(); z.clear(); }
+  void push_back(glm::vec3 v) { x.push_back(v.x); y.push_back(v.y); z.push_back(v.z); }
+  glm::vec3 get(size_t i) const { return glm::vec3(x[i], y[i], z[i]); }
+  void set(size_t i, glm::vec3 v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+  void add(size_t i, glm::vec3 v) { x[i] += v.x; y[i] += v.y; z[i] += v.z; }
+};
+
+// simd kernels over float arrays
+// built with avx2 or sse when the compiler enables them, scalar otherwise
+// y += a*x
+void simd_axpy(float* y, const float* x, float a, size_t n);
+// out = a + s*b
+void simd_madd(float* out, const float* a, const float* b, float s, size_t n);
+// out = g + f*inv_mass
+void simd_accelerate(float* out, const float* f, const float* inv_mass, float g, size_t n);
+
+// component wise forms of the kernels
+void axpy(vec3_array& y, const vec3_array& x, float a);
+void madd(vec3_array& out, const vec3_array& a, const vec3_array& b, float s);
+
+class particle_view;
+
+// structure of arrays particle storage
+// each particle property lives in its own contiguous array so the
+// update kernels stream through memory and fill whole simd lanes
+class particle_store {
+public:
+  vec3_array position;
+  vec3_array velocity;
+  // constant force applied to each particle
+  vec3_array applied;
+  std::vector<float> mass;
+  std::vector<float> inv_mass;
+  std::vector<float> radius;
+
+  // add a particle, returns its index
+  size_t add(glm::vec3 p, glm::vec3 v, float m, float r);
+  size_t size() const { return mass.size(); }
+  void reserve(size_t n);
+  void clear();
+  particle_view view(size_t i);
+
+  // write gravity plus applied force over mass into 'out'
+  void accelerations(glm::vec3 gravity, vec3_array& out) const;
+  // semi-implicit euler step, v += a*dt then x += v*dt
+  void integrate(const vec3_array& acceleration, float dt);
+  // keep particles above a plane, reflecting normal velocity by restitution
+  // returns whether any particle was pushed out
+  bool collide_plane(glm::vec3 point, glm::vec3 normal, float restitution);
+};
+
+// handle to one particle inside a store
+// reads and writes go straight to the store's arrays
+class particle_view {
+  particle_store* m_store;
+  size_t m_index;
+public:
+  particle_view(particle_store* store, size_t index) : m_store(store), m_index(index) {}
+  size_t get_index() const { return m_index; }
+  glm::vec3 get_position() const { return m_store->position.get(m_index); }
+  void set_position(glm::vec3 p) { m_store->position.set(m_index, p); }
+  glm::vec3 get_velocity() const { return m_store->velocity.get(m_index); }
+  void set_velocity(glm::vec3 v) { m_store->velocity.set(m_index, v); }
+  glm::vec3 get_applied() const { return m_store->applied.get(m_index); }
+  void set_applied(glm::vec3 f) { m_store->applied.set(m_index, f); }
+  float get_mass() const { return m_store->mass[m_index]; }
+  void set_mass(float m) {
+    m_store->mass[m_index] = m;
+    m_store->inv_mass[m_index] = 1.0f / m;
+  }
+  float get_radius() const { return m_store->radius[m_index]; }
+};
+
+inline particle_view particle_store::view(size_t i) { return particle_view(this, i); }
+
+#endif // !PARTICLE_STORE_H
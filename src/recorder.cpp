@@ -0,0 +1,193 @@
+#include "recorder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "body.hpp"
+
+// bytes of file mapped at a time by the spill thread, a page multiple
+static const size_t window_bytes = 16 << 20;
+// spill thread sleep while the ring is empty
+static const std::chrono::milliseconds idle(1);
+
+recorder::recorder(const world_body* world, size_t capacity) :
+  m_world(world),
+  m_bodies(0),
+  m_capacity(1),
+  m_head(0),
+  m_tail(0),
+  m_dropped(0),
+  m_last_time(0.0f),
+  m_file(-1),
+  m_window(NULL),
+  m_window_start(0),
+  m_window_end(0),
+  m_written(0),
+  m_failed(false),
+  m_recording(false),
+  m_view(NULL),
+  m_view_bytes(0) {
+  while (m_capacity < capacity)
+    m_capacity <<= 1;
+}
+
+recorder::~recorder() {
+  stop();
+  if (m_view)
+    munmap((void*)m_view, m_view_bytes);
+}
+
+bool recorder::start(const std::string& path) {
+  stop();
+  if (m_view) {
+    munmap((void*)m_view, m_view_bytes);
+    m_view = NULL;
+  }
+  m_bodies = m_world->get_particles().size() + m_world->get_springs().size();
+  if (m_bodies == 0)
+    return false;
+  m_file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (m_file < 0)
+    return false;
+  m_ring.assign(m_capacity * m_bodies, sample());
+  m_last.assign(m_bodies, glm::vec3(0.0f));
+  m_head = 0;
+  m_tail = 0;
+  m_dropped = 0;
+  m_written = 0;
+  m_window_start = m_window_end = 0;
+  // counts are filled in by stop()
+  file_header header = {{'m', 'e', 'c', 'h', 'r', 'e', 'c', '1'}, (uint32_t)m_bodies, sizeof(sample), 0, 0};
+  m_failed = !spill(&header, sizeof(header));
+  m_recording = true;
+  m_spill_thread = std::thread(&recorder::spill_loop, this);
+  return true;
+}
+
+bool recorder::capture(float time, bool wait) {
+  if (!m_recording)
+    return false;
+  uint64_t head = m_head.load(std::memory_order_relaxed);
+  // a paused clock produces nothing new
+  if (head > 0 && time == m_last_time)
+    return true;
+  while (head - m_tail.load(std::memory_order_acquire) >= m_capacity) {
+    if (!wait) {
+      m_dropped++;
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  float dt = time - m_last_time;
+  sample* frame = &m_ring[(head & (m_capacity - 1)) * m_bodies];
+  size_t i = 0;
+  auto record = [&](glm::vec3 position, float extension) {
+    glm::vec3 velocity = head > 0 && dt > 0.0f ? (position - m_last[i]) / dt : glm::vec3(0.0f);
+    m_last[i] = position;
+    frame[i++] = {time, position, velocity, extension};
+  };
+  for (particle_body* p : m_world->get_particles())
+    record(p->position, 0.0f);
+  for (spring_body* s : m_world->get_springs())
+    record(s->position, s->extension);
+  m_last_time = time;
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+void recorder::spill_loop() {
+  const size_t frame_bytes = m_bodies * sizeof(sample);
+  for (;;) {
+    // read the flag first so every frame captured before stop() is seen
+    bool recording = m_recording.load(std::memory_order_acquire);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == head) {
+      if (!recording)
+        return;
+      std::this_thread::sleep_for(idle);
+      continue;
+    }
+    // the frames up to the end of the ring are contiguous
+    size_t slot = tail & (m_capacity - 1);
+    size_t count = std::min<uint64_t>(head - tail, m_capacity - slot);
+    if (m_failed || !spill(&m_ring[slot * m_bodies], count * frame_bytes)) {
+      m_failed = true;
+      m_dropped += count;
+    }
+    m_tail.store(tail + count, std::memory_order_release);
+  }
+}
+
+bool recorder::spill(const void* data, size_t bytes) {
+  const char* from = (const char*)data;
+  while (bytes > 0) {
+    if (m_written == m_window_end) {
+      // move the window on, growing the file to cover it
+      if (m_window)
+        munmap(m_window, window_bytes);
+      m_window = NULL;
+      m_window_start = m_window_end;
+      if (ftruncate(m_file, m_window_start + window_bytes) != 0)
+        return false;
+      void* window = mmap(NULL, window_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, m_window_start);
+      if (window == MAP_FAILED)
+        return false;
+      m_window = (char*)window;
+      m_window_end = m_window_start + window_bytes;
+    }
+    size_t n = std::min<uint64_t>(bytes, m_window_end - m_written);
+    memcpy(m_window + (m_written - m_window_start), from, n);
+    m_written += n;
+    from += n;
+    bytes -= n;
+  }
+  return true;
+}
+
+void recorder::unmap() {
+  if (m_window)
+    munmap(m_window, window_bytes);
+  m_window = NULL;
+}
+
+void recorder::stop() {
+  if (!m_recording)
+    return;
+  m_recording = false;
+  m_spill_thread.join();
+  unmap();
+  // a failed spill can leave part of a frame, the file ends after the
+  // last complete one
+  const size_t frame_bytes = m_bodies * sizeof(sample);
+  uint64_t frames = m_written > sizeof(file_header) ? (m_written - sizeof(file_header)) / frame_bytes : 0;
+  m_written = sizeof(file_header) + frames * frame_bytes;
+  file_header header = {{'m', 'e', 'c', 'h', 'r', 'e', 'c', '1'}, (uint32_t)m_bodies, sizeof(sample), frames, m_dropped};
+  if (pwrite(m_file, &header, sizeof(header), 0) != sizeof(header) || ftruncate(m_file, m_written) != 0) {
+    close(m_file);
+    m_file = -1;
+    return;
+  }
+  void* view = mmap(NULL, m_written, PROT_READ, MAP_SHARED, m_file, 0);
+  if (view != MAP_FAILED) {
+    m_view = (const char*)view;
+    m_view_bytes = m_written;
+  }
+  close(m_file);
+  m_file = -1;
+  // the ring is no longer needed once everything is on disk
+  std::vector<sample>().swap(m_ring);
+}
+
+size_t recorder::get_frame_count() const {
+  return m_view ? ((const file_header*)m_view)->frame_count : 0;
+}
+
+const recorder::sample* recorder::get_frame(size_t i) const {
+  if (i >= get_frame_count())
+    return NULL;
+  return (const sample*)(m_view + sizeof(file_header)) + i * m_bodies;
+}
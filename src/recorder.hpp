@@ -0,0 +1,105 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class world_body;
+
+// records the state of every particle and spring in a world over time
+// capture() copies a frame into a lock-free ring buffer and never waits,
+// a spill thread drains the ring into a memory mapped file behind it, so
+// memory stays fixed however long the run and the frame loop never
+// touches the disk. capture() is the single producer and may be called
+// from any one thread at a time
+class recorder {
+public:
+  // one body in one frame, particles first then springs in world order
+  // velocity is the change in position since the previous frame and
+  // extension is zero for particles
+  struct sample {
+    float time;
+    glm::vec3 position;
+    glm::vec3 velocity;
+    float extension;
+  };
+
+  // start of every recording file, followed by frame_count frames of
+  // bodies samples each
+  struct file_header {
+    char magic[8];
+    uint32_t bodies;
+    uint32_t sample_bytes;
+    uint64_t frame_count;
+    uint64_t dropped;
+  };
+
+private:
+  const world_body* m_world;
+  size_t m_bodies;
+  // ring of 'capacity' frames, a power of two
+  std::vector<sample> m_ring;
+  size_t m_capacity;
+  // frames captured and frames spilled, the ring holds [m_tail, m_head)
+  std::atomic<uint64_t> m_head;
+  std::atomic<uint64_t> m_tail;
+  // frames lost to a full ring
+  std::atomic<uint64_t> m_dropped;
+  // positions and time of the previous capture, producer only
+  std::vector<glm::vec3> m_last;
+  float m_last_time;
+
+  // spill file, written through a moving window mapping
+  int m_file;
+  char* m_window;
+  uint64_t m_window_start;
+  uint64_t m_window_end;
+  uint64_t m_written;
+  // set once the file cannot grow, later frames are dropped
+  bool m_failed;
+  std::thread m_spill_thread;
+  std::atomic<bool> m_recording;
+  // whole file mapped for reading once stopped
+  const char* m_view;
+  size_t m_view_bytes;
+
+  void spill_loop();
+  // append 'bytes' to the file, mapping the next window when needed
+  bool spill(const void* data, size_t bytes);
+  void unmap();
+
+public:
+  // 'capacity' frames stay in memory, rounded up to a power of two
+  recorder(const world_body* world, size_t capacity = 1024);
+  ~recorder();
+  recorder(const recorder&) = delete;
+  recorder& operator=(const recorder&) = delete;
+
+  // create 'path' and start the spill thread, the bodies recorded are
+  // the world's at this point, false if the world has none or the file
+  // cannot be created
+  bool start(const std::string& path);
+  // copy the world's current state as a frame at simulation time 'time'
+  // false if the ring is full and the frame was dropped, unless 'wait'
+  // is set, which blocks for the spill thread instead, for offline runs
+  bool capture(float time, bool wait = false);
+  // spill everything captured, finish the file and map it for reading
+  void stop();
+
+  bool is_recording() const { return m_recording; }
+  size_t get_bodies() const { return m_bodies; }
+  uint64_t get_captured() const { return m_head; }
+  uint64_t get_spilled() const { return m_tail; }
+  uint64_t get_dropped() const { return m_dropped; }
+  // recorded frames, readable after stop()
+  size_t get_frame_count() const;
+  const sample* get_frame(size_t i) const;
+};
+
+#endif // !RECORDER_H
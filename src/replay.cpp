@@ -0,0 +1,162 @@
+#include "replay.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "body.hpp"
+
+static const float delta_range = 32767.0f;
+
+// a sample as a flat list of channels
+static inline void to_channels(const recorder::sample& s, float* c) {
+  c[0] = s.position.x; c[1] = s.position.y; c[2] = s.position.z;
+  c[3] = s.velocity.x; c[4] = s.velocity.y; c[5] = s.velocity.z;
+  c[6] = s.extension;
+}
+
+static inline void from_channels(const float* c, float time, recorder::sample& s) {
+  s.time = time;
+  s.position = glm::vec3(c[0], c[1], c[2]);
+  s.velocity = glm::vec3(c[3], c[4], c[5]);
+  s.extension = c[6];
+}
+
+void replay::build(const sample* frames, size_t count, size_t bodies) {
+  m_bodies = bodies;
+  size_t blocks = (count + m_interval - 1) / m_interval;
+  m_times.resize(count);
+  m_keyframes.resize(blocks * bodies);
+  m_scales.assign(blocks * bodies * channels, 0.0f);
+  m_deltas.resize(count * bodies * channels);
+  for (size_t i = 0; i < count; i++)
+    m_times[i] = frames[i * bodies].time;
+  for (size_t k = 0; k < blocks; k++) {
+    size_t first = k * m_interval;
+    size_t last = std::min(count, first + m_interval);
+    for (size_t b = 0; b < bodies; b++) {
+      const sample& key = frames[first * bodies + b];
+      m_keyframes[k * bodies + b] = key;
+      float base[channels], c[channels];
+      to_channels(key, base);
+      // the largest delta in the block sets the step of its encoding
+      float* scale = &m_scales[(k * bodies + b) * channels];
+      for (size_t i = first; i < last; i++) {
+        to_channels(frames[i * bodies + b], c);
+        for (size_t ch = 0; ch < channels; ch++)
+          scale[ch] = std::max(scale[ch], std::abs(c[ch] - base[ch]));
+      }
+      for (size_t ch = 0; ch < channels; ch++)
+        scale[ch] /= delta_range;
+      for (size_t i = first; i < last; i++) {
+        to_channels(frames[i * bodies + b], c);
+        int16_t* d = &m_deltas[(i * bodies + b) * channels];
+        for (size_t ch = 0; ch < channels; ch++)
+          d[ch] = scale[ch] > 0.0f ? (int16_t)std::max(-32767l, std::min(32767l, std::lround((c[ch] - base[ch]) / scale[ch]))) : 0;
+      }
+    }
+  }
+}
+
+void replay::load(const recorder& r) {
+  build(r.get_frame(0), r.get_frame_count(), r.get_bodies());
+}
+
+bool replay::load(const std::string& path) {
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0)
+    return false;
+  struct stat info;
+  recorder::file_header header;
+  bool valid = fstat(file, &info) == 0 && (size_t)info.st_size >= sizeof(header)
+    && pread(file, &header, sizeof(header), 0) == sizeof(header)
+    && memcmp(header.magic, "mechrec1", 8) == 0 && header.sample_bytes == sizeof(sample)
+    && sizeof(header) + header.frame_count * header.bodies * sizeof(sample) <= (size_t)info.st_size;
+  if (!valid || header.frame_count == 0) {
+    close(file);
+    return valid;
+  }
+  void* view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (view == MAP_FAILED)
+    return false;
+  build((const sample*)((const char*)view + sizeof(header)), header.frame_count, header.bodies);
+  munmap(view, info.st_size);
+  return true;
+}
+
+size_t replay::get_bytes() const {
+  return m_times.size() * sizeof(float) + m_keyframes.size() * sizeof(sample)
+    + m_scales.size() * sizeof(float) + m_deltas.size() * sizeof(int16_t);
+}
+
+void replay::decode(size_t i, size_t b, sample& out) const {
+  size_t k = (i / m_interval) * m_bodies + b;
+  float c[channels];
+  to_channels(m_keyframes[k], c);
+  const float* scale = &m_scales[k * channels];
+  const int16_t* d = &m_deltas[(i * m_bodies + b) * channels];
+  for (size_t ch = 0; ch < channels; ch++)
+    c[ch] += d[ch] * scale[ch];
+  from_channels(c, m_times[i], out);
+}
+
+void replay::frame(size_t i, sample* out) const {
+  for (size_t b = 0; b < m_bodies; b++)
+    decode(i, b, out[b]);
+}
+
+void replay::seek(float time, sample* out) const {
+  if (m_times.empty())
+    return;
+  // last frame at or before 'time'
+  size_t i = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+  if (i == 0 || i == m_times.size()) {
+    frame(i == 0 ? 0 : i - 1, out);
+    return;
+  }
+  i--;
+  float t = (time - m_times[i]) / (m_times[i + 1] - m_times[i]);
+  for (size_t b = 0; b < m_bodies; b++) {
+    sample next;
+    decode(i, b, out[b]);
+    decode(i + 1, b, next);
+    out[b].time = time;
+    out[b].position += (next.position - out[b].position) * t;
+    out[b].velocity += (next.velocity - out[b].velocity) * t;
+    out[b].extension += (next.extension - out[b].extension) * t;
+  }
+}
+
+void replay::apply(float time, world_body* world) const {
+  if (m_times.empty())
+    return;
+  std::vector<sample> state(m_bodies);
+  seek(time, state.data());
+  apply(state, world);
+}
+
+void replay::capture(const world_body* world, std::vector<sample>& out) {
+  out.clear();
+  for (particle_body* p : world->get_particles())
+    out.push_back({0.0f, p->position, glm::vec3(0.0f), 0.0f});
+  for (spring_body* s : world->get_springs())
+    out.push_back({0.0f, s->position, glm::vec3(0.0f), s->extension});
+}
+
+void replay::apply(const std::vector<sample>& state, world_body* world) {
+  size_t i = 0;
+  // set positions directly, a replay should not animate towards them
+  for (particle_body* p : world->get_particles())
+    if (i < state.size())
+      p->position = state[i++].position;
+  for (spring_body* s : world->get_springs()) {
+    if (i >= state.size())
+      break;
+    s->position = state[i].position;
+    s->extension = state[i++].extension;
+  }
+}
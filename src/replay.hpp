@@ -0,0 +1,70 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "recorder.hpp"
+
+class world_body;
+
+// seekable playback of a recorded run
+// every 'interval' frames a keyframe keeps the full samples, the frames
+// after it keep each channel as a 16 bit delta from that keyframe, scaled
+// per block and body, so any frame decodes from one keyframe without
+// walking the frames before it. seeking binary searches the frame times
+// and interpolates between the frames either side, at any rate and in
+// either direction
+class replay {
+public:
+  typedef recorder::sample sample;
+
+private:
+  // position, velocity and extension
+  static constexpr size_t channels = 7;
+  size_t m_interval;
+  size_t m_bodies;
+  // time of every frame, increasing
+  std::vector<float> m_times;
+  // m_bodies samples per keyframe
+  std::vector<sample> m_keyframes;
+  // channels scales per body per keyframe
+  std::vector<float> m_scales;
+  // channels deltas per body per frame
+  std::vector<int16_t> m_deltas;
+
+  // body 'b' of frame 'i'
+  void decode(size_t i, size_t b, sample& out) const;
+
+public:
+  replay(size_t interval = 32) : m_interval(interval), m_bodies(0) {}
+
+  // encode 'count' frames of 'bodies' samples each
+  void build(const sample* frames, size_t count, size_t bodies);
+  // every frame of a stopped recorder
+  void load(const recorder& r);
+  // a file written by a recorder, false if it cannot be read
+  bool load(const std::string& path);
+
+  size_t get_bodies() const { return m_bodies; }
+  size_t get_frame_count() const { return m_times.size(); }
+  float get_start_time() const { return m_times.empty() ? 0.0f : m_times.front(); }
+  float get_end_time() const { return m_times.empty() ? 0.0f : m_times.back(); }
+  // memory held by the encoded frames
+  size_t get_bytes() const;
+
+  // decode frame 'i' into m_bodies samples
+  void frame(size_t i, sample* out) const;
+  // state at 'time', clamped to the recording
+  void seek(float time, sample* out) const;
+  // move the world's particles and springs to their state at 'time'
+  void apply(float time, world_body* world) const;
+
+  // the same layout taken from or written to a world's bodies directly
+  static void capture(const world_body* world, std::vector<sample>& out);
+  static void apply(const std::vector<sample>& state, world_body* world);
+};
+
+#endif // !REPLAY_H
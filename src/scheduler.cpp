@@ -0,0 +1,19 @@
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+
+unsigned int substep_scheduler::substeps(float h) const {
+  if (max_substep <= 0.0f || h <= max_substep)
+    return 1;
+  return (unsigned int)std::ceil(h / max_substep);
+}
+
+unsigned int substep_scheduler::schedule(unsigned int ticks, unsigned int substeps) {
+  m_requested = ticks;
+  m_taken = ticks;
+  // a solver without per tick work costs nothing to fast forward
+  if (budget > 0 && substeps > 0 && ticks > 0)
+    m_taken = std::max(1u, std::min(ticks, budget / substeps));
+  m_dropped += ticks - m_taken;
+  return m_taken;
+}
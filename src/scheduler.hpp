@@ -0,0 +1,38 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// splits the simulation time of each frame into bounded sub-steps
+// a tick covers dt*time_scale of simulation time, which a stepped solver
+// divides into sub-steps no longer than max_substep so high time scales
+// do not break collisions and springs. each frame takes at most 'budget'
+// sub-steps, ticks beyond it are dropped and the run falls behind real
+// time instead of stalling the frame, which is reported
+class substep_scheduler {
+  unsigned int m_requested;
+  unsigned int m_taken;
+  unsigned long long m_dropped;
+
+public:
+  // longest sub-step in simulation seconds, 0 for one sub-step per tick
+  float max_substep;
+  // most sub-steps in one frame, 0 for no limit
+  unsigned int budget;
+
+  substep_scheduler() : m_requested(0), m_taken(0), m_dropped(0), max_substep(1.0f / 120.0f), budget(4096) {}
+
+  void reset() { m_requested = m_taken = 0; m_dropped = 0; }
+  // sub-steps for one tick covering 'h' simulation seconds
+  unsigned int substeps(float h) const;
+  // of 'ticks' ticks costing 'substeps' sub-steps each, how many fit in
+  // the budget, always at least one so the run keeps moving
+  unsigned int schedule(unsigned int ticks, unsigned int substeps);
+
+  // last frame fell behind real time
+  bool is_behind() const { return m_taken < m_requested; }
+  // share of the requested ticks taken last frame
+  float get_rate() const { return m_requested ? (float)m_taken / m_requested : 1.0f; }
+  // ticks dropped since the last reset
+  unsigned long long get_dropped() const { return m_dropped; }
+};
+
+#endif // !SCHEDULER_H
@@ -0,0 +1,25 @@
+#include "sim_clock.hpp"
+
+unsigned int sim_clock::advance(double delta) {
+  if (m_paused || delta <= 0.0)
+    return 0;
+  // clamp stalls, then scale by the fast forward multiplier
+  if (delta > max_delta)
+    delta = max_delta;
+  m_accumulator += delta * speed;
+  // convert whole ticks out of the accumulator
+  unsigned int ticks = (unsigned int)(m_accumulator / m_dt);
+  m_accumulator -= ticks * m_dt;
+  m_ticks += ticks;
+  return ticks;
+}
+
+// change tick length, the current simulation time is kept
+void sim_clock::set_dt(double dt) {
+  if (dt <= 0.0)
+    return;
+  double time = get_time();
+  m_dt = dt;
+  m_ticks = (unsigned long long)(time / dt + 0.5);
+  m_accumulator = 0.0;
+}
@@ -0,0 +1,51 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+// deterministic simulation clock
+// simulation time only moves in whole ticks of a fixed length, so a run
+// depends on the number of ticks taken and not on frame timing
+class sim_clock {
+  // tick length in seconds
+  double m_dt;
+  // real time waiting to be converted into ticks
+  double m_accumulator;
+  unsigned long long m_ticks;
+  bool m_paused;
+
+public:
+  // largest frame delta accepted by advance()
+  // stops a long stall from being replayed as a burst of ticks
+  static constexpr double max_delta = 0.25;
+  // fast forward multiplier applied to real time
+  float speed;
+
+  sim_clock(double dt = 1.0 / 120.0)
+      : m_dt(dt), m_accumulator(0.0), m_ticks(0), m_paused(false), speed(1.0f) {}
+
+  // return to tick zero, keeps tick length and speed
+  void reset() {
+    m_accumulator = 0.0;
+    m_ticks = 0;
+  }
+  // feed a real time frame delta, returns the number of ticks taken
+  unsigned int advance(double delta);
+  // take exactly 'ticks' ticks, ignores pause state
+  // used by the step control and by offline runs
+  void step(unsigned int ticks = 1) { m_ticks += ticks; }
+  // take back ticks that were not simulated
+  void rewind(unsigned int ticks) { m_ticks -= ticks < m_ticks ? ticks : m_ticks; }
+
+  void pause() { m_paused = true; }
+  void resume() { m_paused = false; m_accumulator = 0.0; }
+  bool is_paused() const { return m_paused; }
+
+  void set_dt(double dt);
+  double get_dt() const { return m_dt; }
+  unsigned long long get_ticks() const { return m_ticks; }
+  // simulation time in seconds
+  double get_time() const { return m_ticks * m_dt; }
+  // fraction of a tick left in the accumulator, for interpolating draws
+  double get_alpha() const { return m_accumulator / m_dt; }
+};
+
+#endif // !SIM_CLOCK_H
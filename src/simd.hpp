@@ -0,0 +1,82 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// thin wrappers over the widest float vector the build enables
+// kernels are written once against vfloat and SIMD_WIDTH, the scalar
+// fallback has a width of one so the same loops compile everywhere
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+typedef __m256 vfloat;
+inline vfloat vload(const float* p) { return _mm256_loadu_ps(p); }
+inline void vstore(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+inline vfloat vset(float s) { return _mm256_set1_ps(s); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+inline vfloat vsqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+// nearest whole number
+inline vfloat vround(vfloat a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+// a*b + c
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) {
+#if defined(__FMA__)
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+// x where a < b, zero elsewhere
+inline vfloat vmask_lt(vfloat a, vfloat b, vfloat x) {
+  return _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ), x);
+}
+// x where a < b, y elsewhere
+inline vfloat vselect_lt(vfloat a, vfloat b, vfloat x, vfloat y) {
+  return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+typedef __m128 vfloat;
+inline vfloat vload(const float* p) { return _mm_loadu_ps(p); }
+inline void vstore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+inline vfloat vset(float s) { return _mm_set1_ps(s); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+inline vfloat vsqrt(vfloat a) { return _mm_sqrt_ps(a); }
+inline vfloat vround(vfloat a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline vfloat vmask_lt(vfloat a, vfloat b, vfloat x) {
+  return _mm_and_ps(_mm_cmplt_ps(a, b), x);
+}
+inline vfloat vselect_lt(vfloat a, vfloat b, vfloat x, vfloat y) {
+  __m128 mask = _mm_cmplt_ps(a, b);
+  return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+}
+#else
+#include <cmath>
+#define SIMD_WIDTH 1
+typedef float vfloat;
+inline vfloat vload(const float* p) { return *p; }
+inline void vstore(float* p, vfloat v) { *p = v; }
+inline vfloat vset(float s) { return s; }
+inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+inline vfloat vsub(vfloat a, vfloat b) { return a - b; }
+inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+inline vfloat vdiv(vfloat a, vfloat b) { return a / b; }
+inline vfloat vmin(vfloat a, vfloat b) { return a < b ? a : b; }
+inline vfloat vmax(vfloat a, vfloat b) { return a > b ? a : b; }
+inline vfloat vsqrt(vfloat a) { return std::sqrt(a); }
+inline vfloat vround(vfloat a) { return std::nearbyint(a); }
+inline vfloat vfmadd(vfloat a, vfloat b, vfloat c) { return a * b + c; }
+inline vfloat vmask_lt(vfloat a, vfloat b, vfloat x) { return a < b ? x : 0.0f; }
+inline vfloat vselect_lt(vfloat a, vfloat b, vfloat x, vfloat y) { return a < b ? x : y; }
+#endif
+
+#endif // !SIMD_H
@@ -0,0 +1,76 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include "simd.hpp"
+
+// elementary functions over vfloat lanes
+// polynomial approximations good to a few float ulps over the ranges the
+// closed form solutions use, every simd width runs the same arithmetic
+
+inline vfloat vneg(vfloat a) { return vsub(vset(0.0f), a); }
+inline vfloat vabs(vfloat a) { return vmax(a, vneg(a)); }
+inline vfloat vfloor(vfloat a) {
+  vfloat r = vround(a);
+  return vselect_lt(a, r, vsub(r, vset(1.0f)), r);
+}
+
+// sine and cosine together, arguments reduced to a quarter turn
+inline void vsincos(vfloat x, vfloat& s, vfloat& c) {
+  // quadrant and remainder, pi/2 split in two for an exact reduction
+  vfloat k = vround(vmul(x, vset(0.636619772f)));
+  vfloat r = vsub(x, vmul(k, vset(1.5703125f)));
+  r = vsub(r, vmul(k, vset(4.83826794897e-4f)));
+  vfloat r2 = vmul(r, r);
+  vfloat ps = vfmadd(r2, vset(-1.9515295891e-4f), vset(8.3321608736e-3f));
+  ps = vfmadd(r2, ps, vset(-1.6666654611e-1f));
+  ps = vfmadd(vmul(r2, r), ps, r);
+  vfloat pc = vfmadd(r2, vset(2.443315711809948e-5f), vset(-1.388731625493765e-3f));
+  pc = vfmadd(r2, pc, vset(4.166664568298827e-2f));
+  pc = vfmadd(vmul(r2, r2), pc, vfmadd(r2, vset(-0.5f), vset(1.0f)));
+  // quadrant 0 to 3
+  vfloat q = vsub(k, vmul(vset(4.0f), vfloor(vmul(k, vset(0.25f)))));
+  vfloat odd = vsub(q, vmul(vset(2.0f), vfloor(vmul(q, vset(0.5f)))));
+  // odd quadrants swap sine and cosine
+  vfloat sin_r = vselect_lt(vset(0.5f), odd, pc, ps);
+  vfloat cos_r = vselect_lt(vset(0.5f), odd, ps, pc);
+  // sine is negative in quadrants 2 and 3, cosine in 1 and 2
+  s = vselect_lt(vset(1.5f), q, vneg(sin_r), sin_r);
+  vfloat cq = vabs(vsub(q, vset(1.5f)));
+  c = vselect_lt(cq, vset(1.0f), vneg(cos_r), cos_r);
+}
+
+inline vfloat vsin(vfloat x) {
+  vfloat s, c;
+  vsincos(x, s, c);
+  return s;
+}
+
+inline vfloat vcos(vfloat x) {
+  vfloat s, c;
+  vsincos(x, s, c);
+  return c;
+}
+
+inline vfloat vatan(vfloat x) {
+  vfloat a = vabs(x);
+  // reduce to |a| <= tan(pi/8) around 0, pi/4 or pi/2
+  vfloat big = vdiv(vset(-1.0f), a);
+  vfloat mid = vdiv(vsub(a, vset(1.0f)), vadd(a, vset(1.0f)));
+  vfloat y = vselect_lt(vset(0.414213562f), a, vset(0.785398163f), vset(0.0f));
+  a = vselect_lt(vset(0.414213562f), vabs(x), mid, a);
+  y = vselect_lt(vset(2.414213562f), vabs(x), vset(1.570796327f), y);
+  a = vselect_lt(vset(2.414213562f), vabs(x), big, a);
+  vfloat z = vmul(a, a);
+  vfloat p = vfmadd(z, vset(8.05374449538e-2f), vset(-1.38776856032e-1f));
+  p = vfmadd(z, p, vset(1.99777106478e-1f));
+  p = vfmadd(z, p, vset(-3.33329491539e-1f));
+  y = vadd(y, vfmadd(vmul(z, a), p, a));
+  return vselect_lt(x, vset(0.0f), vneg(y), y);
+}
+
+// nan outside [-1, 1]
+inline vfloat vasin(vfloat x) {
+  return vatan(vdiv(x, vsqrt(vsub(vset(1.0f), vmul(x, x)))));
+}
+
+#endif // !SIMD_MATH_H
@@ -1,9 +1,41 @@
 #include "simulation.hpp"
-#include "object.hpp"
-#include "environment.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include "body.hpp"
+#include "camera.hpp"
 #include "utils.h"
 
-pp::pp(world* world, particle* particle, plane* plane) : simulation(world), m_particle(particle), m_plane(plane) {
+camera* simulation::view;
+
+void simulation::update(float delta) {
+  timestamp timer;
+  timer.begin();
+  unsigned int ticks = m_clock.advance(delta);
+  // ticks past the budget are handed back, so the run slows down rather
+  // than the frame
+  m_clock.rewind(ticks - m_scheduler.schedule(ticks, get_substeps()));
+  evaluate(get_time());
+  m_update_seconds = timer.get_elapsed_time();
+}
+
+// whole steps of 'h' that reach simulation time 'time', rounded to the
+// nearest so a clock time of n ticks is always n steps
+static unsigned long long steps_to(double time, double h) {
+  return time > 0.0 ? (unsigned long long)std::floor(time/h + 0.5) : 0;
+}
+
+// resting offset of a particle of 'radius' on a plane at 'rotation', and
+// the unit step down the slope used by the closed form solutions
+static void plane_frame(float rotation, float radius, glm::vec3& offset, glm::vec3& start) {
+  glm::mat4 t(1.0f);
+  t = glm::rotate(t, rotation, glm::vec3(0.0f, 0.0f, -1.0f));
+  offset = glm::translate(t, glm::vec3(0.0f, radius, 0.0f))[3];
+  t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
+  start = t[3];
+}
+
+pp::pp(world_body* world, particle_body* particle, plane_body* plane) : simulation(world), m_particle(particle), m_plane(plane) {
   reset();
 }
 
@@ -21,38 +53,38 @@ void pp::reset() {
 
 void pp::end() {
   reset();
-  environment::current_camera.snap_to(m_world->position);
+  if (follow && view)
+    view->snap_to(m_world->position);
 }
 
-void pp::update() {
-  // calculate start position
-  glm::mat4 t(1.0f);
-  t = glm::rotate(t, (m_plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
-  glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, m_particle->get_radius(), 0.0f))[3];
-  t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
-  glm::vec3 start = t[3];
-  // calculate displacement parallel to the plane
-  float r = (
-    ((m_particle->force - m_particle->mass*m_world->gravity
-    *sin(m_plane->rotation)))
-    /2*m_particle->mass)
-    *get_time()*get_time() 
-    + m_particle->u_velocity*get_time();
-  m_particle->position = offset+m_world->position+start*m_world->distance+glm::normalize(start)*r*m_particle->get_radius();
+void pp::compile() {
+  glm::vec3 offset, start;
+  plane_frame(m_plane->rotation, m_particle->get_radius(), offset, start);
+  m_plan.origin = glm::dvec3(offset+m_world->position+start*m_world->distance);
+  m_plan.direction = glm::dvec3(glm::normalize(start)*m_particle->get_radius());
+  m_plan.motion = pp_motion<double>(m_particle->mass, m_particle->force, m_particle->u_velocity,
+                                    m_plane->rotation, m_world->gravity);
+}
+
+void pp::evaluate(double time) {
+  // displacement parallel to the plane
+  m_particle->position = m_plan.position(time);
 }
 
 void pp::start() {
     m_time_scale = m_world->time_scale;
     DEBUG_TEXT("now simulating particle and plane")
     // track particle
-    environment::current_camera.track(&m_particle->position);
-    // set timestamp 
-    m_time.begin();
+    if (follow && view)
+      view->track(&m_particle->position);
+    // rewind clock
+    m_clock.reset();
     // snap plane to starting position in case it was not already there
     m_plane->position = m_world->position;
+    compile();
 }
 
-spp::spp(world* world, particle* particle, plane* plane, spring* spring) : 
+spp::spp(world_body* world, particle_body* particle, plane_body* plane, spring_body* spring) : 
   simulation(world), 
   m_particle(particle), 
   m_plane(plane), 
@@ -69,42 +101,32 @@ void spp::reset() {
   t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
   glm::vec3 start = m_world->distance*t[3];
   glm::vec3 position = m_world->position+start+offset; 
-  m_particle->move_to(glm::vec3((m_world->distance+(m_spring->length-m_spring->extension)*spring::coil_width*spring::coils*m_spring->get_scale())*t[3]) + m_world->position+offset);
+  m_particle->move_to(glm::vec3((m_world->distance+(m_spring->length-m_spring->extension)*spring_body::coil_width*spring_body::coils*m_spring->get_scale())*t[3]) + m_world->position+offset);
   m_spring->rotation = m_plane->rotation;
   m_spring->move_to(position);
 }
 void spp::end() {
   m_spring->extension = extension;
   reset();
-  environment::current_camera.snap_to(m_world->position);
+  if (follow && view)
+    view->snap_to(m_world->position);
 }
 
-void spp::update() {
-  // calculate start position
-  glm::mat4 t(1.0f);
-  t = glm::rotate(t, (m_plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
-  glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, m_particle->get_radius(), 0.0f))[3];
-  t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
-  glm::vec3 start = t[3];
-  float scalar = spring::coil_width*spring::coils*m_spring->get_scale();
-  glm::vec3 position = m_world->position+start+offset; 
-  glm::vec3 particle_start = (m_world->distance+(m_spring->length-m_spring->extension))*t[3];
-  // calculate displacement parallel to the plane
-  float n = (m_spring->length/m_spring->elasticity)*(m_spring->elasticity+m_particle->force-m_particle->mass*m_world->gravity*sin(m_plane->rotation));
-  float p = m_spring->length-extension-n;
-  float z = sqrt(m_spring->elasticity/(m_particle->mass*m_spring->length));
-  float u = m_particle->u_velocity;
-
-  float r = p*cos(z*get_time())+u*sin(z*get_time())+n; 
-  float end_time = (asin((p+extension)/sqrt(p*p+u*u)) - atan(p/u))/z;
+void spp::compile() {
+  glm::vec3 offset, start;
+  plane_frame(m_plane->rotation, m_particle->get_radius(), offset, start);
+  float scalar = spring_body::coil_width*spring_body::coils*m_spring->get_scale();
+  m_plan.origin = glm::dvec3(m_world->position+start+offset);
+  m_plan.direction = glm::dvec3(glm::normalize(start)*scalar);
+  m_plan.motion = spp_motion<double>(m_particle->mass, m_particle->force, m_particle->u_velocity,
+                                     m_plane->rotation, m_world->gravity,
+                                     m_spring->length, extension, m_spring->elasticity);
+}
 
-  m_spring->extension = m_spring->length-r;
-  if (get_time() > end_time) {
-    float v = -z*p*sin(z*end_time)+z*u*cos(z*end_time); 
-    float a = (m_particle->force-m_particle->mass*m_world->gravity*sin(m_plane->rotation))/m_particle->mass;
-    r = (a/2.0f)*get_time()*get_time() + (v-end_time*a)*get_time() + m_spring->length - end_time*end_time*a/2.0f - end_time*(v-end_time*a);
-  }
-  m_particle->position = position+(glm::normalize(start)*r)*scalar;
+void spp::evaluate(double time) {
+  // displacement parallel to the plane
+  m_spring->extension = m_plan.extension(time);
+  m_particle->position = m_plan.position(time);
 }
 
 void spp::start() {
@@ -112,22 +134,24 @@ void spp::start() {
     extension = m_spring->extension;
     DEBUG_TEXT("now simulating spring, particle and plane")
     // track particle
-    environment::current_camera.track(&m_particle->position);
-    // set timestamp 
-    m_time.begin();
+    if (follow && view)
+      view->track(&m_particle->position);
+    // rewind clock
+    m_clock.reset();
     glm::mat4 t(1.0f);
     t = glm::rotate(t, (m_plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
     glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, m_particle->get_radius(), 0.0f))[3];
     t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
     glm::vec3 start = m_world->distance*t[3];
     glm::vec3 position = m_world->position+start+offset; 
-    m_particle->position = glm::vec3((m_world->distance+(m_spring->length-m_spring->extension)*spring::coil_width*spring::coils*m_spring->get_scale())*t[3]) + m_world->position+offset;
+    m_particle->position = glm::vec3((m_world->distance+(m_spring->length-m_spring->extension)*spring_body::coil_width*spring_body::coils*m_spring->get_scale())*t[3]) + m_world->position+offset;
     m_spring->position = position;
     // snap plane to starting position in case it was not already there
     m_plane->position = m_world->position;
+    compile();
 }
 
-ppp::ppp(world* world, particle* particle1, particle* particle2, plane* plane) :
+ppp::ppp(world_body* world, particle_body* particle1, particle_body* particle2, plane_body* plane) :
     simulation(world),
     m_particle1(particle1),
     m_particle2(particle2),
@@ -146,33 +170,33 @@ void ppp::reset() {
     t = glm::rotate(t, (m_plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
     glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, m_particle1->get_radius(), 0.0f))[3];
     t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
-    glm::vec3 start = abs(m_world->distance) * t[3];
+    glm::vec3 start = std::abs(m_world->distance) * t[3];
     m_particle1->move_to(m_world->position - (start / 2.0f)*m_particle1->get_radius() + offset);
     m_particle2->move_to(m_world->position + (start / 2.0f)*m_particle2->get_radius() + offset);
 }
 
-void ppp::update() {
-    // calculate start position
-    glm::mat4 t(1.0f);
-    t = glm::rotate(t, (m_plane->rotation), glm::vec3(0.0f, 0.0f, -1.0f));
-    glm::vec3 offset = glm::translate(t, glm::vec3(0.0f, m_particle1->get_radius(), 0.0f))[3];
-    t = glm::translate(t, glm::vec3(-1.0f, 0.0f, 0.0f));
-    glm::vec3 start = t[3];
-    float collision_time = ((m_world->distance*m_particle1->get_radius() - m_particle1->get_radius() - m_particle2->get_radius())/ m_particle1->get_radius()) / (m_particle1->u_velocity + m_particle2->u_velocity);
-    float v1 = (m_particle1->u_velocity * m_particle1->mass - m_particle2->u_velocity * m_particle2->mass - m_world->restitution * (m_particle2->mass) * (m_particle1->u_velocity + m_particle2->u_velocity)) / (m_particle1->mass + m_particle2->mass);
-    float v2 = (m_particle1->u_velocity*m_particle1->mass-m_particle2->u_velocity*m_particle2->mass+m_world->restitution*(m_particle1->mass)*(m_particle1->u_velocity+m_particle2->u_velocity))/(m_particle1->mass+m_particle2->mass);
-    float r1 = m_particle1->u_velocity * get_time() - m_world->distance / 2.0f;
-    float r2 = -m_particle2->u_velocity * get_time() + m_world->distance / 2.0f;
+void ppp::compile() {
+    glm::vec3 offset, start;
+    plane_frame(m_plane->rotation, m_particle1->get_radius(), offset, start);
+    glm::vec3 axis = glm::normalize(start);
+    m_plan.origin = glm::dvec3(offset + m_world->position);
+    m_plan.direction1 = glm::dvec3(axis * m_particle1->get_radius());
+    m_plan.direction2 = glm::dvec3(axis * m_particle2->get_radius());
+    m_plan.motion = ppp_motion<double>(m_particle1->mass, m_particle2->mass,
+                                       m_particle1->u_velocity, m_particle2->u_velocity, m_world->distance,
+                                       m_particle1->get_radius(), m_particle2->get_radius(), m_world->restitution);
+}
 
-    if (get_time() > collision_time) {
-        r1 = v1 * (get_time()-collision_time) + m_particle1->u_velocity*collision_time - m_world->distance / 2.0f;
-        r2 = v2 * (get_time()-collision_time) + -m_particle2->u_velocity *collision_time + m_world->distance / 2.0f;
+void ppp::evaluate(double time) {
+    double r1, r2;
+    m_plan.motion.displacement(time, r1, r2);
+    if (follow && view) {
+        view->snap_to(glm::vec3(m_plan.origin + m_plan.direction1 * ((r1 + r2) / 2.0)));
+        view->zoom = (float)std::max(std::abs(r1 - r2) * 0.8, 8.0);
     }
-    environment::current_camera.snap_to(offset + m_world->position + glm::normalize(start) * ((r1 + r2) / 2.0f) * m_particle1->get_radius());
-    environment::current_camera.zoom = std::max(abs(r1 - r2) * 0.8f, 8.0f);
-    // calculate displacement parallel to the plane
-    m_particle1->position = offset + m_world->position + glm::normalize(start) * r1 * m_particle1->get_radius();
-    m_particle2->position = offset + m_world->position + glm::normalize(start) * r2 * m_particle2->get_radius();
+    // displacement parallel to the plane
+    m_particle1->position = glm::vec3(m_plan.origin + m_plan.direction1 * r1);
+    m_particle2->position = glm::vec3(m_plan.origin + m_plan.direction2 * r2);
 }
 
 void ppp::start() {
@@ -182,16 +206,624 @@ void ppp::start() {
     glm::vec3 start = t[3];
     m_time_scale = m_world->time_scale;
     DEBUG_TEXT("now simulating particle and particle")
-    // set timestamp 
-    m_time.begin();
+    // rewind clock
+    m_clock.reset();
     // snap plane to starting position in case it was not already there
     m_plane->position = m_world->position;
+    compile();
 }
 
 void ppp::end() {
-    environment::current_camera.zoom = 8.0f;
+    if (follow && view)
+        view->zoom = 8.0f;
     reset();
-    environment::current_camera.snap_to(m_world->position);
+    if (follow && view)
+        view->snap_to(m_world->position);
 }
 
+piecewise::piecewise(world_body* world, particle_body* particle) : simulation(world), m_particle(particle) {
+    reset();
+}
+
+void piecewise::build() {
+    const std::vector<plane_body*>& planes = m_world->get_planes();
+    m_track = plane_track();
+    for (plane_body* pl : planes) {
+        double length = (double)pl->length*pl->get_scale();
+        // the first plane is centred on the world's position
+        glm::dvec3 down(cos(pl->rotation), -sin(pl->rotation), 0.0);
+        m_track.add(pl->rotation, length, glm::dvec3(m_world->position) - down*(length/2));
+    }
+    if (m_track.segments.empty())
+        return;
+    // force and velocity up the first plane, as for pp
+    const plane_track::segment& first = m_track.segments[0];
+    m_track.acceleration = glm::dvec3(0.0, -m_world->gravity, 0.0) - first.direction*((double)m_particle->force/m_particle->mass);
+    m_track.radius = m_particle->get_radius();
+    m_track.launch(0, first.length/2 - m_world->distance, -m_particle->u_velocity);
+}
+
+void piecewise::reset() {
+    build();
+    const std::vector<plane_body*>& planes = m_world->get_planes();
+    for (size_t i = 0; i < planes.size() && i < m_track.segments.size(); i++) {
+        const plane_track::segment& g = m_track.segments[i];
+        planes[i]->move_to(glm::vec3(g.start + g.direction*(g.length/2)));
+    }
+    if (!m_track.segments.empty())
+        m_particle->move_to(glm::vec3(m_track.position(0.0)));
+}
+
+void piecewise::evaluate(double time) {
+    // the track works out the transitions up to 'time' once, later frames
+    // only evaluate the piece they fall in. without planes there is no
+    // track and the particle stays put
+    if (m_track.segments.empty())
+        return;
+    m_particle->position = glm::vec3(m_track.position(time));
+}
 
+void piecewise::start() {
+    m_time_scale = m_world->time_scale;
+    DEBUG_TEXT("now simulating particle and chain of planes")
+    if (follow && view)
+        view->track(&m_particle->position);
+    m_clock.reset();
+    // snap the planes into the chain in case they were not already there
+    build();
+    const std::vector<plane_body*>& planes = m_world->get_planes();
+    for (size_t i = 0; i < planes.size() && i < m_track.segments.size(); i++) {
+        const plane_track::segment& g = m_track.segments[i];
+        planes[i]->position = glm::vec3(g.start + g.direction*(g.length/2));
+    }
+}
+
+void piecewise::end() {
+    reset();
+    if (follow && view)
+        view->snap_to(m_world->position);
+}
+
+numeric::numeric(world_body* world, integrator* integrator) :
+    simulation(world),
+    m_integrator(integrator),
+    m_system_steps(0) {
+    reset();
+}
+
+// slope direction of the world's first plane, or the x axis without one
+static glm::vec3 slope_direction(world_body* world) {
+    if (world->get_planes().empty())
+        return glm::vec3(1.0f, 0.0f, 0.0f);
+    float rotation = world->get_planes()[0]->rotation;
+    return glm::vec3(-cos(rotation), sin(rotation), 0.0f);
+}
+
+void numeric::build() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    const std::vector<spring_body*>& springs = m_world->get_springs();
+    glm::vec3 direction = slope_direction(m_world);
+    m_system = ode_system();
+    m_system.gravity = glm::vec3(0.0f, -m_world->gravity, 0.0f);
+    m_system.restitution = m_world->restitution;
+    m_system.collide_particles = true;
+    m_system.mutual_gravity = m_world->mutual_gravity;
+    m_system.attraction.gravitational_constant = m_world->gravitational_constant;
+    m_system.attraction.opening_angle = m_world->opening_angle;
+    m_system.pool = m_world->pool;
+    // particles are solid balls, so the pull is softened inside the smallest
+    m_system.attraction.softening = particles.empty() ? 0.0f : particles[0]->get_radius();
+    for (size_t i = 0; i < particles.size(); i++) {
+        particle_body* pa = particles[i];
+        glm::vec3 position = i < m_particle_start.size() ? m_particle_start[i] : pa->position;
+        int idx = m_system.add_particle(position, direction * pa->u_velocity, pa->mass, pa->get_radius());
+        m_system.particles.view(idx).set_applied(direction * pa->force);
+        m_system.attraction.softening = std::min(m_system.attraction.softening, pa->get_radius());
+    }
+    std::unordered_map<const body*, int> particle_index;
+    for (size_t i = 0; i < particles.size(); i++)
+        particle_index[particles[i]] = (int)i;
+    auto index_of = [&](const body* end) {
+        std::unordered_map<const body*, int>::const_iterator it = particle_index.find(end);
+        return it == particle_index.end() ? -1 : it->second;
+    };
+    m_spring_link.assign(springs.size(), -1);
+    m_spring_rod.assign(springs.size(), -1);
+    const bool rods = m_world->solver == world_body::SOLVER::CONSTRAINED;
+    for (size_t i = 0; i < springs.size(); i++) {
+        spring_body* sp = springs[i];
+        float scalar = spring_body::coil_width*spring_body::coils*sp->get_scale();
+        ode_system::link l;
+        l.rest_length = sp->length*scalar;
+        l.stiffness = sp->elasticity/sp->length;
+        if (!sp->end_a && !sp->end_b) {
+            // spring i rests against particle i
+            if (i >= particles.size())
+                continue;
+            l.a = (int)i;
+            l.b = -1;
+            l.anchor = sp->position;
+            l.push_only = true;
+        } else {
+            // network spring, both ways between its ends, a point or a
+            // missing end holds it fixed
+            int a = index_of(sp->end_a), b = index_of(sp->end_b);
+            const body* fixed = sp->end_b;
+            if (a < 0) {
+                std::swap(a, b);
+                fixed = sp->end_a;
+            }
+            if (a < 0 || a == b)
+                continue;
+            l.a = a;
+            l.b = b;
+            l.anchor = fixed ? fixed->position : sp->position;
+            l.push_only = false;
+            if (rods && sp->rigid) {
+                // held at the length it starts at
+                ode_system::rod r;
+                r.a = a;
+                r.b = b;
+                r.anchor = l.anchor;
+                glm::vec3 other = b < 0 ? r.anchor : m_system.particles.position.get(b);
+                r.length = glm::length(m_system.particles.position.get(a) - other);
+                r.hinged = sp->hinged && glm::length(sp->hinge_axis) > 0.0f;
+                r.axis = r.hinged ? glm::normalize(sp->hinge_axis) : glm::vec3(0.0f);
+                m_spring_rod[i] = (int)m_system.rods.size();
+                m_system.rods.push_back(r);
+                continue;
+            }
+        }
+        m_spring_link[i] = (int)m_system.links.size();
+        m_system.links.push_back(l);
+    }
+    for (plane_body* pl : m_world->get_planes()) {
+        ode_system::contact c;
+        c.point = pl->position;
+        c.normal = glm::vec3(sin(pl->rotation), cos(pl->rotation), 0.0f);
+        m_system.contacts.push_back(c);
+    }
+    // solvers that split their work share the world's pool
+    if (implicit_euler* implicit = dynamic_cast<implicit_euler*>(m_integrator))
+        implicit->solver.pool = m_world->pool;
+    if (pbd* projection = dynamic_cast<pbd*>(m_integrator))
+        projection->pool = m_world->pool;
+    if (constrained_euler* constrained = dynamic_cast<constrained_euler*>(m_integrator))
+        constrained->pool = m_world->pool;
+    m_integrator->reset();
+    m_system_steps = 0;
+}
+
+// stretch a spring from 'other' to 'end', a push only spring stays at
+// 'rest_length' once it lets go and keeps its position
+static void place_spring(spring_body* sp, glm::vec3 end, glm::vec3 other, bool push_only, float rest_length) {
+    float scalar = spring_body::coil_width*spring_body::coils*sp->get_scale();
+    glm::vec3 d = end - other;
+    float length = glm::length(d);
+    if (push_only && (length <= 0.0f || length > rest_length)) {
+        length = rest_length;
+    } else if (length > 0.0f) {
+        sp->rotation = atan2(d.y, -d.x);
+        if (!push_only)
+            sp->position = other;
+    }
+    sp->extension = sp->length - length/scalar;
+}
+
+void numeric::write_back() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    const std::vector<spring_body*>& springs = m_world->get_springs();
+    for (size_t i = 0; i < particles.size() && i < m_system.size(); i++)
+        particles[i]->position = m_system.particles.view(i).get_position();
+    // stretch each spring to its particle, network springs hang from
+    // their second end
+    for (size_t i = 0; i < springs.size() && i < m_spring_link.size(); i++) {
+        int a, b;
+        glm::vec3 anchor;
+        bool push_only = false;
+        float rest_length = 0.0f;
+        if (m_spring_link[i] >= 0) {
+            const ode_system::link& l = m_system.links[m_spring_link[i]];
+            a = l.a;
+            b = l.b;
+            anchor = l.anchor;
+            push_only = l.push_only;
+            rest_length = l.rest_length;
+        } else if (m_spring_rod[i] >= 0) {
+            const ode_system::rod& r = m_system.rods[m_spring_rod[i]];
+            a = r.a;
+            b = r.b;
+            anchor = r.anchor;
+        } else {
+            continue;
+        }
+        glm::vec3 other = b < 0 ? anchor : m_system.particles.position.get(b);
+        place_spring(springs[i], m_system.particles.position.get(a), other, push_only, rest_length);
+    }
+}
+
+void numeric::reset() {
+    // return bodies to where the last run started
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    for (size_t i = 0; i < particles.size() && i < m_particle_start.size(); i++)
+        particles[i]->move_to(m_particle_start[i]);
+    m_particle_start.clear();
+}
+
+unsigned int numeric::get_substeps() const {
+    return m_scheduler.substeps(m_clock.get_dt()*m_time_scale);
+}
+
+void numeric::evaluate(double time) {
+    // fixed step of one clock tick in simulation time, split into equal
+    // sub-steps so a large time scale keeps a small integration step
+    double h = m_clock.get_dt()*m_time_scale;
+    if (h <= 0.0)
+        return;
+    unsigned int substeps = get_substeps();
+    float sub = (float)(h/substeps);
+    unsigned long long steps = steps_to(time, h);
+    // stepped state cannot run backwards, replay from the start
+    if (steps < m_system_steps)
+        build();
+    for (; m_system_steps < steps; m_system_steps++) {
+        for (unsigned int i = 0; i < substeps; i++)
+            m_integrator->step(m_system, sub);
+    }
+    write_back();
+}
+
+void numeric::start() {
+    m_time_scale = m_world->time_scale;
+    DEBUG_TEXT("now simulating numerically")
+    // capture the starting state
+    m_particle_start.clear();
+    for (particle_body* pa : m_world->get_particles())
+        m_particle_start.push_back(pa->position);
+    m_spring_extension.clear();
+    m_spring_rotation.clear();
+    m_spring_position.clear();
+    for (spring_body* sp : m_world->get_springs()) {
+        m_spring_extension.push_back(sp->extension);
+        m_spring_rotation.push_back(sp->rotation);
+        m_spring_position.push_back(sp->position);
+    }
+    build();
+    // track first particle
+    if (follow && view)
+        view->track(&m_world->get_particles()[0]->position);
+    // rewind clock
+    m_clock.reset();
+}
+
+void numeric::end() {
+    const std::vector<spring_body*>& springs = m_world->get_springs();
+    for (size_t i = 0; i < springs.size() && i < m_spring_extension.size(); i++) {
+        springs[i]->extension = m_spring_extension[i];
+        springs[i]->rotation = m_spring_rotation[i];
+        springs[i]->move_to(m_spring_position[i]);
+    }
+    reset();
+    if (follow && view)
+        view->snap_to(m_world->position);
+}
+
+event_driven::event_driven(world_body* world) : simulation(world) {
+    reset();
+}
+
+void event_driven::build() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    glm::vec3 direction = slope_direction(m_world);
+    m_system = event_system();
+    m_system.gravity = glm::vec3(0.0f, -m_world->gravity, 0.0f);
+    m_system.restitution = m_world->restitution;
+    for (size_t i = 0; i < particles.size(); i++) {
+        particle_body* pa = particles[i];
+        glm::vec3 position = i < m_particle_start.size() ? m_particle_start[i] : pa->position;
+        int idx = m_system.add_particle(position, direction * pa->u_velocity, pa->mass, pa->get_radius());
+        m_system.particles.view(idx).set_applied(direction * pa->force);
+    }
+    for (plane_body* pl : m_world->get_planes()) {
+        event_system::contact c;
+        c.point = pl->position;
+        c.normal = glm::vec3(sin(pl->rotation), cos(pl->rotation), 0.0f);
+        m_system.contacts.push_back(c);
+    }
+    m_system.build();
+}
+
+void event_driven::write_back() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    for (size_t i = 0; i < particles.size() && i < m_system.size(); i++)
+        particles[i]->position = m_system.particles.view(i).get_position();
+}
+
+void event_driven::reset() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    for (size_t i = 0; i < particles.size() && i < m_particle_start.size(); i++)
+        particles[i]->move_to(m_particle_start[i]);
+    m_particle_start.clear();
+}
+
+void event_driven::evaluate(double time) {
+    // paths are exact, so any time can be reached directly, only going
+    // backwards needs a replay from the start. the system keeps its time
+    // in float, so the frame time is compared as it will be stored
+    float t = (float)time;
+    if (t < m_system.get_time())
+        build();
+    m_system.advance(t);
+    write_back();
+}
+
+void event_driven::start() {
+    m_time_scale = m_world->time_scale;
+    DEBUG_TEXT("now simulating event driven")
+    m_particle_start.clear();
+    for (particle_body* pa : m_world->get_particles())
+        m_particle_start.push_back(pa->position);
+    build();
+    if (follow && view)
+        view->track(&m_world->get_particles()[0]->position);
+    m_clock.reset();
+}
+
+void event_driven::end() {
+    reset();
+    if (follow && view)
+        view->snap_to(m_world->position);
+}
+
+modal::modal(world_body* world) : simulation(world) {
+    reset();
+}
+
+bool modal::build() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    const std::vector<spring_body*>& springs = m_world->get_springs();
+    glm::vec3 direction = slope_direction(m_world);
+    std::vector<glm::dvec3> position, velocity, force;
+    std::vector<double> mass;
+    std::unordered_map<const body*, int> particle_index;
+    for (size_t i = 0; i < particles.size(); i++) {
+        particle_body* pa = particles[i];
+        position.push_back(glm::dvec3(i < m_particle_start.size() ? m_particle_start[i] : pa->position));
+        velocity.push_back(glm::dvec3(direction * pa->u_velocity));
+        force.push_back(glm::dvec3(direction * pa->force + glm::vec3(0.0f, -m_world->gravity, 0.0f) * pa->mass));
+        mass.push_back(pa->mass);
+        particle_index[pa] = (int)i;
+    }
+    auto index_of = [&](const body* end) {
+        std::unordered_map<const body*, int>::const_iterator it = particle_index.find(end);
+        return it == particle_index.end() ? -1 : it->second;
+    };
+    // network springs only, as numeric joins them
+    std::vector<spring_modes::spring> joined;
+    m_spring_ends.assign(springs.size(), spring_ends{ -1, -1, glm::vec3(0.0f) });
+    for (size_t i = 0; i < springs.size(); i++) {
+        spring_body* sp = springs[i];
+        int a = index_of(sp->end_a), b = index_of(sp->end_b);
+        const body* fixed = sp->end_b;
+        if (a < 0) {
+            std::swap(a, b);
+            fixed = sp->end_a;
+        }
+        if (a < 0 || a == b)
+            continue;
+        float scalar = spring_body::coil_width*spring_body::coils*sp->get_scale();
+        spring_modes::spring s;
+        s.a = a;
+        s.b = b;
+        s.anchor = glm::dvec3(fixed ? fixed->position : sp->position);
+        s.rest_length = sp->length*scalar;
+        s.stiffness = sp->elasticity/sp->length;
+        joined.push_back(s);
+        m_spring_ends[i] = spring_ends{ a, b, glm::vec3(s.anchor) };
+    }
+    return m_modes.build(position, velocity, mass, force, joined);
+}
+
+void modal::write_back() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    const std::vector<spring_body*>& springs = m_world->get_springs();
+    for (size_t i = 0; i < particles.size() && i < m_positions.size(); i++)
+        particles[i]->position = m_positions[i];
+    for (size_t i = 0; i < springs.size() && i < m_spring_ends.size(); i++) {
+        const spring_ends& e = m_spring_ends[i];
+        if (e.a < 0 || e.a >= (int)m_positions.size())
+            continue;
+        glm::vec3 other = e.b < 0 ? e.anchor : m_positions[e.b];
+        place_spring(springs[i], m_positions[e.a], other, false, 0.0f);
+    }
+}
+
+void modal::reset() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    for (size_t i = 0; i < particles.size() && i < m_particle_start.size(); i++)
+        particles[i]->move_to(m_particle_start[i]);
+    m_particle_start.clear();
+}
+
+void modal::evaluate(double time) {
+    // every mode is in closed form, any time is reached directly
+    m_modes.positions(time, m_positions);
+    write_back();
+}
+
+void modal::start() {
+    m_time_scale = m_world->time_scale;
+    DEBUG_TEXT("now simulating normal modes")
+    m_particle_start.clear();
+    for (particle_body* pa : m_world->get_particles())
+        m_particle_start.push_back(pa->position);
+    m_spring_extension.clear();
+    m_spring_rotation.clear();
+    m_spring_position.clear();
+    for (spring_body* sp : m_world->get_springs()) {
+        m_spring_extension.push_back(sp->extension);
+        m_spring_rotation.push_back(sp->rotation);
+        m_spring_position.push_back(sp->position);
+    }
+    build();
+    if (follow && view)
+        view->track(&m_world->get_particles()[0]->position);
+    m_clock.reset();
+}
+
+void modal::end() {
+    const std::vector<spring_body*>& springs = m_world->get_springs();
+    for (size_t i = 0; i < springs.size() && i < m_spring_extension.size(); i++) {
+        springs[i]->extension = m_spring_extension[i];
+        springs[i]->rotation = m_spring_rotation[i];
+        springs[i]->move_to(m_spring_position[i]);
+    }
+    reset();
+    if (follow && view)
+        view->snap_to(m_world->position);
+}
+
+orbital::orbital(world_body* world) : simulation(world) {
+    reset();
+}
+
+void orbital::build() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    m_orbits.clear();
+    m_orbits.centre = glm::dvec3(m_world->position);
+    m_orbits.mu = (double)m_world->gravitational_constant*m_world->central_mass;
+    m_orbits.pool = m_world->pool;
+    for (size_t i = 0; i < particles.size(); i++) {
+        particle_body* pa = particles[i];
+        glm::vec3 position = i < m_particle_start.size() ? m_particle_start[i] : pa->position;
+        glm::vec3 across = glm::cross(glm::vec3(0.0f, 0.0f, 1.0f), position - m_world->position);
+        glm::vec3 velocity = glm::length(across) > 0.0f ? glm::normalize(across)*pa->u_velocity : glm::vec3(0.0f);
+        m_orbits.add(glm::dvec3(position), glm::dvec3(velocity));
+    }
+}
+
+void orbital::reset() {
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    for (size_t i = 0; i < particles.size() && i < m_particle_start.size(); i++)
+        particles[i]->move_to(m_particle_start[i]);
+    m_particle_start.clear();
+}
+
+void orbital::evaluate(double time) {
+    // every orbit is in closed form, any time is reached directly
+    m_orbits.positions(time, m_positions);
+    const std::vector<particle_body*>& particles = m_world->get_particles();
+    for (size_t i = 0; i < particles.size() && i < m_positions.size(); i++)
+        particles[i]->position = m_positions.get(i);
+}
+
+void orbital::start() {
+    m_time_scale = m_world->time_scale;
+    DEBUG_TEXT("now simulating kepler orbits")
+    m_particle_start.clear();
+    for (particle_body* pa : m_world->get_particles())
+        m_particle_start.push_back(pa->position);
+    build();
+    if (follow && view)
+        view->snap_to(m_world->position);
+    m_clock.reset();
+}
+
+void orbital::end() {
+    reset();
+    if (follow && view)
+        view->snap_to(m_world->position);
+}
+
+hydrodynamic::hydrodynamic(world_body* world) :
+    simulation(world),
+    m_fluid_steps(0),
+    m_stable_step(0.0f) {
+    reset();
+}
+
+void hydrodynamic::build() {
+    const std::vector<fluid_body*>& fluids = m_world->get_fluids();
+    m_fluid = sph_fluid();
+    m_fluid.gravity = glm::vec3(0.0f, -m_world->gravity, 0.0f);
+    m_fluid.restitution = m_world->restitution;
+    m_fluid.pool = m_world->pool;
+    m_fluid_start.clear();
+    if (!fluids.empty()) {
+        m_fluid.smoothing_length = fluids[0]->smoothing_length;
+        m_fluid.rest_density = fluids[0]->rest_density;
+        m_fluid.stiffness = fluids[0]->stiffness;
+        m_fluid.viscosity = fluids[0]->viscosity;
+    }
+    for (fluid_body* fl : fluids) {
+        m_fluid_start.push_back(m_fluid.size());
+        m_fluid.add_block(fl->position - fl->size*0.5f, fl->position + fl->size*0.5f);
+    }
+    m_fluid_start.push_back(m_fluid.size());
+    for (plane_body* pl : m_world->get_planes()) {
+        sph_fluid::contact c;
+        c.point = pl->position;
+        c.normal = glm::vec3(sin(pl->rotation), cos(pl->rotation), 0.0f);
+        m_fluid.contacts.push_back(c);
+    }
+    m_stable_step = m_fluid.stable_step();
+    m_fluid_steps = 0;
+}
+
+void hydrodynamic::write_back() {
+    const std::vector<fluid_body*>& fluids = m_world->get_fluids();
+    for (size_t f = 0; f < fluids.size() && f + 1 < m_fluid_start.size(); f++) {
+        size_t first = m_fluid_start[f], end = m_fluid_start[f + 1];
+        size_t stride = (end - first + fluid_body::max_samples - 1)/fluid_body::max_samples;
+        fluids[f]->samples.clear();
+        for (size_t i = first; i < end; i += std::max(stride, (size_t)1))
+            fluids[f]->samples.push_back(m_fluid.particles.position.get(i));
+    }
+}
+
+void hydrodynamic::reset() {
+    for (fluid_body* fl : m_world->get_fluids())
+        fl->samples.clear();
+}
+
+unsigned int hydrodynamic::get_substeps() const {
+    float h = m_clock.get_dt()*m_time_scale;
+    unsigned int substeps = m_scheduler.substeps(h);
+    if (m_stable_step > 0.0f)
+        substeps = std::max(substeps, (unsigned int)std::ceil(h/m_stable_step));
+    return substeps;
+}
+
+void hydrodynamic::evaluate(double time) {
+    double h = m_clock.get_dt()*m_time_scale;
+    if (h <= 0.0)
+        return;
+    unsigned long long steps = steps_to(time, h);
+    // stepped state cannot run backwards, replay from the start
+    if (steps < m_fluid_steps)
+        build();
+    for (; m_fluid_steps < steps; m_fluid_steps++) {
+        unsigned int substeps = get_substeps();
+        float sub = (float)(h/substeps);
+        for (unsigned int i = 0; i < substeps; i++)
+            m_fluid.step(sub);
+        m_stable_step = m_fluid.stable_step();
+    }
+    write_back();
+}
+
+void hydrodynamic::start() {
+    m_time_scale = m_world->time_scale;
+    DEBUG_TEXT("now simulating fluid")
+    build();
+    write_back();
+    if (follow && view)
+        view->snap_to(m_world->position);
+    m_clock.reset();
+}
+
+void hydrodynamic::end() {
+    reset();
+    if (follow && view)
+        view->snap_to(m_world->position);
+}
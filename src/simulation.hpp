@@ -3,17 +3,27 @@
 
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
-#include "imgui.h"
+#include "closed_form.hpp"
+#include "event_system.hpp"
+#include "integrator.hpp"
+#include "kepler.hpp"
+#include "modes.hpp"
+#include "scheduler.hpp"
+#include "sim_clock.hpp"
+#include "sph.hpp"
+#include "track.hpp"
 
-class world;
-class particle;
-class plane;
-class spring;
+class world_body;
+class particle_body;
+class plane_body;
+class spring_body;
+class camera;
+class integrator;
 // holds a point in time for reference
 class timestamp {
   std::chrono::time_point<std::chrono::system_clock> start;
@@ -32,61 +42,283 @@ public:
 // blank simulation interface to inherit
 class simulation {
 protected:
-  world* m_world;
-  timestamp m_time;
+  world_body* m_world;
+  sim_clock m_clock;
+  substep_scheduler m_scheduler;
   float m_time_scale;
-  float get_time() { return m_time.get_elapsed_time()*m_time_scale; };
+  // wall time the last update() took
+  double m_update_seconds;
 public:
-  simulation(world* world) : m_world(world), m_time_scale(1.0f) {}
+  // camera followed during a simulation, NULL when running headless
+  static camera* view;
+  // whether this simulation drives the camera, only one of several
+  // simulations running side by side should
+  bool follow;
+  simulation(world_body* world) : m_world(world), m_time_scale(1.0f), m_update_seconds(0.0), follow(true) {}
   virtual ~simulation() {};
+  // in double as the clock keeps it, long runs lose no ticks to rounding
+  double get_time() { return m_clock.get_time()*m_time_scale; };
+  sim_clock& get_clock() { return m_clock; }
+  substep_scheduler& get_scheduler() { return m_scheduler; }
+  // sub-steps taken per tick, 0 when the cost of evaluate() does not
+  // grow with the ticks taken
+  virtual unsigned int get_substeps() const { return 0; }
+  double get_update_seconds() const { return m_update_seconds; }
   virtual void reset() = 0;
-  virtual void update() = 0;
+  // move bodies to their state at simulation time 'time'
+  virtual void evaluate(double time) = 0;
   virtual void start() = 0;
   virtual void end() = 0;
-  virtual void show() {
-      ImGui::Text((std::string("time: ") + std::to_string(get_time())).c_str());
+  // frame logic step, converts the real frame delta into fixed ticks,
+  // as many as the scheduler's budget allows
+  // touches only this simulation's world, so separate worlds can update
+  // on separate threads
+  void update(float delta);
+  // offline run, takes 'ticks' fixed ticks without waiting on real time
+  void run(unsigned int ticks) { m_clock.step(ticks); evaluate(get_time()); }
+};
+
+// closed form simulations compile their bodies into a plan on start()
+// a plan holds every term that stays fixed for the run, so evaluate()
+// only works out the time dependent part, in double so long runs far
+// from the origin only round once, into the body positions
+
+// particle position = origin + direction*displacement(t)
+struct pp_plan {
+  glm::dvec3 origin;
+  glm::dvec3 direction;
+  pp_motion<double> motion;
+  glm::vec3 position(double t) const { return glm::vec3(origin + direction*motion.displacement(t)); }
+};
+
+// as pp_plan, and the spring gives back extension(t)
+struct spp_plan {
+  glm::dvec3 origin;
+  glm::dvec3 direction;
+  spp_motion<double> motion;
+  glm::vec3 position(double t) const { return glm::vec3(origin + direction*motion.displacement(t)); }
+  float extension(double t) const { return (float)(motion.length - motion.spring(t)); }
+};
+
+// particle i is at origin + direction_i*r_i
+struct ppp_plan {
+  glm::dvec3 origin;
+  glm::dvec3 direction1;
+  glm::dvec3 direction2;
+  ppp_motion<double> motion;
+  void positions(double t, glm::vec3& position1, glm::vec3& position2) const {
+    double r1, r2;
+    motion.displacement(t, r1, r2);
+    position1 = glm::vec3(origin + direction1*r1);
+    position2 = glm::vec3(origin + direction2*r2);
   }
 };
 
 // simulation of a particle and a plane
-class pp : public simulation {
-  particle* m_particle;
-  plane* m_plane;
+class pp final : public simulation {
+  particle_body* m_particle;
+  plane_body* m_plane;
+  pp_plan m_plan;
+  void compile();
 public:
-  pp (world* world, particle* particle, plane* plane);
+  pp (world_body* world, particle_body* particle, plane_body* plane);
   void reset() override;
-  void update() override;
+  void evaluate(double time) override;
   void start() override;
   void end() override;
+  // valid once started
+  const pp_plan& get_plan() const { return m_plan; }
+  particle_body* get_particle() const { return m_particle; }
 };
 
-class spp : public simulation {
+class spp final : public simulation {
   float extension;
-  spring* m_spring;
-  particle* m_particle;
-  plane* m_plane;
+  spring_body* m_spring;
+  particle_body* m_particle;
+  plane_body* m_plane;
+  spp_plan m_plan;
+  void compile();
 public:
-  spp(world* world, particle* particle, plane* plane, spring* spring);
+  spp(world_body* world, particle_body* particle, plane_body* plane, spring_body* spring);
   void reset() override;
-  void update() override;
+  void evaluate(double time) override;
   void start() override;
   void end() override;
+  // valid once started
+  const spp_plan& get_plan() const { return m_plan; }
+  particle_body* get_particle() const { return m_particle; }
+  spring_body* get_spring() const { return m_spring; }
 };
 
-class ppp : public simulation {
+class ppp final : public simulation {
     float extension;
-    spring* m_spring;
-    particle* m_particle1;
-    particle* m_particle2;
-    plane* m_plane;
+    spring_body* m_spring;
+    particle_body* m_particle1;
+    particle_body* m_particle2;
+    plane_body* m_plane;
+    ppp_plan m_plan;
+    void compile();
 public:
-    ppp(world* world, particle* particle1, particle* particle2, plane* plane);
+    ppp(world_body* world, particle_body* particle1, particle_body* particle2, plane_body* plane);
     void reset() override;
-    void update() override;
+    void evaluate(double time) override;
     void start() override;
     void end() override;
+    // valid once started
+    const ppp_plan& get_plan() const { return m_plan; }
+    particle_body* get_particle1() const { return m_particle1; }
+    particle_body* get_particle2() const { return m_particle2; }
 };
 
+// particle sliding along every plane of a world, joined end to end
+// the first plane sits on the world's position as pp's does, and the
+// particle starts the world's distance up it, at its u_velocity and
+// pushed by its force along it. it slides, flies off edges and lands
+// again in closed form, see track.hpp, so long runs pick up no error
+// and a frame costs no more than pp's. springs are not simulated
+class piecewise final : public simulation {
+  particle_body* m_particle;
+  plane_track m_track;
+  void build();
+public:
+  piecewise(world_body* world, particle_body* particle);
+  void reset() override;
+  void evaluate(double time) override;
+  void start() override;
+  void end() override;
+  const plane_track& get_track() const { return m_track; }
+};
+
+// numerical simulation of every particle, plane and spring in a world
+// particles fall under world gravity and collide with each other and with
+// planes, which act as unbounded floors, spring i pushes particle i away from the spring's
+// position, forces and initial velocities act along the first plane
+class numeric : public simulation {
+  integrator* m_integrator;
+  ode_system m_system;
+  // whole steps m_system has been taken, so repeated addition never
+  // drifts off the clock's ticks
+  unsigned long long m_system_steps;
+  // body state captured by start() and restored by end()
+  std::vector<glm::vec3> m_particle_start;
+  std::vector<float> m_spring_extension;
+  std::vector<float> m_spring_rotation;
+  std::vector<glm::vec3> m_spring_position;
+  // link or rod of each spring in m_system, -1 for springs left out
+  std::vector<int> m_spring_link;
+  std::vector<int> m_spring_rod;
+  // load m_system from the captured start state
+  void build();
+  // copy m_system back into the bodies
+  void write_back();
+public:
+  // takes ownership of the integrator
+  numeric(world_body* world, integrator* integrator);
+  ~numeric() { delete m_integrator; }
+  void reset() override;
+  void evaluate(double time) override;
+  void start() override;
+  void end() override;
+  unsigned int get_substeps() const override;
+  const ode_system& get_system() const { return m_system; }
+  const integrator* get_integrator() const { return m_integrator; }
+};
 
+// event driven simulation of every particle and plane in a world
+// particles fly under world gravity and their applied force and jump
+// straight from one predicted impact to the next, springs are not simulated
+class event_driven : public simulation {
+  event_system m_system;
+  std::vector<glm::vec3> m_particle_start;
+  void build();
+  void write_back();
+public:
+  event_driven(world_body* world);
+  void reset() override;
+  void evaluate(double time) override;
+  void start() override;
+  void end() override;
+  const event_system& get_system() const { return m_system; }
+};
+
+// normal modes of every particle and network spring in a world
+// the springs are linearised about the starting positions and the modes
+// found once on start(), after which evaluate() sums them at the time
+// asked for, in the spirit of spp's closed form oscillator. particles move
+// under world gravity and their applied force, planes, collisions and
+// springs without ends are not simulated
+class modal : public simulation {
+  spring_modes m_modes;
+  std::vector<glm::vec3> m_positions;
+  std::vector<glm::vec3> m_particle_start;
+  std::vector<float> m_spring_extension;
+  std::vector<float> m_spring_rotation;
+  std::vector<glm::vec3> m_spring_position;
+  // particles each spring joins, a < 0 for springs left out
+  struct spring_ends {
+    int a;
+    int b;
+    glm::vec3 anchor;
+  };
+  std::vector<spring_ends> m_spring_ends;
+  // returns false when there are too many particles for the eigen solve
+  bool build();
+  void write_back();
+public:
+  modal(world_body* world);
+  void reset() override;
+  void evaluate(double time) override;
+  void start() override;
+  void end() override;
+  const spring_modes& get_modes() const { return m_modes; }
+};
+
+// kepler orbits of every particle about a heavy body at the world's
+// position, of the world's central mass under its gravitational constant
+// each particle starts moving at its u_velocity across the line to the
+// centre, anticlockwise about z. orbits are solved in closed form, so any
+// time is reached directly however many particles there are. planes,
+// springs, collisions and the pull of the particles on each other are not
+// simulated
+class orbital : public simulation {
+  kepler_orbits m_orbits;
+  vec3_array m_positions;
+  std::vector<glm::vec3> m_particle_start;
+  void build();
+public:
+  orbital(world_body* world);
+  void reset() override;
+  void evaluate(double time) override;
+  void start() override;
+  void end() override;
+  const kepler_orbits& get_orbits() const { return m_orbits; }
+};
+
+// smoothed particle hydrodynamics of every fluid in a world
+// each fluid body fills its block with particles, the planes hold them in
+// and the world's gravity pulls them down. the kernel settings of the
+// first fluid apply to all of them. steps are cut to the fluid's stable
+// step, so they follow the speed of sound rather than the clock
+class hydrodynamic : public simulation {
+  sph_fluid m_fluid;
+  // whole steps m_fluid has been taken
+  unsigned long long m_fluid_steps;
+  // stable step at the last tick, updated once a tick as it scans every
+  // particle
+  float m_stable_step;
+  // first particle of each fluid body, and an end marker
+  std::vector<size_t> m_fluid_start;
+  void build();
+  // sample the particles into the fluid bodies
+  void write_back();
+public:
+  hydrodynamic(world_body* world);
+  void reset() override;
+  void evaluate(double time) override;
+  void start() override;
+  void end() override;
+  unsigned int get_substeps() const override;
+  const sph_fluid& get_fluid() const { return m_fluid; }
+};
 
 #endif // !SIMULATION_H
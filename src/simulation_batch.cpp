@@ -0,0 +1,85 @@
+#include "simulation_batch.hpp"
+#include "body.hpp"
+
+bool simulation_batch::add(world_body* world) {
+  simulation* sim = world->get_simulation();
+  if (!sim)
+    return false;
+  // the type is only looked up here, never per update
+  if (pp* s = dynamic_cast<pp*>(sim)) {
+    m_pp.push_back(s->get_plan());
+    m_pp_scale.push_back(world->time_scale);
+    m_pp_particles.push_back(s->get_particle());
+    pp_position.push_back(s->get_particle()->position);
+    return true;
+  }
+  if (spp* s = dynamic_cast<spp*>(sim)) {
+    m_spp.push_back(s->get_plan());
+    m_spp_scale.push_back(world->time_scale);
+    m_spp_particles.push_back(s->get_particle());
+    m_spp_springs.push_back(s->get_spring());
+    spp_position.push_back(s->get_particle()->position);
+    spp_extension.push_back(s->get_spring()->extension);
+    return true;
+  }
+  if (ppp* s = dynamic_cast<ppp*>(sim)) {
+    m_ppp.push_back(s->get_plan());
+    m_ppp_scale.push_back(world->time_scale);
+    m_ppp_particles1.push_back(s->get_particle1());
+    m_ppp_particles2.push_back(s->get_particle2());
+    ppp_position1.push_back(s->get_particle1()->position);
+    ppp_position2.push_back(s->get_particle2()->position);
+    return true;
+  }
+  return false;
+}
+
+void simulation_batch::clear() {
+  m_pp.clear();
+  m_pp_scale.clear();
+  m_spp.clear();
+  m_spp_scale.clear();
+  m_ppp.clear();
+  m_ppp_scale.clear();
+  m_pp_particles.clear();
+  m_spp_particles.clear();
+  m_spp_springs.clear();
+  m_ppp_particles1.clear();
+  m_ppp_particles2.clear();
+  pp_position.clear();
+  spp_position.clear();
+  spp_extension.clear();
+  ppp_position1.clear();
+  ppp_position2.clear();
+  clock.reset();
+}
+
+void simulation_batch::evaluate(double time) {
+  // scaled as simulation::get_time() does, so a batched instance lands
+  // exactly where its own evaluate() would
+  const size_t n_pp = m_pp.size();
+  for (size_t i = 0; i < n_pp; i++)
+    pp_position[i] = m_pp[i].position(time*m_pp_scale[i]);
+  const size_t n_spp = m_spp.size();
+  for (size_t i = 0; i < n_spp; i++) {
+    double t = time*m_spp_scale[i];
+    spp_position[i] = m_spp[i].position(t);
+    spp_extension[i] = m_spp[i].extension(t);
+  }
+  const size_t n_ppp = m_ppp.size();
+  for (size_t i = 0; i < n_ppp; i++)
+    m_ppp[i].positions(time*m_ppp_scale[i], ppp_position1[i], ppp_position2[i]);
+}
+
+void simulation_batch::write_back() const {
+  for (size_t i = 0; i < m_pp.size(); i++)
+    m_pp_particles[i]->position = pp_position[i];
+  for (size_t i = 0; i < m_spp.size(); i++) {
+    m_spp_particles[i]->position = spp_position[i];
+    m_spp_springs[i]->extension = spp_extension[i];
+  }
+  for (size_t i = 0; i < m_ppp.size(); i++) {
+    m_ppp_particles1[i]->position = ppp_position1[i];
+    m_ppp_particles2[i]->position = ppp_position2[i];
+  }
+}
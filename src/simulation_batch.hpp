@@ -0,0 +1,63 @@
+#ifndef SIMULATION_BATCH_H
+#define SIMULATION_BATCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "sim_clock.hpp"
+#include "simulation.hpp"
+
+class world_body;
+class particle_body;
+class spring_body;
+
+// many closed form simulations advanced together on one clock
+// each started pp, spp or ppp simulation is copied into the arrays of its
+// type, so update() is one loop over every pp plan, then every spp, then
+// every ppp, with the plan evaluated inline rather than through a virtual
+// evaluate() per simulation. results land in the position arrays, entry i
+// belonging to the i'th instance of that type, and write_back() copies
+// them into the bodies when something needs to draw or record them
+class simulation_batch {
+  // plans and time scales, one entry per instance of each type
+  std::vector<pp_plan> m_pp;
+  std::vector<float> m_pp_scale;
+  std::vector<spp_plan> m_spp;
+  std::vector<float> m_spp_scale;
+  std::vector<ppp_plan> m_ppp;
+  std::vector<float> m_ppp_scale;
+  // bodies written by write_back()
+  std::vector<particle_body*> m_pp_particles;
+  std::vector<particle_body*> m_spp_particles;
+  std::vector<spring_body*> m_spp_springs;
+  std::vector<particle_body*> m_ppp_particles1;
+  std::vector<particle_body*> m_ppp_particles2;
+public:
+  sim_clock clock;
+  std::vector<glm::vec3> pp_position;
+  std::vector<glm::vec3> spp_position;
+  std::vector<float> spp_extension;
+  std::vector<glm::vec3> ppp_position1;
+  std::vector<glm::vec3> ppp_position2;
+
+  // add a world whose closed form simulation has been started, returns
+  // false and adds nothing for stepped solvers or a world without one
+  bool add(world_body* world);
+  void clear();
+  size_t size() const { return m_pp.size() + m_spp.size() + m_ppp.size(); }
+  size_t get_pp_count() const { return m_pp.size(); }
+  size_t get_spp_count() const { return m_spp.size(); }
+  size_t get_ppp_count() const { return m_ppp.size(); }
+  // every instance to its state at clock time 'time'
+  void evaluate(double time);
+  // frame step, every tick taken by the clock is covered by one evaluate()
+  void update(float delta) { clock.advance(delta); evaluate(clock.get_time()); }
+  // offline run of 'ticks' fixed ticks
+  void run(unsigned int ticks) { clock.step(ticks); evaluate(clock.get_time()); }
+  // copy the last evaluated state into the bodies
+  void write_back() const;
+};
+
+#endif // !SIMULATION_BATCH_H
@@ -0,0 +1,193 @@
+#include "sparse.hpp"
+#include <algorithm>
+#include <cmath>
+#include "thread_pool.hpp"
+
+bool block3::inverse(block3& out) const {
+  const float* a = m;
+  float c0 = a[4] * a[8] - a[5] * a[7];
+  float c1 = a[5] * a[6] - a[3] * a[8];
+  float c2 = a[3] * a[7] - a[4] * a[6];
+  float det = a[0] * c0 + a[1] * c1 + a[2] * c2;
+  if (det == 0.0f || !std::isfinite(det))
+    return false;
+  float s = 1.0f / det;
+  out.m[0] = c0 * s;
+  out.m[1] = (a[2] * a[7] - a[1] * a[8]) * s;
+  out.m[2] = (a[1] * a[5] - a[2] * a[4]) * s;
+  out.m[3] = c1 * s;
+  out.m[4] = (a[0] * a[8] - a[2] * a[6]) * s;
+  out.m[5] = (a[2] * a[3] - a[0] * a[5]) * s;
+  out.m[6] = c2 * s;
+  out.m[7] = (a[1] * a[6] - a[0] * a[7]) * s;
+  out.m[8] = (a[0] * a[4] - a[1] * a[3]) * s;
+  return true;
+}
+
+void block_sparse_matrix::build_pattern(size_t n, const std::vector<std::pair<int, int>>& pairs) {
+  std::vector<std::vector<unsigned int>> neighbours(n);
+  for (size_t i = 0; i < n; i++)
+    neighbours[i].push_back((unsigned int)i);
+  for (const std::pair<int, int>& p : pairs) {
+    neighbours[p.first].push_back(p.second);
+    neighbours[p.second].push_back(p.first);
+  }
+  row_start.assign(n + 1, 0);
+  column.clear();
+  diagonal.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    std::vector<unsigned int>& row = neighbours[i];
+    std::sort(row.begin(), row.end());
+    row.erase(std::unique(row.begin(), row.end()), row.end());
+    for (unsigned int j : row) {
+      if (j == i)
+        diagonal[i] = (unsigned int)column.size();
+      column.push_back(j);
+    }
+    row_start[i + 1] = (unsigned int)column.size();
+  }
+  blocks.resize(column.size());
+}
+
+int block_sparse_matrix::find(size_t i, size_t j) const {
+  std::vector<unsigned int>::const_iterator begin = column.begin() + row_start[i];
+  std::vector<unsigned int>::const_iterator end = column.begin() + row_start[i + 1];
+  std::vector<unsigned int>::const_iterator it = std::lower_bound(begin, end, (unsigned int)j);
+  return it != end && *it == j ? (int)(it - column.begin()) : -1;
+}
+
+void block_sparse_matrix::set_zero() {
+  for (block3& b : blocks)
+    b.set_zero();
+}
+
+void block_sparse_matrix::multiply(const float* x, float* y, size_t first, size_t end) const {
+  for (size_t i = first; i < end; i++) {
+    float* yi = y + 3 * i;
+    yi[0] = yi[1] = yi[2] = 0.0f;
+    for (unsigned int k = row_start[i]; k < row_start[i + 1]; k++)
+      blocks[k].multiply_add(x + 3 * column[k], yi);
+  }
+}
+
+template <typename F> void conjugate_gradient::for_chunks(size_t rows, F fn) {
+  size_t chunks = (rows + chunk_rows - 1) / chunk_rows;
+  auto job = [&](size_t c) { fn(c * chunk_rows, std::min(rows, (c + 1) * chunk_rows), c); };
+  if (pool && chunks > 1) {
+    pool->run(chunks, job);
+  } else {
+    for (size_t c = 0; c < chunks; c++)
+      job(c);
+  }
+}
+
+bool conjugate_gradient::solve(const block_sparse_matrix& A, const std::vector<float>& b, std::vector<float>& x) {
+  const size_t rows = A.rows();
+  const size_t n = 3 * rows;
+  const size_t chunks = (rows + chunk_rows - 1) / chunk_rows;
+  x.resize(n, 0.0f);
+  m_r.resize(n);
+  m_z.resize(n);
+  m_p.resize(n);
+  m_q.resize(n);
+  // up to three partial sums per chunk
+  m_partial.resize(3 * chunks);
+  m_inverse_diagonal.resize(rows);
+  iterations = 0;
+  residual = 0.0f;
+
+  // block jacobi preconditioner, plain jacobi for a singular block
+  for (size_t i = 0; i < rows; i++) {
+    const block3& d = A.blocks[A.diagonal[i]];
+    if (!d.inverse(m_inverse_diagonal[i])) {
+      m_inverse_diagonal[i].set_zero();
+      for (int k = 0; k < 3; k++)
+        m_inverse_diagonal[i].m[4 * k] = d.m[4 * k] != 0.0f ? 1.0f / d.m[4 * k] : 1.0f;
+    }
+  }
+  auto precondition = [&](size_t first, size_t end) {
+    for (size_t i = first; i < end; i++) {
+      float* zi = &m_z[3 * i];
+      zi[0] = zi[1] = zi[2] = 0.0f;
+      m_inverse_diagonal[i].multiply_add(&m_r[3 * i], zi);
+    }
+  };
+  auto total = [&](size_t which) {
+    double sum = 0.0;
+    for (size_t c = 0; c < chunks; c++)
+      sum += m_partial[3 * c + which];
+    return sum;
+  };
+
+  // r = b - A*x, z = M^-1*r, p = z
+  for_chunks(rows, [&](size_t first, size_t end, size_t c) {
+    A.multiply(x.data(), m_r.data(), first, end);
+    double bb = 0.0, rr = 0.0, rz = 0.0;
+    for (size_t k = 3 * first; k < 3 * end; k++) {
+      m_r[k] = b[k] - m_r[k];
+      bb += (double)b[k] * b[k];
+      rr += (double)m_r[k] * m_r[k];
+    }
+    precondition(first, end);
+    for (size_t k = 3 * first; k < 3 * end; k++) {
+      m_p[k] = m_z[k];
+      rz += (double)m_r[k] * m_z[k];
+    }
+    m_partial[3 * c] = bb;
+    m_partial[3 * c + 1] = rz;
+    m_partial[3 * c + 2] = rr;
+  });
+  const double b_norm = std::sqrt(total(0));
+  double rz = total(1);
+  if (b_norm == 0.0) {
+    std::fill(x.begin(), x.end(), 0.0f);
+    return true;
+  }
+  const double target = tolerance * b_norm;
+  residual = (float)(std::sqrt(total(2)) / b_norm);
+  // the starting guess may already be close enough
+  if (std::sqrt(total(2)) <= target)
+    return true;
+
+  while (iterations < max_iterations) {
+    // q = A*p
+    for_chunks(rows, [&](size_t first, size_t end, size_t c) {
+      A.multiply(m_p.data(), m_q.data(), first, end);
+      double pq = 0.0;
+      for (size_t k = 3 * first; k < 3 * end; k++)
+        pq += (double)m_p[k] * m_q[k];
+      m_partial[3 * c] = pq;
+    });
+    double pq = total(0);
+    if (pq <= 0.0)
+      break;
+    const float alpha = (float)(rz / pq);
+    // step x and r, then precondition the new residual
+    for_chunks(rows, [&](size_t first, size_t end, size_t c) {
+      double rr = 0.0, rz_next = 0.0;
+      for (size_t k = 3 * first; k < 3 * end; k++) {
+        x[k] += alpha * m_p[k];
+        m_r[k] -= alpha * m_q[k];
+        rr += (double)m_r[k] * m_r[k];
+      }
+      precondition(first, end);
+      for (size_t k = 3 * first; k < 3 * end; k++)
+        rz_next += (double)m_r[k] * m_z[k];
+      m_partial[3 * c] = rr;
+      m_partial[3 * c + 1] = rz_next;
+    });
+    iterations++;
+    double r_norm = std::sqrt(total(0));
+    residual = (float)(r_norm / b_norm);
+    if (r_norm <= target)
+      return true;
+    double rz_next = total(1);
+    const float beta = (float)(rz_next / rz);
+    rz = rz_next;
+    for_chunks(rows, [&](size_t first, size_t end, size_t) {
+      for (size_t k = 3 * first; k < 3 * end; k++)
+        m_p[k] = m_z[k] + beta * m_p[k];
+    });
+  }
+  return false;
+}
@@ -0,0 +1,77 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class thread_pool;
+
+// 3x3 block, row major
+struct block3 {
+  float m[9];
+  void set_zero() { for (float& v : m) v = 0.0f; }
+  // y += this*x
+  void multiply_add(const float* x, float* y) const {
+    y[0] += m[0] * x[0] + m[1] * x[1] + m[2] * x[2];
+    y[1] += m[3] * x[0] + m[4] * x[1] + m[5] * x[2];
+    y[2] += m[6] * x[0] + m[7] * x[1] + m[8] * x[2];
+  }
+  // inverse, false and unchanged output when singular
+  bool inverse(block3& out) const;
+};
+
+// square matrix of 3x3 blocks in compressed rows
+// one block row per particle, a vector is 3 floats per particle laid out
+// x, y, z. the pattern is built once from the coupled pairs and the
+// values rewritten in place every step
+class block_sparse_matrix {
+public:
+  std::vector<unsigned int> row_start;
+  std::vector<unsigned int> column;
+  std::vector<block3> blocks;
+  // slot of each row's diagonal block
+  std::vector<unsigned int> diagonal;
+
+  size_t rows() const { return row_start.empty() ? 0 : row_start.size() - 1; }
+  // pattern with the diagonal and both (i, j) and (j, i) for every pair
+  void build_pattern(size_t n, const std::vector<std::pair<int, int>>& pairs);
+  // slot of block (i, j), -1 outside the pattern
+  int find(size_t i, size_t j) const;
+  void set_zero();
+  // y = A*x for block rows [first, end)
+  void multiply(const float* x, float* y, size_t first, size_t end) const;
+};
+
+// preconditioned conjugate gradient for symmetric positive definite
+// block sparse systems, preconditioned by the inverse diagonal blocks
+// rows are split into chunks handed to the pool, when given, for the
+// product, the vector updates and the dot products, whose partial sums
+// are added in chunk order so a solve gives the same result however many
+// threads run it
+class conjugate_gradient {
+  std::vector<float> m_r, m_z, m_p, m_q;
+  std::vector<block3> m_inverse_diagonal;
+  std::vector<double> m_partial;
+  // call fn(first_row, end_row, chunk) for every chunk of rows
+  template <typename F> void for_chunks(size_t rows, F fn);
+
+public:
+  // rows per pool job
+  static constexpr size_t chunk_rows = 1024;
+
+  // stop once the residual norm falls below tolerance times the norm of b
+  float tolerance;
+  unsigned int max_iterations;
+  thread_pool* pool;
+  // statistics of the last solve()
+  unsigned int iterations;
+  float residual;
+
+  conjugate_gradient() : tolerance(1e-5f), max_iterations(200), pool(NULL), iterations(0), residual(0.0f) {}
+  // solve A*x = b, x holds the starting guess and is resized to match b,
+  // returns false when max_iterations ran out first
+  bool solve(const block_sparse_matrix& A, const std::vector<float>& b, std::vector<float>& x);
+};
+
+#endif // !SPARSE_H
@@ -0,0 +1,256 @@
+#include "sph.hpp"
+#include <algorithm>
+#include <cmath>
+#include "thread_pool.hpp"
+
+int sph_fluid::cell(float v) const {
+  return (int)std::floor(v / smoothing_length);
+}
+
+unsigned int sph_fluid::bucket(int ix, int iy, int iz) const {
+  if (m_dense)
+    return ((unsigned int)(iz - m_low[2]) * m_cells[1] + (iy - m_low[1])) * m_cells[0] + (ix - m_low[0]);
+  // spread neighbouring cells across the table, as the collision grid does
+  unsigned int h = (unsigned int)ix * 73856093u ^ (unsigned int)iy * 19349663u ^ (unsigned int)iz * 83492791u;
+  return h & (unsigned int)(m_bucket_start.size() - 2);
+}
+
+template <typename F> void sph_fluid::for_chunks(F fn) {
+  const size_t n = size();
+  const size_t chunks = (n + chunk_particles - 1) / chunk_particles;
+  auto job = [&](size_t c) { fn(c * chunk_particles, std::min(n, (c + 1) * chunk_particles), c); };
+  if (pool && chunks > 1) {
+    pool->run(chunks, job);
+  } else {
+    for (size_t c = 0; c < chunks; c++)
+      job(c);
+  }
+}
+
+size_t sph_fluid::add_block(glm::vec3 lo, glm::vec3 hi) {
+  const float spacing = smoothing_length * 0.5f;
+  // mass that puts a particle inside the packing at rest density,
+  // from the poly6 sum over the lattice points within reach
+  const float h2 = smoothing_length * smoothing_length;
+  const float poly6 = 315.0f / (64.0f * (float)M_PI * std::pow(smoothing_length, 9.0f));
+  float weight = 0.0f;
+  for (int x = -2; x <= 2; x++)
+    for (int y = -2; y <= 2; y++)
+      for (int z = -2; z <= 2; z++) {
+        float r2 = (x * x + y * y + z * z) * spacing * spacing;
+        if (r2 < h2)
+          weight += poly6 * (h2 - r2) * (h2 - r2) * (h2 - r2);
+      }
+  particle_mass = rest_density / weight;
+  // the kernels take every particle to weigh the same
+  std::fill(particles.mass.begin(), particles.mass.end(), particle_mass);
+  std::fill(particles.inv_mass.begin(), particles.inv_mass.end(), 1.0f / particle_mass);
+
+  size_t added = 0;
+  for (float x = lo.x + spacing * 0.5f; x < hi.x; x += spacing)
+    for (float y = lo.y + spacing * 0.5f; y < hi.y; y += spacing)
+      for (float z = lo.z + spacing * 0.5f; z < hi.z; z += spacing) {
+        particles.add(glm::vec3(x, y, z), glm::vec3(0.0f), particle_mass, spacing * 0.5f);
+        added++;
+      }
+  return added;
+}
+
+void sph_fluid::build_grid() {
+  const size_t n = size();
+  int high[3];
+  for (int a = 0; a < 3; a++) {
+    const std::vector<float>& v = a == 0 ? particles.position.x : a == 1 ? particles.position.y : particles.position.z;
+    std::pair<std::vector<float>::const_iterator, std::vector<float>::const_iterator> range =
+        std::minmax_element(v.begin(), v.end());
+    // one spare cell either side so every neighbour cell is numbered
+    m_low[a] = cell(*range.first) - 1;
+    high[a] = cell(*range.second) + 1;
+    m_cells[a] = high[a] - m_low[a] + 1;
+  }
+  double cells = (double)m_cells[0] * m_cells[1] * m_cells[2];
+  m_dense = cells <= 8.0 * n + 4096.0;
+  size_t table = 64;
+  if (m_dense) {
+    table = (size_t)cells;
+  } else {
+    // power of two table with roughly two buckets per particle
+    while (table < 2 * n)
+      table <<= 1;
+  }
+  m_bucket_start.assign(table + 1, 0);
+  m_bucket.resize(n);
+  m_order.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    unsigned int b = bucket(cell(particles.position.x[i]), cell(particles.position.y[i]), cell(particles.position.z[i]));
+    m_bucket[i] = b;
+    m_bucket_start[b + 1]++;
+  }
+  for (size_t b = 0; b < table; b++)
+    m_bucket_start[b + 1] += m_bucket_start[b];
+  std::vector<unsigned int> fill(m_bucket_start.begin(), m_bucket_start.end() - 1);
+  for (size_t i = 0; i < n; i++)
+    m_order[fill[m_bucket[i]]++] = (unsigned int)i;
+
+  // copy in bucket order so a bucket's particles sit side by side
+  m_x.resize(n);
+  m_y.resize(n);
+  m_z.resize(n);
+  m_vx.resize(n);
+  m_vy.resize(n);
+  m_vz.resize(n);
+  m_density.resize(n);
+  m_pressure.resize(n);
+  for (size_t k = 0; k < n; k++) {
+    unsigned int i = m_order[k];
+    m_x[k] = particles.position.x[i];
+    m_y[k] = particles.position.y[i];
+    m_z[k] = particles.position.z[i];
+    m_vx[k] = particles.velocity.x[i];
+    m_vy[k] = particles.velocity.y[i];
+    m_vz[k] = particles.velocity.z[i];
+  }
+}
+
+int sph_fluid::neighbour_runs(int cx, int cy, int cz, unsigned int* begin, unsigned int* end) const {
+  int count = 0;
+  if (m_dense) {
+    // the three cells along x sit side by side
+    for (int dz = -1; dz <= 1; dz++)
+      for (int dy = -1; dy <= 1; dy++) {
+        unsigned int b = bucket(cx - 1, cy + dy, cz + dz);
+        begin[count] = m_bucket_start[b];
+        end[count++] = m_bucket_start[b + 3];
+      }
+    return count;
+  }
+  unsigned int buckets[27];
+  for (int dx = -1; dx <= 1; dx++)
+    for (int dy = -1; dy <= 1; dy++)
+      for (int dz = -1; dz <= 1; dz++)
+        buckets[count++] = bucket(cx + dx, cy + dy, cz + dz);
+  // cells sharing a bucket must only be searched once, the distance test
+  // then drops the particles of the unrelated cells
+  std::sort(buckets, buckets + count);
+  count = (int)(std::unique(buckets, buckets + count) - buckets);
+  for (int b = 0; b < count; b++) {
+    begin[b] = m_bucket_start[buckets[b]];
+    end[b] = m_bucket_start[buckets[b] + 1];
+  }
+  return count;
+}
+
+size_t sph_fluid::compute_density(size_t first, size_t end) {
+  const float h2 = smoothing_length * smoothing_length;
+  const float poly6 = particle_mass * 315.0f / (64.0f * (float)M_PI * std::pow(smoothing_length, 9.0f));
+  unsigned int run_begin[27], run_end[27];
+  int count = 0;
+  int cx = 0, cy = 0, cz = 0;
+  size_t found = 0;
+  for (size_t k = first; k < end; k++) {
+    // runs of particles from one cell share their neighbour buckets
+    const int x_cell = cell(m_x[k]), y_cell = cell(m_y[k]), z_cell = cell(m_z[k]);
+    if (k == first || x_cell != cx || y_cell != cy || z_cell != cz) {
+      cx = x_cell;
+      cy = y_cell;
+      cz = z_cell;
+      count = neighbour_runs(cx, cy, cz, run_begin, run_end);
+    }
+    const float x = m_x[k], y = m_y[k], z = m_z[k];
+    float sum = 0.0f;
+    for (int r = 0; r < count; r++) {
+      for (unsigned int j = run_begin[r]; j < run_end[r]; j++) {
+        float dx = m_x[j] - x, dy = m_y[j] - y, dz = m_z[j] - z;
+        float r2 = dx * dx + dy * dy + dz * dz;
+        float q = std::max(h2 - r2, 0.0f);
+        sum += q * q * q;
+        found += r2 < h2;
+      }
+    }
+    m_density[k] = sum * poly6;
+    m_pressure[k] = std::max(stiffness * (m_density[k] - rest_density), 0.0f);
+  }
+  return found;
+}
+
+void sph_fluid::compute_forces(size_t first, size_t end) {
+  const float h = smoothing_length;
+  const float h2 = h * h;
+  const float h6 = h2 * h2 * h2;
+  // spiky gradient and viscosity laplacian share the 45/(pi h^6) factor
+  const float spiky = particle_mass * 45.0f / ((float)M_PI * h6);
+  const float laplacian = viscosity * particle_mass * 45.0f / ((float)M_PI * h6);
+  unsigned int run_begin[27], run_end[27];
+  int count = 0;
+  int cx = 0, cy = 0, cz = 0;
+  for (size_t k = first; k < end; k++) {
+    const int x_cell = cell(m_x[k]), y_cell = cell(m_y[k]), z_cell = cell(m_z[k]);
+    if (k == first || x_cell != cx || y_cell != cy || z_cell != cz) {
+      cx = x_cell;
+      cy = y_cell;
+      cz = z_cell;
+      count = neighbour_runs(cx, cy, cz, run_begin, run_end);
+    }
+    const float x = m_x[k], y = m_y[k], z = m_z[k];
+    const float vx = m_vx[k], vy = m_vy[k], vz = m_vz[k];
+    const float inv_density = 1.0f / m_density[k];
+    const float p_term = m_pressure[k] * inv_density * inv_density;
+    float ax = 0.0f, ay = 0.0f, az = 0.0f;
+    for (int r = 0; r < count; r++) {
+      for (unsigned int j = run_begin[r]; j < run_end[r]; j++) {
+        float dx = x - m_x[j], dy = y - m_y[j], dz = z - m_z[j];
+        float r2 = dx * dx + dy * dy + dz * dz;
+        if (r2 >= h2 || r2 <= 0.0f)
+          continue;
+        float r = std::sqrt(r2);
+        float w = h - r;
+        float inv_j = 1.0f / m_density[j];
+        // symmetric pressure term pushes the pair apart along dx
+        float push = spiky * (p_term + m_pressure[j] * inv_j * inv_j) * w * w / r;
+        // viscosity pulls the velocities together
+        float drag = laplacian * w * inv_j * inv_density;
+        ax += push * dx + drag * (m_vx[j] - vx);
+        ay += push * dy + drag * (m_vy[j] - vy);
+        az += push * dz + drag * (m_vz[j] - vz);
+      }
+    }
+    unsigned int i = m_order[k];
+    m_acceleration.x[i] = ax + gravity.x;
+    m_acceleration.y[i] = ay + gravity.y;
+    m_acceleration.z[i] = az + gravity.z;
+    density[i] = m_density[k];
+  }
+}
+
+void sph_fluid::step(float dt) {
+  const size_t n = size();
+  if (n == 0)
+    return;
+  build_grid();
+  m_acceleration.resize(n);
+  density.resize(n);
+  // the grid and the sorted copy serve both passes
+  const size_t chunks = (n + chunk_particles - 1) / chunk_particles;
+  std::vector<size_t> found(chunks, 0);
+  for_chunks([&](size_t first, size_t end, size_t c) { found[c] = compute_density(first, end); });
+  neighbours = 0;
+  for (size_t c = 0; c < chunks; c++)
+    neighbours += found[c];
+  for_chunks([&](size_t first, size_t end, size_t) { compute_forces(first, end); });
+  particles.integrate(m_acceleration, dt);
+  for (const contact& c : contacts)
+    particles.collide_plane(c.point, c.normal, restitution);
+}
+
+float sph_fluid::stable_step() const {
+  float fastest = 0.0f;
+  for (size_t i = 0; i < size(); i++) {
+    glm::vec3 v = particles.velocity.get(i);
+    fastest = std::max(fastest, glm::dot(v, v));
+  }
+  // courant limit on sound and flow, and the viscous diffusion limit
+  float limit = 0.4f * smoothing_length / (std::sqrt(stiffness) + std::sqrt(fastest));
+  if (viscosity > 0.0f)
+    limit = std::min(limit, 0.125f * smoothing_length * smoothing_length * rest_density / viscosity);
+  return limit;
+}
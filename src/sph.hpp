@@ -0,0 +1,100 @@
+#ifndef SPH_H
+#define SPH_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "particle_store.hpp"
+
+class thread_pool;
+
+// smoothed particle hydrodynamics fluid
+// every particle carries the same mass, its density is the kernel weighted
+// sum of the masses around it and its pressure grows linearly with the
+// density over rest. each step bins the particles once into a uniform
+// grid one smoothing length wide, copying them in cell order, and both
+// the density and the force pass search the 27 cells around a particle
+// in that copy. the passes only write to their own particle, so they are
+// split into chunks across the pool when given
+// cells are numbered row by row across the fluid's bounds, so the three
+// cells of a row are one run of the copy, unless the fluid has spread so
+// far that the rows would outnumber the particles, when the cells are
+// hashed into buckets instead
+class sph_fluid {
+  // neighbour grid, first sorted particle of each bucket and an end marker
+  std::vector<unsigned int> m_bucket_start;
+  std::vector<unsigned int> m_bucket;
+  // lowest cell and cells across the bounds, m_dense false when hashing
+  int m_low[3];
+  int m_cells[3];
+  bool m_dense;
+  // particle indices in bucket order
+  std::vector<unsigned int> m_order;
+  // state copied in bucket order for the passes
+  std::vector<float> m_x, m_y, m_z;
+  std::vector<float> m_vx, m_vy, m_vz;
+  std::vector<float> m_density, m_pressure;
+  // acceleration in particle order
+  vec3_array m_acceleration;
+
+  int cell(float v) const;
+  unsigned int bucket(int ix, int iy, int iz) const;
+  // sorted particle runs [begin, end) covering the 27 cells around a
+  // cell, returns how many
+  int neighbour_runs(int cx, int cy, int cz, unsigned int* begin, unsigned int* end) const;
+  void build_grid();
+  // density and pressure of sorted particles [first, end), returns the
+  // neighbours found
+  size_t compute_density(size_t first, size_t end);
+  void compute_forces(size_t first, size_t end);
+  // call fn(first, end, chunk) for every chunk of sorted particles
+  template <typename F> void for_chunks(F fn);
+
+public:
+  // plane the fluid is kept on the positive side of
+  struct contact {
+    glm::vec3 point;
+    glm::vec3 normal;
+  };
+  // sorted particles per pool job
+  static constexpr size_t chunk_particles = 4096;
+
+  particle_store particles;
+  // density of each particle at the start of the last step()
+  std::vector<float> density;
+  std::vector<contact> contacts;
+  glm::vec3 gravity;
+  // kernel radius, particles further apart do not interact
+  float smoothing_length;
+  float rest_density;
+  // pressure per unit of density over rest, the speed of sound squared
+  float stiffness;
+  float viscosity;
+  float restitution;
+  // mass of every particle, set by add_block()
+  float particle_mass;
+  thread_pool* pool;
+  // neighbours found within the smoothing length by the last step(),
+  // counting each particle itself
+  size_t neighbours;
+
+  sph_fluid()
+      : m_low(), m_cells(), m_dense(false), gravity(0.0f, -9.8f, 0.0f), smoothing_length(0.1f),
+        rest_density(1000.0f), stiffness(1000.0f), viscosity(1.0f), restitution(0.0f), particle_mass(1.0f),
+        pool(NULL), neighbours(0) {}
+  // fill the box from 'lo' to 'hi' with particles half a smoothing length
+  // apart, at rest. the particle mass is chosen so the packing sits at the
+  // rest density. returns the number of particles added
+  size_t add_block(glm::vec3 lo, glm::vec3 hi);
+  size_t size() const { return particles.size(); }
+  // advance by dt, semi-implicit euler on the pressure, viscous and
+  // gravity forces, then push particles out of the planes
+  void step(float dt);
+  // longest step the speed of sound, the fastest particle and the
+  // viscosity allow
+  float stable_step() const;
+};
+
+#endif // !SPH_H
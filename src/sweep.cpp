@@ -0,0 +1,231 @@
+#include "sweep.hpp"
+#include <algorithm>
+#include "closed_form.hpp"
+#include "simd_math.hpp"
+#include "thread_pool.hpp"
+
+// cases per pool job, a multiple of every simd width
+static const size_t block_size = 4096;
+
+template <typename T> std::vector<T> linspace(T from, T to, size_t count) {
+  std::vector<T> values(count);
+  for (size_t i = 0; i < count; i++)
+    values[i] = count > 1 ? from + (to - from) * i / (count - 1) : from;
+  return values;
+}
+
+template <typename T> void fill_grid(const std::vector<std::vector<T>*>& columns, const std::vector<std::vector<T> >& axes) {
+  size_t total = 1;
+  for (const std::vector<T>& axis : axes)
+    total *= axis.size();
+  for (size_t c = 0; c < columns.size() && c < axes.size(); c++) {
+    std::vector<T>& column = *columns[c];
+    column.resize(total);
+    // each axis repeats every value for the combined size of the axes before it
+    size_t stride = 1;
+    for (size_t a = 0; a < c; a++)
+      stride *= axes[a].size();
+    for (size_t i = 0; i < total; i++)
+      column[i] = axes[c][(i / stride) % axes[c].size()];
+  }
+}
+
+template std::vector<float> linspace(float, float, size_t);
+template std::vector<double> linspace(double, double, size_t);
+template void fill_grid(const std::vector<std::vector<float>*>&, const std::vector<std::vector<float> >&);
+template void fill_grid(const std::vector<std::vector<double>*>&, const std::vector<std::vector<double> >&);
+
+// split [0, n) into blocks and run 'kernel' every 'step' cases of each
+template <typename F> static void run_blocks(size_t n, thread_pool* pool, size_t step, F kernel) {
+  size_t blocks = (n + block_size - 1) / block_size;
+  auto job = [&](size_t b) {
+    size_t end = std::min(n, (b + 1) * block_size);
+    for (size_t i = b * block_size; i < end; i += step)
+      kernel(i);
+  };
+  if (pool)
+    pool->run(blocks, job);
+  else
+    for (size_t b = 0; b < blocks; b++)
+      job(b);
+}
+
+// lane loads and stores, the last partial vector is padded with the
+// final entry so padding lanes stay finite
+static inline vfloat load(const std::vector<float>& a, size_t i) {
+  if (i + SIMD_WIDTH <= a.size())
+    return vload(&a[i]);
+  float lanes[SIMD_WIDTH];
+  for (size_t k = 0; k < SIMD_WIDTH; k++)
+    lanes[k] = a[i + k < a.size() ? i + k : a.size() - 1];
+  return vload(lanes);
+}
+
+static inline void store(std::vector<float>& a, size_t i, vfloat v) {
+  if (i + SIMD_WIDTH <= a.size()) {
+    vstore(&a[i], v);
+    return;
+  }
+  float lanes[SIMD_WIDTH];
+  vstore(lanes, v);
+  for (size_t k = 0; i + k < a.size(); k++)
+    a[i + k] = lanes[k];
+}
+
+// particle and plane
+template <typename T> void pp_sweep<T>::resize(size_t n) {
+  mass.resize(n);
+  force.resize(n);
+  u_velocity.resize(n);
+  rotation.resize(n);
+  time.resize(n);
+}
+
+template <typename T> void pp_sweep<T>::run_scalar(thread_pool* pool) {
+  displacement.resize(size());
+  run_blocks(size(), pool, 1, [&](size_t i) {
+    pp_motion<T> m(mass[i], force[i], u_velocity[i], rotation[i], gravity);
+    displacement[i] = m.displacement(time[i]);
+  });
+}
+
+template <> void pp_sweep<float>::run(thread_pool* pool) {
+  displacement.resize(size());
+  const vfloat g = vset(gravity), half = vset(0.5f);
+  run_blocks(size(), pool, SIMD_WIDTH, [&](size_t i) {
+    vfloat m = load(mass, i), t = load(time, i);
+    // (F - mg sin(rotation))/2*m, grouped as in pp::evaluate
+    vfloat a = vmul(vmul(vsub(load(force, i), vmul(vmul(m, g), vsin(load(rotation, i)))), half), m);
+    store(displacement, i, vfmadd(vmul(a, t), t, vmul(load(u_velocity, i), t)));
+  });
+}
+
+template <> void pp_sweep<double>::run(thread_pool* pool) {
+  run_scalar(pool);
+}
+
+template struct pp_sweep<float>;
+template struct pp_sweep<double>;
+
+// spring, particle and plane
+template <typename T> void spp_sweep<T>::resize(size_t n) {
+  mass.resize(n);
+  force.resize(n);
+  u_velocity.resize(n);
+  rotation.resize(n);
+  length.resize(n);
+  extension.resize(n);
+  elasticity.resize(n);
+  time.resize(n);
+}
+
+template <typename T> void spp_sweep<T>::run_scalar(thread_pool* pool) {
+  displacement.resize(size());
+  end_time.resize(size());
+  run_blocks(size(), pool, 1, [&](size_t i) {
+    spp_motion<T> m(mass[i], force[i], u_velocity[i], rotation[i], gravity, length[i], extension[i], elasticity[i]);
+    displacement[i] = m.displacement(time[i]);
+    end_time[i] = m.end_time;
+  });
+}
+
+template <> void spp_sweep<float>::run(thread_pool* pool) {
+  displacement.resize(size());
+  end_time.resize(size());
+  const vfloat g = vset(gravity), half = vset(0.5f);
+  run_blocks(size(), pool, SIMD_WIDTH, [&](size_t i) {
+    vfloat m = load(mass, i), u = load(u_velocity, i), t = load(time, i);
+    vfloat l = load(length, i), e = load(extension, i), k = load(elasticity, i);
+    vfloat drive = vsub(load(force, i), vmul(vmul(m, g), vsin(load(rotation, i))));
+    // simple harmonic motion about n while the spring pushes
+    vfloat n = vmul(vdiv(l, k), vadd(k, drive));
+    vfloat p = vsub(vsub(l, e), n);
+    vfloat z = vsqrt(vdiv(k, vmul(m, l)));
+    vfloat s, c;
+    vsincos(vmul(z, t), s, c);
+    vfloat r = vadd(vfmadd(p, c, vmul(u, s)), n);
+    // release once the spring is back at its natural length
+    vfloat amplitude = vsqrt(vfmadd(p, p, vmul(u, u)));
+    vfloat end = vdiv(vsub(vasin(vdiv(vadd(p, e), amplitude)), vatan(vdiv(p, u))), z);
+    // constant acceleration from the release velocity afterwards
+    vsincos(vmul(z, end), s, c);
+    vfloat v = vmul(z, vsub(vmul(u, c), vmul(p, s)));
+    vfloat a = vdiv(drive, m);
+    vfloat v0 = vsub(v, vmul(end, a));
+    vfloat free = vfmadd(vmul(half, a), vmul(t, t), vmul(v0, t));
+    free = vadd(free, vsub(l, vfmadd(vmul(half, a), vmul(end, end), vmul(end, v0))));
+    store(displacement, i, vselect_lt(end, t, free, r));
+    store(end_time, i, end);
+  });
+}
+
+template <> void spp_sweep<double>::run(thread_pool* pool) {
+  run_scalar(pool);
+}
+
+template struct spp_sweep<float>;
+template struct spp_sweep<double>;
+
+// particle, particle and plane
+template <typename T> void ppp_sweep<T>::resize(size_t n) {
+  mass1.resize(n);
+  mass2.resize(n);
+  u_velocity1.resize(n);
+  u_velocity2.resize(n);
+  distance.resize(n);
+  time.resize(n);
+}
+
+template <typename T> void ppp_sweep<T>::run_scalar(thread_pool* pool) {
+  collision_time.resize(size());
+  v1.resize(size());
+  v2.resize(size());
+  displacement1.resize(size());
+  displacement2.resize(size());
+  run_blocks(size(), pool, 1, [&](size_t i) {
+    ppp_motion<T> m(mass1[i], mass2[i], u_velocity1[i], u_velocity2[i], distance[i], radius1, radius2, restitution);
+    collision_time[i] = m.collision_time;
+    v1[i] = m.v1;
+    v2[i] = m.v2;
+    m.displacement(time[i], displacement1[i], displacement2[i]);
+  });
+}
+
+template <> void ppp_sweep<float>::run(thread_pool* pool) {
+  collision_time.resize(size());
+  v1.resize(size());
+  v2.resize(size());
+  displacement1.resize(size());
+  displacement2.resize(size());
+  const vfloat r1 = vset(radius1), r2 = vset(radius2), e = vset(restitution), half = vset(0.5f);
+  run_blocks(size(), pool, SIMD_WIDTH, [&](size_t i) {
+    vfloat m1 = load(mass1, i), m2 = load(mass2, i);
+    vfloat u1 = load(u_velocity1, i), u2 = load(u_velocity2, i);
+    vfloat d = load(distance, i), t = load(time, i);
+    vfloat closing = vadd(u1, u2);
+    // surfaces meet after covering the gap at the closing speed
+    vfloat ct = vdiv(vdiv(vsub(vsub(vmul(d, r1), r1), r2), r1), closing);
+    vfloat momentum = vsub(vmul(u1, m1), vmul(u2, m2));
+    vfloat total = vadd(m1, m2);
+    vfloat a1 = vdiv(vsub(momentum, vmul(vmul(e, m2), closing)), total);
+    vfloat a2 = vdiv(vadd(momentum, vmul(vmul(e, m1), closing)), total);
+    vfloat start = vmul(d, half);
+    vfloat before1 = vsub(vmul(u1, t), start);
+    vfloat before2 = vsub(start, vmul(u2, t));
+    vfloat after = vsub(t, ct);
+    vfloat after1 = vsub(vfmadd(a1, after, vmul(u1, ct)), start);
+    vfloat after2 = vadd(vsub(vmul(a2, after), vmul(u2, ct)), start);
+    store(collision_time, i, ct);
+    store(v1, i, a1);
+    store(v2, i, a2);
+    store(displacement1, i, vselect_lt(ct, t, after1, before1));
+    store(displacement2, i, vselect_lt(ct, t, after2, before2));
+  });
+}
+
+template <> void ppp_sweep<double>::run(thread_pool* pool) {
+  run_scalar(pool);
+}
+
+template struct ppp_sweep<float>;
+template struct ppp_sweep<double>;
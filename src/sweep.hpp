@@ -0,0 +1,107 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstddef>
+#include <vector>
+
+class thread_pool;
+
+// closed form solutions evaluated over many parameter sets at once
+// each struct holds one array per input and per output, entry i of every
+// array belongs to case i. run() fills the outputs with the same formulas
+// the pp, spp and ppp simulations use, pool threads across blocks of
+// cases. the structs are templated on the scalar type, float runs simd
+// lanes across cases, as wide as the build allows, and double runs the
+// closed_form.hpp kernels one case at a time as a reference.
+// run_scalar() takes the reference path for either type
+
+// even spacing of 'count' values from 'from' to 'to'
+template <typename T> std::vector<T> linspace(T from, T to, size_t count);
+// fill 'columns' with every combination of 'axes', column i takes its
+// values from axis i and axis 0 varies fastest
+template <typename T> void fill_grid(const std::vector<std::vector<T>*>& columns, const std::vector<std::vector<T> >& axes);
+
+// particle on a plane, see pp::evaluate
+template <typename T> struct pp_sweep {
+  // inputs
+  std::vector<T> mass;
+  std::vector<T> force;
+  std::vector<T> u_velocity;
+  // plane rotation in radians
+  std::vector<T> rotation;
+  std::vector<T> time;
+  T gravity;
+  // output, displacement along the plane in particle radii
+  std::vector<T> displacement;
+
+  pp_sweep() : gravity(9.8f) {}
+  size_t size() const { return time.size(); }
+  void resize(size_t n);
+  // evaluate every case, on the calling thread when 'pool' is NULL
+  void run(thread_pool* pool = NULL);
+  void run_scalar(thread_pool* pool = NULL);
+};
+
+// particle pushed along a plane by a spring, see spp::evaluate
+template <typename T> struct spp_sweep {
+  // inputs
+  std::vector<T> mass;
+  std::vector<T> force;
+  std::vector<T> u_velocity;
+  std::vector<T> rotation;
+  // spring natural length, starting compression and modulus of elasticity
+  std::vector<T> length;
+  std::vector<T> extension;
+  std::vector<T> elasticity;
+  std::vector<T> time;
+  T gravity;
+  // outputs
+  std::vector<T> displacement;
+  // time the particle leaves the spring
+  std::vector<T> end_time;
+
+  spp_sweep() : gravity(9.8f) {}
+  size_t size() const { return time.size(); }
+  void resize(size_t n);
+  void run(thread_pool* pool = NULL);
+  void run_scalar(thread_pool* pool = NULL);
+};
+
+// two particles colliding head on, see ppp::evaluate
+template <typename T> struct ppp_sweep {
+  // inputs, speeds are towards the other particle
+  std::vector<T> mass1;
+  std::vector<T> mass2;
+  std::vector<T> u_velocity1;
+  std::vector<T> u_velocity2;
+  // starting separation in radii of particle 1
+  std::vector<T> distance;
+  std::vector<T> time;
+  T radius1;
+  T radius2;
+  T restitution;
+  // outputs
+  std::vector<T> collision_time;
+  // velocities after the collision
+  std::vector<T> v1;
+  std::vector<T> v2;
+  // positions along the plane
+  std::vector<T> displacement1;
+  std::vector<T> displacement2;
+
+  ppp_sweep() : radius1(5.0f), radius2(5.0f), restitution(0.5f) {}
+  size_t size() const { return time.size(); }
+  void resize(size_t n);
+  void run(thread_pool* pool = NULL);
+  void run_scalar(thread_pool* pool = NULL);
+};
+
+// float runs are the simd kernels, double runs the scalar reference
+template <> void pp_sweep<float>::run(thread_pool* pool);
+template <> void pp_sweep<double>::run(thread_pool* pool);
+template <> void spp_sweep<float>::run(thread_pool* pool);
+template <> void spp_sweep<double>::run(thread_pool* pool);
+template <> void ppp_sweep<float>::run(thread_pool* pool);
+template <> void ppp_sweep<double>::run(thread_pool* pool);
+
+#endif // !SWEEP_H
@@ -0,0 +1,79 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+thread_pool::thread_pool(unsigned int threads) :
+  m_job(NULL),
+  m_count(0),
+  m_next(0),
+  m_finished(0),
+  m_active(0),
+  m_generation(0),
+  m_stop(false) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int i = 1; i < threads; i++)
+    m_workers.emplace_back(&thread_pool::work, this);
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (std::thread& t : m_workers)
+    t.join();
+}
+
+void thread_pool::drain() {
+  size_t done = 0;
+  for (size_t i = m_next++; i < m_count; i = m_next++) {
+    (*m_job)(i);
+    done++;
+  }
+  if (done == 0)
+    return;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_finished += done;
+}
+
+void thread_pool::work() {
+  unsigned long long seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+      if (m_stop)
+        return;
+      seen = m_generation;
+      m_active++;
+    }
+    drain();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_active--;
+    m_done.notify_all();
+  }
+}
+
+void thread_pool::run(size_t count, const std::function<void(size_t)>& job) {
+  if (count == 0)
+    return;
+  // not worth waking anyone for a single job
+  if (count == 1 || m_workers.empty()) {
+    for (size_t i = 0; i < count; i++)
+      job(i);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &job;
+    m_count = count;
+    m_next = 0;
+    m_finished = 0;
+    m_generation++;
+  }
+  m_wake.notify_all();
+  drain();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [&] { return m_finished == m_count && m_active == 0; });
+}
@@ -0,0 +1,46 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads for independent jobs
+// run() hands out job indices to the workers and the calling thread and
+// returns once every job has finished, so results are ready to read
+class thread_pool {
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  // current batch, valid while m_generation is unchanged
+  const std::function<void(size_t)>* m_job;
+  size_t m_count;
+  std::atomic<size_t> m_next;
+  size_t m_finished;
+  // workers inside drain(), a batch is only over once they have all left
+  unsigned int m_active;
+  unsigned long long m_generation;
+  bool m_stop;
+
+  void work();
+  // take jobs from the current batch until none are left
+  void drain();
+
+public:
+  // 'threads' counts the calling thread, 0 uses every hardware thread
+  thread_pool(unsigned int threads = 0);
+  ~thread_pool();
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  // call job(0) to job(count - 1) across the pool, blocks until all return
+  void run(size_t count, const std::function<void(size_t)>& job);
+  unsigned int get_thread_count() const { return (unsigned int)m_workers.size() + 1; }
+};
+
+#endif // !THREAD_POOL_H
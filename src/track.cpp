@@ -0,0 +1,215 @@
+#include "track.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const double forever = std::numeric_limits<double>::infinity();
+// sine of the turn below which two planes count as in line
+static const double straight = 1e-9;
+
+// earliest t >= 0 where a*t^2 + b*t + c = 0 while its rate 2*a*t + b has
+// the sign of 'sign', or where the rate is 0 and a turns it that way.
+// infinity when there is none
+static double crossing(double a, double b, double c, double sign) {
+  double roots[2];
+  int count = 0;
+  if (a == 0.0) {
+    if (b != 0.0)
+      roots[count++] = -c/b;
+  } else {
+    double d = b*b - 4.0*a*c;
+    if (d >= 0.0) {
+      // the stable pair, neither root loses digits to cancellation
+      double q = -0.5*(b + std::copysign(std::sqrt(d), b));
+      roots[count++] = q/a;
+      if (q != 0.0)
+        roots[count++] = c/q;
+    }
+  }
+  double best = forever;
+  for (int k = 0; k < count; k++) {
+    double t = roots[k];
+    double rate = (2.0*a*t + b)*sign;
+    if (t >= 0.0 && t < best && (rate > 0.0 || (rate == 0.0 && a*sign > 0.0)))
+      best = t;
+  }
+  return best;
+}
+
+void plane_track::add(double rotation, double length, glm::dvec3 start) {
+  segment g;
+  // down the slope and out of the surface, as the stepped solvers see it
+  g.direction = glm::dvec3(std::cos(rotation), -std::sin(rotation), 0.0);
+  g.normal = glm::dvec3(std::sin(rotation), std::cos(rotation), 0.0);
+  g.length = length;
+  g.start = segments.empty() ? start : segments.back().start + segments.back().direction*segments.back().length;
+  segments.push_back(g);
+}
+
+void plane_track::launch(int i, double s, double w) {
+  m_pieces.clear();
+  m_current = 0;
+  if (i < 0 || i >= (int)segments.size())
+    return;
+  slide(0.0, i, std::min(std::max(s, 0.0), segments[i].length), w);
+}
+
+void plane_track::slide(double time, int i, double s, double w) {
+  const segment& g = segments[i];
+  glm::dvec3 point = g.start + g.direction*s;
+  glm::dvec3 offset = g.normal*radius;
+  // the plane only pushes, an acceleration away from it lifts off
+  if (glm::dot(acceleration, g.normal) > 0.0) {
+    fly(time, point, g.direction*w, offset, i);
+    return;
+  }
+  double a = glm::dot(acceleration, g.direction);
+  piece p;
+  p.time = time;
+  p.origin = point;
+  p.velocity = g.direction*w;
+  p.acceleration = g.direction*a;
+  p.offset = offset;
+  p.segment = i;
+  p.target = -1;
+  // s + w*t + a*t^2/2 reaches either end of the plane
+  double forward = crossing(0.5*a, w, s - g.length, 1.0);
+  double backward = crossing(0.5*a, w, s, -1.0);
+  if (forward == forever && backward == forever) {
+    p.event = NONE;
+    p.end = forever;
+  } else if (forward <= backward) {
+    p.event = FORWARD;
+    p.end = time + forward;
+  } else {
+    p.event = BACKWARD;
+    p.end = time + backward;
+  }
+  m_pieces.push_back(p);
+}
+
+void plane_track::fly(double time, glm::dvec3 point, glm::dvec3 velocity, glm::dvec3 offset, int from) {
+  piece p;
+  p.time = time;
+  p.end = forever;
+  p.origin = point;
+  p.velocity = velocity;
+  p.acceleration = acceleration;
+  p.offset = offset;
+  p.segment = -1;
+  p.event = NONE;
+  p.target = -1;
+  // a parabola comes down through a line once at most, the first plane
+  // it comes down on from above is where it lands. every plane is tried,
+  // chains are short enough that a flight costs less than a frame
+  double best = forever;
+  for (size_t j = 0; j < segments.size(); j++) {
+    if ((int)j == from)
+      continue;
+    const segment& h = segments[j];
+    glm::dvec3 d = point - h.start;
+    double t = crossing(0.5*glm::dot(acceleration, h.normal), glm::dot(velocity, h.normal), glm::dot(d, h.normal), -1.0);
+    if (t >= best)
+      continue;
+    double s = glm::dot(d + (velocity + acceleration*(0.5*t))*t, h.direction);
+    if (s < 0.0 || s > h.length)
+      continue;
+    best = t;
+    p.event = LAND;
+    p.target = (int)j;
+  }
+  p.end = time + best;
+  m_pieces.push_back(p);
+}
+
+void plane_track::rest(double time, glm::dvec3 point, glm::dvec3 offset) {
+  piece p;
+  p.time = time;
+  p.end = forever;
+  p.origin = point;
+  p.velocity = glm::dvec3(0.0);
+  p.acceleration = glm::dvec3(0.0);
+  p.offset = offset;
+  p.segment = -1;
+  p.event = NONE;
+  p.target = -1;
+  m_pieces.push_back(p);
+}
+
+void plane_track::pass(double time, int i, int next, bool forward, double w) {
+  const segment& g = segments[i];
+  glm::dvec3 corner = forward ? g.start + g.direction*g.length : g.start;
+  glm::dvec3 offset = g.normal*radius;
+  if (next < 0 || next >= (int)segments.size()) {
+    fly(time, corner, g.direction*w, offset, i);
+    return;
+  }
+  const segment& h = segments[next];
+  // a plane turning down drops away from under the particle, planes in
+  // line round their turn either way, so are let through
+  if (glm::dot(g.normal, forward ? h.direction : -h.direction) < -straight) {
+    fly(time, corner, g.direction*w, offset, i);
+    return;
+  }
+  // one turning up stops the velocity across it
+  double v = w*glm::dot(g.direction, h.direction);
+  // in a valley both planes send the particle back to the corner, and it
+  // loses speed every time it turns there
+  double before = glm::dot(acceleration, g.direction);
+  double after = glm::dot(acceleration, h.direction);
+  bool valley = forward ? (before > 0.0 && after < 0.0) : (before < 0.0 && after > 0.0);
+  if (valley && 2.0*std::fabs(v) < settle_time*std::fabs(after)) {
+    rest(time, corner, offset);
+    return;
+  }
+  slide(time, next, forward ? 0.0 : h.length, v);
+}
+
+void plane_track::extend() {
+  const piece p = m_pieces.back();
+  if (p.event == NONE)
+    return;
+  double t = p.end - p.time;
+  glm::dvec3 point = p.origin + (p.velocity + p.acceleration*(0.5*t))*t;
+  glm::dvec3 velocity = p.velocity + p.acceleration*t;
+  if (m_pieces.size() >= max_pieces) {
+    rest(p.end, point, p.offset);
+    return;
+  }
+  switch (p.event) {
+    case FORWARD:
+      pass(p.end, p.segment, p.segment + 1, true, glm::dot(velocity, segments[p.segment].direction));
+      break;
+    case BACKWARD:
+      pass(p.end, p.segment, p.segment - 1, false, glm::dot(velocity, segments[p.segment].direction));
+      break;
+    case LAND: {
+      // landing stops the velocity across the plane
+      const segment& h = segments[p.target];
+      double s = std::min(std::max(glm::dot(point - h.start, h.direction), 0.0), h.length);
+      slide(p.end, p.target, s, glm::dot(velocity, h.direction));
+      break;
+    }
+    case NONE:
+    default:
+      break;
+  }
+}
+
+glm::dvec3 plane_track::position(double t) {
+  if (m_pieces.empty())
+    return glm::dvec3(0.0);
+  while (m_pieces.back().event != NONE && t >= m_pieces.back().end)
+    extend();
+  if (t < m_pieces[m_current].time) {
+    // stepping back, look the piece up again
+    std::vector<piece>::const_iterator it = std::upper_bound(
+        m_pieces.begin(), m_pieces.end(), t, [](double time, const piece& p) { return time < p.time; });
+    m_current = it == m_pieces.begin() ? 0 : (size_t)(it - m_pieces.begin()) - 1;
+  }
+  while (m_current + 1 < m_pieces.size() && t >= m_pieces[m_current + 1].time)
+    m_current++;
+  const piece& p = m_pieces[m_current];
+  double after = t - p.time;
+  return p.origin + p.offset + (p.velocity + p.acceleration*(0.5*after))*after;
+}
@@ -0,0 +1,87 @@
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// particle sliding along a chain of straight planes, in closed form
+// the particle is a point on the surface under one constant acceleration,
+// drawn a radius out along the normal of the plane it last touched. on a
+// plane it keeps the part of the acceleration along it, off one it flies
+// on a parabola, so every stretch of the motion is a quadratic in time.
+// the times it reaches the end of a plane or lands on one are roots of
+// quadratics, solved exactly, and passing into a plane that turns up
+// keeps the velocity along the new plane only. the stretches are worked
+// out as the clock reaches them, so evaluating a time costs the
+// transitions passed since the last one, none on most frames
+class plane_track {
+public:
+  // straight plane from start to start + direction*length, its surface
+  // facing along normal
+  struct segment {
+    glm::dvec3 start;
+    glm::dvec3 direction;
+    glm::dvec3 normal;
+    double length;
+  };
+
+private:
+  // how a piece ends
+  enum EVENT { NONE, FORWARD, BACKWARD, LAND };
+  // point = origin + (velocity + acceleration*t/2)*t for the t seconds
+  // from time until end
+  struct piece {
+    double time;
+    double end;
+    glm::dvec3 origin;
+    glm::dvec3 velocity;
+    glm::dvec3 acceleration;
+    glm::dvec3 offset;
+    // plane slid along, -1 in flight
+    int segment;
+    EVENT event;
+    // plane landed on by a LAND event
+    int target;
+  };
+  std::vector<piece> m_pieces;
+  // piece the last position() fell in
+  size_t m_current;
+
+  // start a piece from 's' along segment i moving at 'w' along it
+  void slide(double time, int i, double s, double w);
+  // start a piece flying from 'point', skipping a landing on segment 'from'
+  void fly(double time, glm::dvec3 point, glm::dvec3 velocity, glm::dvec3 offset, int from);
+  void rest(double time, glm::dvec3 point, glm::dvec3 offset);
+  // segment i reached its far end, or its start when not 'forward',
+  // moving at 'w' along it, carry on along 'next' or fly off
+  void pass(double time, int i, int next, bool forward, double w);
+  // append the piece after the last one
+  void extend();
+
+public:
+  // pieces kept before the particle is held where it is
+  static constexpr size_t max_pieces = 1 << 16;
+  // a particle that would come back to the same corner sooner than this
+  // rests there, rather than bouncing ever faster between its sides
+  static constexpr double settle_time = 1e-9;
+
+  std::vector<segment> segments;
+  glm::dvec3 acceleration;
+  double radius;
+
+  plane_track() : m_current(0), acceleration(0.0), radius(0.0) {}
+  // join a plane of 'length' on to the end of the chain, or at 'start'
+  // for the first, sloping down at 'rotation' as plane_body does
+  void add(double rotation, double length, glm::dvec3 start);
+  // forget the motion and put the particle 's' along segment i, moving
+  // at 'w' along it
+  void launch(int i, double s, double w);
+  // position at time t, from the launch at time 0
+  glm::dvec3 position(double t);
+  // pieces worked out so far
+  size_t get_pieces() const { return m_pieces.size(); }
+};
+
+#endif // !TRACK_H
@@ -0,0 +1,40 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// single writer, single reader handoff without locks
+// the writer fills back() and publishes it, the reader picks up the most
+// recent publish with update() and reads front(), neither side waits and
+// each keeps a slot of its own, the third slot passes between them
+template <typename T> class triple_buffer {
+  // marks the middle slot as written since the reader last took it
+  static constexpr unsigned int fresh = 4;
+  T m_slots[3];
+  // middle slot index, plus the fresh bit
+  std::atomic<unsigned int> m_middle;
+  unsigned int m_back;
+  unsigned int m_front;
+
+public:
+  triple_buffer() : m_middle(1), m_back(0), m_front(2) {}
+
+  // writer side
+  T& back() { return m_slots[m_back]; }
+  // hand back() to the reader, the writer continues in another slot
+  void publish() {
+    m_back = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel) & 3;
+  }
+
+  // reader side
+  // swap in the latest published slot, false if nothing new was published
+  bool update() {
+    if (!(m_middle.load(std::memory_order_relaxed) & fresh))
+      return false;
+    m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & 3;
+    return true;
+  }
+  const T& front() const { return m_slots[m_front]; }
+};
+
+#endif // !TRIPLE_BUFFER_H